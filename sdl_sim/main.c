@@ -26,8 +26,10 @@
 #include "msg.h"
 #include "sony.h"
 #include "sdl2.h"
+#include "vnc.h"
 
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
 
 #include <unistd.h>
@@ -319,6 +321,17 @@ terminal_t *ini_get_terminal (const char *def)
 	terminal_t *trm = NULL;
 	sdl2_t *sdl;
 
+	if ((def != NULL) && (strncmp (def, "vnc", 3) == 0)) {
+		if ((trm = vnc_new (def)) == NULL) {
+			pce_log (MSG_ERR, "*** setting up vnc terminal failed\n");
+		}
+
+		return (trm);
+	}
+	else if ((def != NULL) && (strcmp (def, "null") == 0)) {
+		return (null_new (NULL));
+	}
+
 	if ((sdl = malloc (sizeof (sdl2_t))) == NULL) {
 		return (NULL);
 	}
@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <SDL2/SDL.h>
 
@@ -298,17 +299,8 @@ int sdl2_set_window_size_auto (sdl2_t *sdl)
 }
 
 static
-int sdl2_set_frame_size (sdl2_t *sdl)
+int sdl2_set_texture (sdl2_t *sdl, unsigned tw, unsigned th)
 {
-	unsigned tw, th;
-
-	tw = sdl->trm.w;
-	th = sdl->trm.h;
-
-	if (sdl->autosize) {
-		sdl2_set_window_size_auto (sdl);
-	}
-
 	if ((sdl->txt_w == tw) && (sdl->txt_h == th)) {
 		return (0);
 	}
@@ -318,6 +310,9 @@ int sdl2_set_frame_size (sdl2_t *sdl)
 		sdl->texture = NULL;
 	}
 
+	sdl->txt_w = 0;
+	sdl->txt_h = 0;
+
 	sdl->texture = SDL_CreateTexture (sdl->render,
 		SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STREAMING, tw, th
 	);
@@ -333,6 +328,20 @@ int sdl2_set_frame_size (sdl2_t *sdl)
 	return (0);
 }
 
+/*
+ * Present the texture again, without uploading anything
+ */
+static
+void sdl2_redraw (sdl2_t *sdl)
+{
+	if ((sdl->render == NULL) || (sdl->texture == NULL)) {
+		return;
+	}
+
+	SDL_RenderCopy (sdl->render, sdl->texture, NULL, NULL);
+	SDL_RenderPresent (sdl->render);
+}
+
 static
 unsigned sdl2_map_key (sdl2_t *sdl, SDL_Scancode key)
 {
@@ -347,35 +356,64 @@ unsigned sdl2_map_key (sdl2_t *sdl, SDL_Scancode key)
 	return (PCE_KEY_NONE);
 }
 
+/*
+ * Upload the changed rectangles of the terminal buffer and present the
+ * frame. Scaling to the window size is done by the renderer.
+ */
 static
 void sdl2_update (sdl2_t *sdl)
 {
-	terminal_t *trm;
-	void       *pixels;
-	int        pitch;
+	unsigned         i, cnt;
+	terminal_t       *trm;
+	const trm_rect_t *r;
+	trm_rect_t       all;
+	SDL_Rect         rect;
 
 	trm = &sdl->trm;
 
 	sdl->update = 0;
 
-	if ((trm->w == 0) || (trm->h == 0)) {
+	if ((trm->w == 0) || (trm->h == 0) || (trm->fmt != TRM_FMT_RGB888)) {
 		return;
 	}
 
-	if (sdl2_set_frame_size (sdl)) {
+	if (sdl->render == NULL) {
 		return;
 	}
 
-	if ((sdl->texture == NULL) || (sdl->render == NULL)) {
-		return;
+	if (sdl->autosize) {
+		sdl2_set_window_size_auto (sdl);
 	}
 
-	SDL_LockTexture (sdl->texture, NULL, &pixels, &pitch);
-	memcpy (pixels, trm->buf, 3UL * trm->w * trm->h);
-	SDL_UnlockTexture (sdl->texture);
+	r = trm->rect;
+	cnt = trm->rect_cnt;
 
-	SDL_RenderCopy (sdl->render, sdl->texture, NULL, NULL);
-	SDL_RenderPresent (sdl->render);
+	if ((sdl->txt_w != trm->w) || (sdl->txt_h != trm->h)) {
+		if (sdl2_set_texture (sdl, trm->w, trm->h)) {
+			return;
+		}
+
+		all.x = 0;
+		all.y = 0;
+		all.w = trm->w;
+		all.h = trm->h;
+
+		r = &all;
+		cnt = 1;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		rect.x = r[i].x;
+		rect.y = r[i].y;
+		rect.w = r[i].w;
+		rect.h = r[i].h;
+
+		SDL_UpdateTexture (sdl->texture, &rect,
+			trm->buf + trm->bpl * r[i].y + 3UL * r[i].x, trm->bpl
+		);
+	}
+
+	sdl2_redraw (sdl);
 }
 
 static
@@ -624,7 +662,13 @@ void sdl2_check (sdl2_t *sdl)
 	}
 
 	if (sdl->update) {
-		sdl2_update (sdl);
+		sdl->update = 0;
+
+		if (sdl->autosize) {
+			sdl2_set_window_size_auto (sdl);
+		}
+
+		sdl2_redraw (sdl);
 	}
 
 	if (sdl->ignore_keys) {
@@ -754,6 +798,9 @@ int sdl2_close (sdl2_t *sdl)
 		sdl->texture = NULL;
 	}
 
+	sdl->txt_w = 0;
+	sdl->txt_h = 0;
+
 	if (sdl->render != NULL) {
 		SDL_DestroyRenderer (sdl->render);
 		sdl->render = NULL;
@@ -50,6 +50,7 @@ typedef struct {
 	SDL_Renderer  *render;
 	SDL_Texture   *texture;
 
+
 	unsigned      txt_w;
 	unsigned      txt_h;
 
@@ -0,0 +1,1413 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   sdl_sim/vnc.c                                                *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <drivers/options.h>
+#include <drivers/video/terminal.h>
+#include <drivers/video/keys.h>
+
+#include <lib/log.h>
+
+#include "vnc.h"
+
+
+#define VNC_STATE_NONE     0
+#define VNC_STATE_VERSION  1
+#define VNC_STATE_SECURITY 2
+#define VNC_STATE_INIT     3
+#define VNC_STATE_NORMAL   4
+
+#define VNC_ENC_RAW          0
+#define VNC_ENC_HEXTILE      5
+#define VNC_ENC_DESKTOP_SIZE -223
+
+#define VNC_HEX_RAW        0x01
+#define VNC_HEX_BACKGROUND 0x02
+#define VNC_HEX_FOREGROUND 0x04
+#define VNC_HEX_SUBRECTS   0x08
+
+
+typedef struct {
+	unsigned long keysym;
+	pce_key_t     pcekey;
+} vnc_keymap_t;
+
+
+/* X11 key symbols, shifted symbols map to the unshifted key */
+static vnc_keymap_t keymap[] = {
+	{ 0xff1b, PCE_KEY_ESC },
+	{ 0xffbe, PCE_KEY_F1 },
+	{ 0xffbf, PCE_KEY_F2 },
+	{ 0xffc0, PCE_KEY_F3 },
+	{ 0xffc1, PCE_KEY_F4 },
+	{ 0xffc2, PCE_KEY_F5 },
+	{ 0xffc3, PCE_KEY_F6 },
+	{ 0xffc4, PCE_KEY_F7 },
+	{ 0xffc5, PCE_KEY_F8 },
+	{ 0xffc6, PCE_KEY_F9 },
+	{ 0xffc7, PCE_KEY_F10 },
+	{ 0xffc8, PCE_KEY_F11 },
+	{ 0xffc9, PCE_KEY_F12 },
+
+	{ 0xff61, PCE_KEY_PRTSCN },
+	{ 0xff14, PCE_KEY_SCRLK },
+	{ 0xff13, PCE_KEY_PAUSE },
+
+	{ '`',    PCE_KEY_BACKQUOTE },
+	{ '~',    PCE_KEY_BACKQUOTE },
+	{ '1',    PCE_KEY_1 },
+	{ '!',    PCE_KEY_1 },
+	{ '2',    PCE_KEY_2 },
+	{ '@',    PCE_KEY_2 },
+	{ '3',    PCE_KEY_3 },
+	{ '#',    PCE_KEY_3 },
+	{ '4',    PCE_KEY_4 },
+	{ '$',    PCE_KEY_4 },
+	{ '5',    PCE_KEY_5 },
+	{ '%',    PCE_KEY_5 },
+	{ '6',    PCE_KEY_6 },
+	{ '^',    PCE_KEY_6 },
+	{ '7',    PCE_KEY_7 },
+	{ '&',    PCE_KEY_7 },
+	{ '8',    PCE_KEY_8 },
+	{ '*',    PCE_KEY_8 },
+	{ '9',    PCE_KEY_9 },
+	{ '(',    PCE_KEY_9 },
+	{ '0',    PCE_KEY_0 },
+	{ ')',    PCE_KEY_0 },
+	{ '-',    PCE_KEY_MINUS },
+	{ '_',    PCE_KEY_MINUS },
+	{ '=',    PCE_KEY_EQUAL },
+	{ '+',    PCE_KEY_EQUAL },
+	{ 0xff08, PCE_KEY_BACKSPACE },
+
+	{ 0xff09, PCE_KEY_TAB },
+	{ 'q',    PCE_KEY_Q },
+	{ 'w',    PCE_KEY_W },
+	{ 'e',    PCE_KEY_E },
+	{ 'r',    PCE_KEY_R },
+	{ 't',    PCE_KEY_T },
+	{ 'y',    PCE_KEY_Y },
+	{ 'u',    PCE_KEY_U },
+	{ 'i',    PCE_KEY_I },
+	{ 'o',    PCE_KEY_O },
+	{ 'p',    PCE_KEY_P },
+	{ '[',    PCE_KEY_LBRACKET },
+	{ '{',    PCE_KEY_LBRACKET },
+	{ ']',    PCE_KEY_RBRACKET },
+	{ '}',    PCE_KEY_RBRACKET },
+	{ 0xff0d, PCE_KEY_RETURN },
+
+	{ 0xffe5, PCE_KEY_CAPSLOCK },
+	{ 'a',    PCE_KEY_A },
+	{ 's',    PCE_KEY_S },
+	{ 'd',    PCE_KEY_D },
+	{ 'f',    PCE_KEY_F },
+	{ 'g',    PCE_KEY_G },
+	{ 'h',    PCE_KEY_H },
+	{ 'j',    PCE_KEY_J },
+	{ 'k',    PCE_KEY_K },
+	{ 'l',    PCE_KEY_L },
+	{ ';',    PCE_KEY_SEMICOLON },
+	{ ':',    PCE_KEY_SEMICOLON },
+	{ '\'',   PCE_KEY_QUOTE },
+	{ '"',    PCE_KEY_QUOTE },
+	{ '\\',   PCE_KEY_BACKSLASH },
+	{ '|',    PCE_KEY_BACKSLASH },
+
+	{ 0xffe1, PCE_KEY_LSHIFT },
+	{ 'z',    PCE_KEY_Z },
+	{ 'x',    PCE_KEY_X },
+	{ 'c',    PCE_KEY_C },
+	{ 'v',    PCE_KEY_V },
+	{ 'b',    PCE_KEY_B },
+	{ 'n',    PCE_KEY_N },
+	{ 'm',    PCE_KEY_M },
+	{ ',',    PCE_KEY_COMMA },
+	{ '<',    PCE_KEY_COMMA },
+	{ '.',    PCE_KEY_PERIOD },
+	{ '>',    PCE_KEY_PERIOD },
+	{ '/',    PCE_KEY_SLASH },
+	{ '?',    PCE_KEY_SLASH },
+	{ 0xffe2, PCE_KEY_RSHIFT },
+
+	{ 0xffe3, PCE_KEY_LCTRL },
+	{ 0xffeb, PCE_KEY_LSUPER },
+	{ 0xffe7, PCE_KEY_LMETA },
+	{ 0xffe9, PCE_KEY_LALT },
+	{ ' ',    PCE_KEY_SPACE },
+	{ 0xffea, PCE_KEY_RALT },
+	{ 0xfe03, PCE_KEY_RALT },
+	{ 0xffe8, PCE_KEY_RMETA },
+	{ 0xffec, PCE_KEY_RSUPER },
+	{ 0xff67, PCE_KEY_MENU },
+	{ 0xffe4, PCE_KEY_RCTRL },
+
+	{ 0xff7f, PCE_KEY_NUMLOCK },
+	{ 0xffaf, PCE_KEY_KP_SLASH },
+	{ 0xffaa, PCE_KEY_KP_STAR },
+	{ 0xffad, PCE_KEY_KP_MINUS },
+	{ 0xffb7, PCE_KEY_KP_7 },
+	{ 0xff95, PCE_KEY_KP_7 },
+	{ 0xffb8, PCE_KEY_KP_8 },
+	{ 0xff97, PCE_KEY_KP_8 },
+	{ 0xffb9, PCE_KEY_KP_9 },
+	{ 0xff9a, PCE_KEY_KP_9 },
+	{ 0xffab, PCE_KEY_KP_PLUS },
+	{ 0xffb4, PCE_KEY_KP_4 },
+	{ 0xff96, PCE_KEY_KP_4 },
+	{ 0xffb5, PCE_KEY_KP_5 },
+	{ 0xff9d, PCE_KEY_KP_5 },
+	{ 0xffb6, PCE_KEY_KP_6 },
+	{ 0xff98, PCE_KEY_KP_6 },
+	{ 0xffb1, PCE_KEY_KP_1 },
+	{ 0xff9c, PCE_KEY_KP_1 },
+	{ 0xffb2, PCE_KEY_KP_2 },
+	{ 0xff99, PCE_KEY_KP_2 },
+	{ 0xffb3, PCE_KEY_KP_3 },
+	{ 0xff9b, PCE_KEY_KP_3 },
+	{ 0xff8d, PCE_KEY_KP_ENTER },
+	{ 0xffb0, PCE_KEY_KP_0 },
+	{ 0xff9e, PCE_KEY_KP_0 },
+	{ 0xffae, PCE_KEY_KP_PERIOD },
+	{ 0xff9f, PCE_KEY_KP_PERIOD },
+
+	{ 0xff63, PCE_KEY_INS },
+	{ 0xff50, PCE_KEY_HOME },
+	{ 0xff55, PCE_KEY_PAGEUP },
+	{ 0xffff, PCE_KEY_DEL },
+	{ 0xff57, PCE_KEY_END },
+	{ 0xff56, PCE_KEY_PAGEDN },
+
+	{ 0xff52, PCE_KEY_UP },
+	{ 0xff51, PCE_KEY_LEFT },
+	{ 0xff54, PCE_KEY_DOWN },
+	{ 0xff53, PCE_KEY_RIGHT },
+
+	{ 0, PCE_KEY_NONE }
+};
+
+
+static
+pce_key_t vnc_map_key (unsigned long keysym)
+{
+	unsigned i;
+
+	if ((keysym >= 'A') && (keysym <= 'Z')) {
+		keysym += 'a' - 'A';
+	}
+
+	for (i = 0; keymap[i].pcekey != PCE_KEY_NONE; i++) {
+		if (keymap[i].keysym == keysym) {
+			return (keymap[i].pcekey);
+		}
+	}
+
+	return (PCE_KEY_NONE);
+}
+
+static
+unsigned vnc_get_uint16 (const unsigned char *buf)
+{
+	return ((buf[0] << 8) | buf[1]);
+}
+
+static
+unsigned long vnc_get_uint32 (const unsigned char *buf)
+{
+	unsigned long v;
+
+	v = buf[0];
+	v = (v << 8) | buf[1];
+	v = (v << 8) | buf[2];
+	v = (v << 8) | buf[3];
+
+	return (v);
+}
+
+/*
+ * Reserve cnt bytes in the output buffer
+ * If the buffer can't be grown, the message that is being built is
+ * incomplete and the client is closed by the next vnc_flush().
+ */
+static
+unsigned char *vnc_out_alloc (vnc_t *vnc, unsigned long cnt)
+{
+	unsigned long max;
+	unsigned char *tmp;
+
+	if (vnc->out_failed) {
+		return (NULL);
+	}
+
+	if ((vnc->out_cnt + cnt) > vnc->out_max) {
+		max = 2 * (vnc->out_cnt + cnt);
+
+		if ((tmp = realloc (vnc->out, max)) == NULL) {
+			vnc->out_failed = 1;
+			return (NULL);
+		}
+
+		vnc->out = tmp;
+		vnc->out_max = max;
+	}
+
+	tmp = vnc->out + vnc->out_cnt;
+
+	vnc->out_cnt += cnt;
+
+	return (tmp);
+}
+
+static
+void vnc_out_buf (vnc_t *vnc, const void *buf, unsigned long cnt)
+{
+	unsigned char *p;
+
+	if ((p = vnc_out_alloc (vnc, cnt)) != NULL) {
+		memcpy (p, buf, cnt);
+	}
+}
+
+static
+void vnc_out_uint8 (vnc_t *vnc, unsigned v)
+{
+	unsigned char *p;
+
+	if ((p = vnc_out_alloc (vnc, 1)) != NULL) {
+		p[0] = v & 0xff;
+	}
+}
+
+static
+void vnc_out_uint16 (vnc_t *vnc, unsigned v)
+{
+	unsigned char *p;
+
+	if ((p = vnc_out_alloc (vnc, 2)) != NULL) {
+		p[0] = (v >> 8) & 0xff;
+		p[1] = v & 0xff;
+	}
+}
+
+static
+void vnc_out_uint32 (vnc_t *vnc, unsigned long v)
+{
+	unsigned char *p;
+
+	if ((p = vnc_out_alloc (vnc, 4)) != NULL) {
+		p[0] = (v >> 24) & 0xff;
+		p[1] = (v >> 16) & 0xff;
+		p[2] = (v >> 8) & 0xff;
+		p[3] = v & 0xff;
+	}
+}
+
+/*
+ * Convert a 0xRRGGBB color to the client pixel format
+ */
+static
+void vnc_out_pixel (vnc_t *vnc, unsigned long col)
+{
+	unsigned      i;
+	unsigned long v;
+	unsigned char *p;
+
+	v = 0;
+
+	for (i = 0; i < 3; i++) {
+		v |= ((((col >> (16 - 8 * i)) & 0xff) * vnc->max[i] + 127) / 255) << vnc->shift[i];
+	}
+
+	if ((p = vnc_out_alloc (vnc, vnc->bpp)) == NULL) {
+		return;
+	}
+
+	for (i = 0; i < vnc->bpp; i++) {
+		if (vnc->big_endian) {
+			p[vnc->bpp - i - 1] = (v >> (8 * i)) & 0xff;
+		}
+		else {
+			p[i] = (v >> (8 * i)) & 0xff;
+		}
+	}
+}
+
+static
+void vnc_close_client (vnc_t *vnc)
+{
+	if (vnc->fd >= 0) {
+		close (vnc->fd);
+		vnc->fd = -1;
+	}
+
+	vnc->state = VNC_STATE_NONE;
+
+	vnc->inp_cnt = 0;
+	vnc->inp_skip = 0;
+	vnc->out_cnt = 0;
+	vnc->out_failed = 0;
+
+	vnc->button = 0;
+}
+
+/*
+ * Send as much of the output buffer as the socket accepts
+ */
+static
+void vnc_flush (vnc_t *vnc)
+{
+	ssize_t r;
+
+	if (vnc->out_failed) {
+		fprintf (stderr, "vnc: out of memory\n");
+		vnc_close_client (vnc);
+		return;
+	}
+
+	while ((vnc->fd >= 0) && (vnc->out_cnt > 0)) {
+		r = send (vnc->fd, vnc->out, vnc->out_cnt, MSG_NOSIGNAL);
+
+		if (r < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				return;
+			}
+			else if (errno == EINTR) {
+				continue;
+			}
+
+			vnc_close_client (vnc);
+
+			return;
+		}
+
+		vnc->out_cnt -= r;
+
+		if (vnc->out_cnt > 0) {
+			memmove (vnc->out, vnc->out + r, vnc->out_cnt);
+		}
+	}
+}
+
+static
+void vnc_add_dirty (vnc_t *vnc, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+	unsigned   i;
+	trm_rect_t *r;
+
+	if ((x >= vnc->trm.w) || (y >= vnc->trm.h) || (w == 0) || (h == 0)) {
+		return;
+	}
+
+	if ((x + w) > vnc->trm.w) {
+		w = vnc->trm.w - x;
+	}
+
+	if ((y + h) > vnc->trm.h) {
+		h = vnc->trm.h - y;
+	}
+
+	for (i = 0; i < vnc->dirty_cnt; i++) {
+		r = &vnc->dirty[i];
+
+		if ((x >= r->x) && (y >= r->y) && ((x + w) <= (r->x + r->w)) && ((y + h) <= (r->y + r->h))) {
+			return;
+		}
+	}
+
+	/* if the list is full, collapse it into its bounding rectangle */
+	if (vnc->dirty_cnt >= TRM_RECT_MAX) {
+		r = &vnc->dirty[0];
+
+		for (i = 1; i < vnc->dirty_cnt; i++) {
+			trm_rect_union (r, &vnc->dirty[i]);
+		}
+
+		vnc->dirty_cnt = 1;
+	}
+
+	r = &vnc->dirty[vnc->dirty_cnt++];
+
+	r->x = x;
+	r->y = y;
+	r->w = w;
+	r->h = h;
+}
+
+static
+void vnc_set_pixel_format (vnc_t *vnc, const unsigned char *pf)
+{
+	vnc->bpp = pf[0] / 8;
+	vnc->big_endian = (pf[2] != 0);
+	vnc->max[0] = vnc_get_uint16 (pf + 4);
+	vnc->max[1] = vnc_get_uint16 (pf + 6);
+	vnc->max[2] = vnc_get_uint16 (pf + 8);
+	vnc->shift[0] = pf[10];
+	vnc->shift[1] = pf[11];
+	vnc->shift[2] = pf[12];
+}
+
+static
+void vnc_send_server_init (vnc_t *vnc)
+{
+	static const char     *name = "pce-macplus";
+	static unsigned char pf[16] = {
+		32, 24, 0, 1, 0, 255, 0, 255, 0, 255, 16, 8, 0, 0, 0, 0
+	};
+
+	vnc_set_pixel_format (vnc, pf);
+
+	vnc->fb_w = vnc->trm.w;
+	vnc->fb_h = vnc->trm.h;
+
+	vnc_out_uint16 (vnc, vnc->fb_w);
+	vnc_out_uint16 (vnc, vnc->fb_h);
+	vnc_out_buf (vnc, pf, 16);
+	vnc_out_uint32 (vnc, strlen (name));
+	vnc_out_buf (vnc, name, strlen (name));
+}
+
+static
+int vnc_get_tile (vnc_t *vnc, unsigned long *pix, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+	unsigned            i, j;
+	const unsigned char *p;
+
+	for (j = 0; j < h; j++) {
+		trm_get_rgb (&vnc->trm, vnc->rgb, x, y + j, w);
+
+		p = vnc->rgb;
+
+		for (i = 0; i < w; i++) {
+			*(pix++) = ((unsigned long) p[0] << 16) | (p[1] << 8) | p[2];
+			p += 3;
+		}
+	}
+
+	return (0);
+}
+
+static
+void vnc_send_raw (vnc_t *vnc, const trm_rect_t *r)
+{
+	unsigned            x, y;
+	const unsigned char *p;
+
+	vnc_out_uint16 (vnc, r->x);
+	vnc_out_uint16 (vnc, r->y);
+	vnc_out_uint16 (vnc, r->w);
+	vnc_out_uint16 (vnc, r->h);
+	vnc_out_uint32 (vnc, VNC_ENC_RAW);
+
+	for (y = 0; y < r->h; y++) {
+		trm_get_rgb (&vnc->trm, vnc->rgb, r->x, r->y + y, r->w);
+
+		p = vnc->rgb;
+
+		for (x = 0; x < r->w; x++) {
+			vnc_out_pixel (vnc, ((unsigned long) p[0] << 16) | (p[1] << 8) | p[2]);
+			p += 3;
+		}
+	}
+}
+
+/*
+ * Encode a tile with at most two colors as a background color and
+ * foreground subrectangles.
+ * Returns non-zero if the tile can not be encoded like this.
+ */
+static
+int vnc_send_hextile_tile (vnc_t *vnc, const unsigned long *pix, unsigned w, unsigned h,
+	unsigned long *bg, unsigned long *fg, int *valid)
+{
+	unsigned      i, j, k, n, cnt, rw, rh;
+	unsigned long c[2];
+	unsigned      c_cnt[2];
+	unsigned      flags;
+	unsigned long flags_pos, cnt_pos;
+	unsigned char done[256];
+
+	c[0] = pix[0];
+	c[1] = pix[0];
+	c_cnt[0] = 0;
+	c_cnt[1] = 0;
+
+	n = w * h;
+
+	for (i = 0; i < n; i++) {
+		if (pix[i] == c[0]) {
+			c_cnt[0] += 1;
+		}
+		else if ((c_cnt[1] == 0) || (pix[i] == c[1])) {
+			c[1] = pix[i];
+			c_cnt[1] += 1;
+		}
+		else {
+			return (1);
+		}
+	}
+
+	/* the more frequent color is the background */
+	if (c_cnt[1] > c_cnt[0]) {
+		c[0] ^= c[1];
+		c[1] ^= c[0];
+		c[0] ^= c[1];
+	}
+
+	flags = 0;
+
+	if (((*valid & 1) == 0) || (*bg != c[0])) {
+		flags |= VNC_HEX_BACKGROUND;
+	}
+
+	if (c_cnt[0] && c_cnt[1]) {
+		flags |= VNC_HEX_SUBRECTS;
+
+		if (((*valid & 2) == 0) || (*fg != c[1])) {
+			flags |= VNC_HEX_FOREGROUND;
+		}
+	}
+
+	flags_pos = vnc->out_cnt;
+
+	vnc_out_uint8 (vnc, flags);
+
+	if (flags & VNC_HEX_BACKGROUND) {
+		vnc_out_pixel (vnc, c[0]);
+	}
+
+	if (flags & VNC_HEX_FOREGROUND) {
+		vnc_out_pixel (vnc, c[1]);
+	}
+
+	if ((flags & VNC_HEX_SUBRECTS) == 0) {
+		*bg = c[0];
+		*valid |= 1;
+		return (0);
+	}
+
+	cnt_pos = vnc->out_cnt;
+
+	vnc_out_uint8 (vnc, 0);
+
+	memset (done, 0, n);
+
+	cnt = 0;
+
+	for (j = 0; j < h; j++) {
+		for (i = 0; i < w; i++) {
+			k = j * w + i;
+
+			if ((pix[k] == c[0]) || done[k]) {
+				continue;
+			}
+
+			rw = 1;
+			while (((i + rw) < w) && (pix[k + rw] == c[1]) && (done[k + rw] == 0)) {
+				rw += 1;
+			}
+
+			rh = 1;
+			while ((j + rh) < h) {
+				for (n = 0; n < rw; n++) {
+					if ((pix[k + rh * w + n] != c[1]) || done[k + rh * w + n]) {
+						break;
+					}
+				}
+
+				if (n < rw) {
+					break;
+				}
+
+				rh += 1;
+			}
+
+			for (n = 0; n < rh; n++) {
+				memset (done + k + n * w, 1, rw);
+			}
+
+			vnc_out_uint8 (vnc, (i << 4) | j);
+			vnc_out_uint8 (vnc, ((rw - 1) << 4) | (rh - 1));
+
+			cnt += 1;
+		}
+	}
+
+	/* fall back to a raw tile if that is smaller */
+	if ((vnc->out_cnt - flags_pos) > (1 + vnc->bpp * w * h)) {
+		vnc->out_cnt = flags_pos;
+		return (1);
+	}
+
+	if (vnc->out_failed == 0) {
+		vnc->out[cnt_pos] = cnt;
+	}
+
+	*bg = c[0];
+	*fg = c[1];
+	*valid = 3;
+
+	return (0);
+}
+
+static
+void vnc_send_hextile (vnc_t *vnc, const trm_rect_t *r)
+{
+	unsigned      x, y, w, h, i;
+	unsigned long pix[256];
+	unsigned long bg, fg;
+	int           valid;
+
+	vnc_out_uint16 (vnc, r->x);
+	vnc_out_uint16 (vnc, r->y);
+	vnc_out_uint16 (vnc, r->w);
+	vnc_out_uint16 (vnc, r->h);
+	vnc_out_uint32 (vnc, VNC_ENC_HEXTILE);
+
+	bg = 0;
+	fg = 0;
+	valid = 0;
+
+	for (y = 0; y < r->h; y += 16) {
+		h = ((r->h - y) < 16) ? (r->h - y) : 16;
+
+		for (x = 0; x < r->w; x += 16) {
+			w = ((r->w - x) < 16) ? (r->w - x) : 16;
+
+			vnc_get_tile (vnc, pix, r->x + x, r->y + y, w, h);
+
+			if (vnc_send_hextile_tile (vnc, pix, w, h, &bg, &fg, &valid) == 0) {
+				continue;
+			}
+
+			vnc_out_uint8 (vnc, VNC_HEX_RAW);
+
+			for (i = 0; i < (w * h); i++) {
+				vnc_out_pixel (vnc, pix[i]);
+			}
+
+			/* the colors must be sent again after a raw tile */
+			valid = 0;
+		}
+	}
+}
+
+/*
+ * Send the changed areas if the client has asked for them and the last
+ * update has been sent completely.
+ */
+static
+void vnc_send_update (vnc_t *vnc)
+{
+	unsigned i, cnt;
+
+	if ((vnc->state != VNC_STATE_NORMAL) || (vnc->request == 0)) {
+		return;
+	}
+
+	if (vnc->out_cnt > 0) {
+		return;
+	}
+
+	cnt = vnc->dirty_cnt;
+
+	if ((vnc->fb_w != vnc->trm.w) || (vnc->fb_h != vnc->trm.h)) {
+		if (vnc->desktop_size == 0) {
+			vnc->dirty_cnt = 0;
+			return;
+		}
+
+		vnc->fb_w = vnc->trm.w;
+		vnc->fb_h = vnc->trm.h;
+
+		vnc->dirty_cnt = 0;
+		vnc_add_dirty (vnc, 0, 0, vnc->fb_w, vnc->fb_h);
+
+		cnt = vnc->dirty_cnt + 1;
+	}
+
+	if (cnt == 0) {
+		return;
+	}
+
+	if (vnc->rgb_cnt < (3UL * vnc->trm.w)) {
+		unsigned char *tmp;
+
+		if ((tmp = realloc (vnc->rgb, 3UL * vnc->trm.w)) == NULL) {
+			return;
+		}
+
+		vnc->rgb = tmp;
+		vnc->rgb_cnt = 3UL * vnc->trm.w;
+	}
+
+	vnc_out_uint8 (vnc, 0);
+	vnc_out_uint8 (vnc, 0);
+	vnc_out_uint16 (vnc, cnt);
+
+	if (cnt > vnc->dirty_cnt) {
+		vnc_out_uint16 (vnc, 0);
+		vnc_out_uint16 (vnc, 0);
+		vnc_out_uint16 (vnc, vnc->fb_w);
+		vnc_out_uint16 (vnc, vnc->fb_h);
+		vnc_out_uint32 (vnc, (unsigned long) VNC_ENC_DESKTOP_SIZE);
+	}
+
+	for (i = 0; i < vnc->dirty_cnt; i++) {
+		if (vnc->hextile) {
+			vnc_send_hextile (vnc, &vnc->dirty[i]);
+		}
+		else {
+			vnc_send_raw (vnc, &vnc->dirty[i]);
+		}
+	}
+
+	vnc->dirty_cnt = 0;
+	vnc->request = 0;
+
+	vnc_flush (vnc);
+}
+
+static
+void vnc_key_event (vnc_t *vnc, int down, unsigned long keysym)
+{
+	pce_key_t key;
+
+	key = vnc_map_key (keysym);
+
+	if (key == PCE_KEY_NONE) {
+		pce_log_deb ("vnc: unknown key 0x%04lx\n", keysym);
+		return;
+	}
+
+	trm_set_key (&vnc->trm, down ? PCE_KEY_EVENT_DOWN : PCE_KEY_EVENT_UP, key);
+}
+
+static
+void vnc_pointer_event (vnc_t *vnc, unsigned mask, int x, int y)
+{
+	unsigned but;
+
+	/* RFB: left, middle, right - PCE: left, right, middle */
+	but = (mask & 1) | ((mask & 4) >> 1) | ((mask & 2) << 1);
+
+	if ((x == vnc->mouse_x) && (y == vnc->mouse_y) && (but == vnc->button)) {
+		return;
+	}
+
+	trm_set_mouse (&vnc->trm, x - vnc->mouse_x, y - vnc->mouse_y, but);
+
+	vnc->mouse_x = x;
+	vnc->mouse_y = y;
+	vnc->button = but;
+}
+
+/*
+ * Handle one client message
+ * Returns the number of bytes used, 0 if the message is incomplete or
+ * -1 on a protocol error.
+ */
+static
+int vnc_client_message (vnc_t *vnc, const unsigned char *buf, unsigned cnt)
+{
+	unsigned      i, n;
+	long          enc;
+
+	switch (buf[0]) {
+	case 0: /* SetPixelFormat */
+		if (cnt < 20) {
+			return (0);
+		}
+
+		if ((buf[7] == 0) || ((buf[4] != 8) && (buf[4] != 16) && (buf[4] != 32))) {
+			fprintf (stderr, "vnc: unsupported pixel format\n");
+			return (-1);
+		}
+
+		vnc_set_pixel_format (vnc, buf + 4);
+
+		vnc->dirty_cnt = 0;
+		vnc_add_dirty (vnc, 0, 0, vnc->trm.w, vnc->trm.h);
+
+		return (20);
+
+	case 2: /* SetEncodings */
+		if (cnt < 4) {
+			return (0);
+		}
+
+		n = vnc_get_uint16 (buf + 2);
+
+		if ((4 + 4 * n) > VNC_INP_MAX) {
+			return (-1);
+		}
+
+		if (cnt < (4 + 4 * n)) {
+			return (0);
+		}
+
+		vnc->hextile = 0;
+		vnc->desktop_size = 0;
+
+		for (i = 0; i < n; i++) {
+			enc = (long) vnc_get_uint32 (buf + 4 + 4 * i);
+
+			if (enc & 0x80000000) {
+				enc -= 0x100000000;
+			}
+
+			if (enc == VNC_ENC_HEXTILE) {
+				vnc->hextile = 1;
+			}
+			else if (enc == VNC_ENC_DESKTOP_SIZE) {
+				vnc->desktop_size = 1;
+			}
+		}
+
+		return (4 + 4 * n);
+
+	case 3: /* FramebufferUpdateRequest */
+		if (cnt < 10) {
+			return (0);
+		}
+
+		if (buf[1] == 0) {
+			vnc_add_dirty (vnc,
+				vnc_get_uint16 (buf + 2), vnc_get_uint16 (buf + 4),
+				vnc_get_uint16 (buf + 6), vnc_get_uint16 (buf + 8)
+			);
+		}
+
+		vnc->request = 1;
+
+		return (10);
+
+	case 4: /* KeyEvent */
+		if (cnt < 8) {
+			return (0);
+		}
+
+		vnc_key_event (vnc, buf[1] != 0, vnc_get_uint32 (buf + 4));
+
+		return (8);
+
+	case 5: /* PointerEvent */
+		if (cnt < 6) {
+			return (0);
+		}
+
+		vnc_pointer_event (vnc, buf[1], vnc_get_uint16 (buf + 2), vnc_get_uint16 (buf + 4));
+
+		return (6);
+
+	case 6: /* ClientCutText */
+		if (cnt < 8) {
+			return (0);
+		}
+
+		vnc->inp_skip = vnc_get_uint32 (buf + 4);
+
+		return (8);
+	}
+
+	fprintf (stderr, "vnc: unknown message (%u)\n", buf[0]);
+
+	return (-1);
+}
+
+/*
+ * Handle the buffered input
+ * Returns non-zero on a protocol error.
+ */
+static
+int vnc_process (vnc_t *vnc)
+{
+	int           r;
+	unsigned      i;
+	unsigned char *buf;
+
+	i = 0;
+	buf = vnc->inp;
+
+	while (i < vnc->inp_cnt) {
+		if (vnc->inp_skip > 0) {
+			r = vnc->inp_cnt - i;
+
+			if ((unsigned long) r > vnc->inp_skip) {
+				r = vnc->inp_skip;
+			}
+
+			vnc->inp_skip -= r;
+		}
+		else if (vnc->state == VNC_STATE_VERSION) {
+			if ((vnc->inp_cnt - i) < 12) {
+				break;
+			}
+
+			if (memcmp (buf + i, "RFB 003.", 8) != 0) {
+				return (1);
+			}
+
+			vnc->version = strtoul ((const char *) buf + i + 8, NULL, 10);
+
+			if (vnc->version >= 7) {
+				vnc->version = (vnc->version >= 8) ? 8 : 7;
+
+				/* one security type: none */
+				vnc_out_uint8 (vnc, 1);
+				vnc_out_uint8 (vnc, 1);
+
+				vnc->state = VNC_STATE_SECURITY;
+			}
+			else {
+				vnc->version = 3;
+
+				vnc_out_uint32 (vnc, 1);
+
+				vnc->state = VNC_STATE_INIT;
+			}
+
+			r = 12;
+		}
+		else if (vnc->state == VNC_STATE_SECURITY) {
+			if (buf[i] != 1) {
+				return (1);
+			}
+
+			if (vnc->version >= 8) {
+				vnc_out_uint32 (vnc, 0);
+			}
+
+			vnc->state = VNC_STATE_INIT;
+
+			r = 1;
+		}
+		else if (vnc->state == VNC_STATE_INIT) {
+			vnc_send_server_init (vnc);
+
+			vnc->state = VNC_STATE_NORMAL;
+
+			r = 1;
+		}
+		else {
+			r = vnc_client_message (vnc, buf + i, vnc->inp_cnt - i);
+
+			if (r < 0) {
+				return (1);
+			}
+
+			if (r == 0) {
+				break;
+			}
+		}
+
+		i += r;
+	}
+
+	if (i > 0) {
+		vnc->inp_cnt -= i;
+
+		if (vnc->inp_cnt > 0) {
+			memmove (vnc->inp, vnc->inp + i, vnc->inp_cnt);
+		}
+	}
+
+	return (0);
+}
+
+static
+void vnc_accept (vnc_t *vnc)
+{
+	int fd, val;
+
+	if (vnc->listen_fd < 0) {
+		return;
+	}
+
+	fd = accept (vnc->listen_fd, NULL, NULL);
+
+	if (fd < 0) {
+		return;
+	}
+
+	if (vnc->fd >= 0) {
+		/* only one client at a time */
+		close (fd);
+		return;
+	}
+
+	fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+	if (vnc->unix_path == NULL) {
+		val = 1;
+		setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof (val));
+	}
+
+	vnc->fd = fd;
+	vnc->state = VNC_STATE_VERSION;
+
+	vnc->inp_cnt = 0;
+	vnc->inp_skip = 0;
+	vnc->out_cnt = 0;
+	vnc->out_failed = 0;
+
+	vnc->hextile = 0;
+	vnc->desktop_size = 0;
+	vnc->request = 0;
+
+	vnc->mouse_x = 0;
+	vnc->mouse_y = 0;
+	vnc->button = 0;
+
+	vnc->dirty_cnt = 0;
+	vnc_add_dirty (vnc, 0, 0, vnc->trm.w, vnc->trm.h);
+
+	vnc_out_buf (vnc, "RFB 003.008\n", 12);
+	vnc_flush (vnc);
+}
+
+static
+void vnc_read (vnc_t *vnc)
+{
+	ssize_t r;
+
+	while (vnc->fd >= 0) {
+		if (vnc->inp_cnt >= VNC_INP_MAX) {
+			vnc_close_client (vnc);
+			return;
+		}
+
+		r = recv (vnc->fd, vnc->inp + vnc->inp_cnt, VNC_INP_MAX - vnc->inp_cnt, 0);
+
+		if (r < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				return;
+			}
+			else if (errno == EINTR) {
+				continue;
+			}
+		}
+
+		if (r <= 0) {
+			vnc_close_client (vnc);
+			return;
+		}
+
+		vnc->inp_cnt += r;
+
+		if (vnc_process (vnc)) {
+			fprintf (stderr, "vnc: protocol error\n");
+			vnc_close_client (vnc);
+			return;
+		}
+	}
+}
+
+static
+void vnc_check (vnc_t *vnc)
+{
+	vnc_accept (vnc);
+
+	if (vnc->fd < 0) {
+		return;
+	}
+
+	vnc_read (vnc);
+	vnc_flush (vnc);
+	vnc_send_update (vnc);
+}
+
+static
+void vnc_update (vnc_t *vnc)
+{
+	unsigned i;
+
+	if (vnc->fd < 0) {
+		return;
+	}
+
+	for (i = 0; i < vnc->trm.rect_cnt; i++) {
+		vnc_add_dirty (vnc,
+			vnc->trm.rect[i].x, vnc->trm.rect[i].y,
+			vnc->trm.rect[i].w, vnc->trm.rect[i].h
+		);
+	}
+
+	vnc_send_update (vnc);
+}
+
+static
+int vnc_open (vnc_t *vnc, unsigned w, unsigned h)
+{
+	(void) vnc;
+	(void) w;
+	(void) h;
+
+	return (0);
+}
+
+static
+int vnc_close (vnc_t *vnc)
+{
+	vnc_close_client (vnc);
+
+	return (0);
+}
+
+static
+int vnc_set_msg_trm (vnc_t *vnc, const char *msg, const char *val)
+{
+	(void) vnc;
+	(void) val;
+
+	if (strcmp (msg, "term.grab") == 0) {
+		return (0);
+	}
+	else if (strcmp (msg, "term.release") == 0) {
+		return (0);
+	}
+	else if (strcmp (msg, "term.title") == 0) {
+		return (0);
+	}
+	else if (strcmp (msg, "term.fullscreen.toggle") == 0) {
+		return (0);
+	}
+	else if (strcmp (msg, "term.fullscreen") == 0) {
+		return (0);
+	}
+
+	return (-1);
+}
+
+static
+int vnc_listen_tcp (vnc_t *vnc, const char *addr, unsigned port)
+{
+	int                fd, val;
+	struct sockaddr_in sa;
+
+	memset (&sa, 0, sizeof (sa));
+
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons (port);
+
+	if (inet_pton (AF_INET, addr, &sa.sin_addr) != 1) {
+		fprintf (stderr, "vnc: bad address (%s)\n", addr);
+		return (1);
+	}
+
+	if ((fd = socket (AF_INET, SOCK_STREAM, 0)) < 0) {
+		return (1);
+	}
+
+	val = 1;
+	setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof (val));
+
+	if (bind (fd, (struct sockaddr *) &sa, sizeof (sa)) < 0) {
+		fprintf (stderr, "vnc: can't bind to %s:%u\n", addr, port);
+		close (fd);
+		return (1);
+	}
+
+	vnc->listen_fd = fd;
+
+	return (0);
+}
+
+static
+int vnc_listen_unix (vnc_t *vnc, const char *path)
+{
+	int                fd;
+	struct sockaddr_un sa;
+
+	memset (&sa, 0, sizeof (sa));
+
+	sa.sun_family = AF_UNIX;
+
+	if (strlen (path) >= sizeof (sa.sun_path)) {
+		return (1);
+	}
+
+	strcpy (sa.sun_path, path);
+
+	if ((fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		return (1);
+	}
+
+	unlink (path);
+
+	if (bind (fd, (struct sockaddr *) &sa, sizeof (sa)) < 0) {
+		fprintf (stderr, "vnc: can't bind to %s\n", path);
+		close (fd);
+		return (1);
+	}
+
+	vnc->listen_fd = fd;
+
+	return (0);
+}
+
+static
+void vnc_free (vnc_t *vnc)
+{
+	vnc_close_client (vnc);
+
+	if (vnc->listen_fd >= 0) {
+		close (vnc->listen_fd);
+		vnc->listen_fd = -1;
+	}
+
+	if (vnc->unix_path != NULL) {
+		unlink (vnc->unix_path);
+		free (vnc->unix_path);
+		vnc->unix_path = NULL;
+	}
+
+	free (vnc->out);
+	free (vnc->rgb);
+
+	vnc->out = NULL;
+	vnc->rgb = NULL;
+}
+
+static
+void vnc_del (vnc_t *vnc)
+{
+	if (vnc != NULL) {
+		vnc_free (vnc);
+		free (vnc);
+	}
+}
+
+static
+int vnc_init (vnc_t *vnc, const char *str)
+{
+	unsigned port;
+	char     *addr;
+	int      r;
+
+	trm_init (&vnc->trm, vnc);
+
+	vnc->trm.del = (void *) vnc_del;
+	vnc->trm.open = (void *) vnc_open;
+	vnc->trm.close = (void *) vnc_close;
+	vnc->trm.set_msg_trm = (void *) vnc_set_msg_trm;
+	vnc->trm.update = (void *) vnc_update;
+	vnc->trm.check = (void *) vnc_check;
+
+	vnc->listen_fd = -1;
+	vnc->fd = -1;
+	vnc->unix_path = NULL;
+
+	vnc->state = VNC_STATE_NONE;
+	vnc->version = 8;
+
+	vnc->inp_cnt = 0;
+	vnc->inp_skip = 0;
+
+	vnc->out = NULL;
+	vnc->out_cnt = 0;
+	vnc->out_max = 0;
+	vnc->out_failed = 0;
+
+	vnc->hextile = 0;
+	vnc->desktop_size = 0;
+
+	vnc->fb_w = 0;
+	vnc->fb_h = 0;
+
+	vnc->request = 0;
+	vnc->dirty_cnt = 0;
+
+	vnc->mouse_x = 0;
+	vnc->mouse_y = 0;
+	vnc->button = 0;
+
+	vnc->rgb = NULL;
+	vnc->rgb_cnt = 0;
+
+	vnc->unix_path = drv_get_option (str, "unix");
+
+	if (vnc->unix_path != NULL) {
+		r = vnc_listen_unix (vnc, vnc->unix_path);
+
+		if (r == 0) {
+			fprintf (stderr, "vnc: listening on %s\n", vnc->unix_path);
+		}
+	}
+	else {
+		port = drv_get_option_uint (str, "port", 5900);
+		addr = drv_get_option (str, "addr");
+
+		r = vnc_listen_tcp (vnc, (addr != NULL) ? addr : "127.0.0.1", port);
+
+		if (r == 0) {
+			fprintf (stderr, "vnc: listening on %s:%u\n",
+				(addr != NULL) ? addr : "127.0.0.1", port
+			);
+		}
+
+		free (addr);
+	}
+
+	if (r) {
+		return (1);
+	}
+
+	if (listen (vnc->listen_fd, 1) < 0) {
+		return (1);
+	}
+
+	fcntl (vnc->listen_fd, F_SETFL, fcntl (vnc->listen_fd, F_GETFL) | O_NONBLOCK);
+
+	return (0);
+}
+
+terminal_t *vnc_new (const char *str)
+{
+	vnc_t *vnc;
+
+	if ((vnc = malloc (sizeof (vnc_t))) == NULL) {
+		return (NULL);
+	}
+
+	if (vnc_init (vnc, str)) {
+		vnc_del (vnc);
+		return (NULL);
+	}
+
+	return (&vnc->trm);
+}
@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   sdl_sim/vnc.h                                                *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#ifndef PCE_VIDEO_VNC_H
+#define PCE_VIDEO_VNC_H 1
+
+
+#include <drivers/video/terminal.h>
+
+
+#define VNC_INP_MAX 1024
+
+
+/*!***************************************************************************
+ * @short The VNC terminal structure
+ *
+ * The terminal is an RFB server for one client at a time. Only areas that
+ * changed since the last update are sent, as Hextile or Raw rectangles.
+ *****************************************************************************/
+typedef struct {
+	terminal_t    trm;
+
+	int           listen_fd;
+	int           fd;
+	char          *unix_path;
+
+	unsigned      state;
+
+	/* the minor RFB protocol version (3, 7 or 8) */
+	unsigned      version;
+
+	unsigned char inp[VNC_INP_MAX];
+	unsigned      inp_cnt;
+
+	/* the number of input bytes to discard (client cut text) */
+	unsigned long inp_skip;
+
+	unsigned char *out;
+	unsigned long out_cnt;
+	unsigned long out_max;
+
+	/* the output buffer could not be grown, the client is closed */
+	char          out_failed;
+
+	/* the client pixel format */
+	unsigned      bpp;
+	char          big_endian;
+	unsigned      max[3];
+	unsigned      shift[3];
+
+	/* the encodings supported by the client */
+	char          hextile;
+	char          desktop_size;
+
+	/* the frame buffer size that the client knows about */
+	unsigned      fb_w;
+	unsigned      fb_h;
+
+	/* the client has requested an update */
+	char          request;
+
+	unsigned      dirty_cnt;
+	trm_rect_t    dirty[TRM_RECT_MAX];
+
+	int           mouse_x;
+	int           mouse_y;
+	unsigned      button;
+
+	unsigned char *rgb;
+	unsigned long rgb_cnt;
+} vnc_t;
+
+
+/*!***************************************************************************
+ * @short Create a new VNC terminal
+ * @param str The driver options, e.g. "vnc:port=5901" or
+ *            "vnc:unix=/tmp/mac.sock"
+ *****************************************************************************/
+terminal_t *vnc_new (const char *str);
+
+
+#endif
@@ -901,72 +901,174 @@ void e6522_reset (e6522_t *via)
 #endif
 }
 
+/*
+ * Timer 1 interrupt event
+ */
 static
-void e6522_clock_t1 (e6522_t *via)
+void e6522_t1_timeout (e6522_t *via)
 {
-	if (via->t1_reload) {
-		via->t1_reload = 0;
-		via->t1_timeout = 0;
-		via->t1_val = via->t1_latch;
-		return;
-	}
+	if (via->acr & 0x40) {
+		/* free running */
 
-	via->t1_val = (via->t1_val - 1) & 0xffff;
+		e6522_set_ifr (via, via->ifr | E6522_IFR_T1);
 
-	if (via->t1_val == 0) {
-		via->t1_timeout = 1;
+		via->t1_reload = 1;
 	}
-	else if (via->t1_timeout) {
-		via->t1_timeout = 0;
-
-		if (via->acr & 0x40) {
-			/* free running */
+	else {
+		/* one shot */
 
+		if (via->t1_hot) {
+			via->t1_hot = 0;
 			e6522_set_ifr (via, via->ifr | E6522_IFR_T1);
+		}
+	}
+}
 
-			via->t1_reload = 1;
+/*
+ * Advance timer 1 by n clock ticks
+ *
+ * The counter is decremented once per tick. The tick after the counter
+ * reaches 0 is the timeout. In free running mode the timeout is followed
+ * by a reload tick, so the period is (latch + 2) ticks.
+ */
+static
+void e6522_clock_t1 (e6522_t *via, unsigned long n)
+{
+	unsigned long val;
+
+	while (n > 0) {
+		if (via->t1_reload) {
+			via->t1_reload = 0;
+			via->t1_timeout = 0;
+			via->t1_val = via->t1_latch;
+			n -= 1;
+			continue;
 		}
-		else {
-			/* one shot */
 
-			if (via->t1_hot) {
-				via->t1_hot = 0;
-				e6522_set_ifr (via, via->ifr | E6522_IFR_T1);
+		if (via->t1_timeout) {
+			via->t1_val = (via->t1_val - 1) & 0xffff;
+			n -= 1;
+
+			if (via->t1_val == 0) {
+				continue;
+			}
+
+			via->t1_timeout = 0;
+
+			e6522_t1_timeout (via);
+
+			if (via->t1_reload) {
+				/* skip complete periods, the IFR is already set */
+				val = (via->t1_latch == 0) ? 0x10000 : via->t1_latch;
+				n %= val + 2;
+			}
+			else {
+				/* one shot: no more interrupts until rewritten */
+				n &= 0xffff;
 			}
+
+			continue;
 		}
+
+		val = (via->t1_val == 0) ? 0x10000 : via->t1_val;
+
+		if (n < val) {
+			via->t1_val = (via->t1_val - n) & 0xffff;
+			return;
+		}
+
+		n -= val;
+
+		via->t1_val = 0;
+		via->t1_timeout = 1;
 	}
 }
 
+/*
+ * Advance timer 2 by n clock ticks
+ */
 static
-void e6522_clock_t2 (e6522_t *via)
+void e6522_clock_t2 (e6522_t *via, unsigned long n)
 {
-	via->t2_val = (via->t2_val - 1) & 0xffff;
+	unsigned long val;
 
-	if (via->t2_val == 0) {
+	while (n > 0) {
+		if (via->t2_timeout) {
+			via->t2_val = (via->t2_val - 1) & 0xffff;
+			n -= 1;
+
+			if (via->t2_val == 0) {
+				continue;
+			}
+
+			via->t2_timeout = 0;
+
+			if ((via->acr & 0x20) == 0) {
+				/* one shot */
+
+				if (via->t2_hot) {
+					via->t2_hot = 0;
+					e6522_set_ifr (via, via->ifr | E6522_IFR_T2);
+				}
+			}
+
+			n &= 0xffff;
+
+			continue;
+		}
+
+		val = (via->t2_val == 0) ? 0x10000 : via->t2_val;
+
+		if (n < val) {
+			via->t2_val = (via->t2_val - n) & 0xffff;
+			return;
+		}
+
+		n -= val;
+
+		via->t2_val = 0;
 		via->t2_timeout = 1;
 	}
-	else if (via->t2_timeout) {
-		via->t2_timeout = 0;
+}
 
-		if (via->acr & 0x20) {
-			/* free running */
-			;
+/*
+ * Get the number of clock ticks until a timer changes the interrupt
+ * flags, or E6522_CLOCK_NONE if no timer interrupt is pending.
+ */
+unsigned long e6522_get_clock_next (const e6522_t *via)
+{
+	unsigned long n1, n2;
+
+	n1 = E6522_CLOCK_NONE;
+
+	if ((via->acr & 0x40) || via->t1_hot) {
+		if (via->t1_reload) {
+			n1 = (via->t1_latch == 0) ? 0x10002 : ((unsigned long) via->t1_latch + 2);
+		}
+		else if (via->t1_timeout) {
+			n1 = (via->t1_val == 1) ? 2 : 1;
 		}
 		else {
-			/* one shot */
+			n1 = (via->t1_val == 0) ? 0x10001 : ((unsigned long) via->t1_val + 1);
+		}
+	}
 
-			if (via->t2_hot) {
-				via->t2_hot = 0;
-				e6522_set_ifr (via, via->ifr | E6522_IFR_T2);
-			}
+	n2 = E6522_CLOCK_NONE;
+
+	if (((via->acr & 0x20) == 0) && via->t2_hot) {
+		if (via->t2_timeout) {
+			n2 = (via->t2_val == 1) ? 2 : 1;
+		}
+		else {
+			n2 = (via->t2_val == 0) ? 0x10001 : ((unsigned long) via->t2_val + 1);
 		}
 	}
+
+	return ((n1 < n2) ? n1 : n2);
 }
 
-void e6522_clock (e6522_t *via, unsigned n)
+void e6522_clock (e6522_t *via, unsigned long n)
 {
-	while (n-- > 0) {
-		e6522_clock_t1 (via);
-		e6522_clock_t2 (via);
-	}
+	e6522_clock_t1 (via, n);
+	e6522_clock_t2 (via, n);
 }
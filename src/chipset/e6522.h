@@ -27,6 +27,10 @@
 #define PCE_CHIPSET_E6522_H 1
 
 
+/* returned by e6522_get_clock_next() if no timer interrupt is pending */
+#define E6522_CLOCK_NONE 0x20000UL
+
+
 typedef struct {
 	unsigned       addr_shift;
 
@@ -124,7 +128,13 @@ void e6522_set_uint32 (e6522_t *via, unsigned long addr, unsigned long val);
 
 void e6522_reset (e6522_t *via);
 
-void e6522_clock (e6522_t *via, unsigned n);
+/*
+ * Get the number of clock ticks until a timer changes the interrupt
+ * flags, or E6522_CLOCK_NONE if no timer interrupt is pending.
+ */
+unsigned long e6522_get_clock_next (const e6522_t *via);
+
+void e6522_clock (e6522_t *via, unsigned long n);
 
 
 #endif
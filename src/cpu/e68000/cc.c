@@ -26,254 +26,248 @@
 //We need speed here!
 #pragma GCC optimize ("O3")
 
-void e68_cc_set_nz_8 (e68000_t *c, uint8_t msk, uint8_t val)
+/*
+ * Record a lazy condition code operation. If the pending operation
+ * owns flags that the new one does not set, it is computed first.
+ */
+static inline
+void e68_cc_set_lazy (e68000_t *c, unsigned op, uint16_t msk, uint32_t msb,
+	uint32_t d, uint32_t s1, uint32_t s2)
 {
-	uint16_t set = 0;
-
-	if ((val & 0xff) == 0) {
-		set |= E68_SR_Z;
-	}
-	else if (val & 0x80) {
-		set |= E68_SR_N;
+	if ((c->cc_op != E68_CC_NONE) && (c->cc_msk & ~msk)) {
+		e68_cc_flush (c);
 	}
 
-	c->sr &= (0xff00 | ~msk);
-	c->sr |= (set & msk);
+	c->cc_op = op;
+	c->cc_msk = msk;
+	c->cc_msb = msb;
+	c->cc_d = d;
+	c->cc_s1 = s1;
+	c->cc_s2 = s2;
 }
 
-void e68_cc_set_nz_16 (e68000_t *c, uint8_t msk, uint16_t val)
+/*
+ * Compute NVZC from the pending operation
+ *
+ * addition:
+ *   c = (s1 & s2) | (~d & s1) | (~d & s2)
+ *   v = (~d & s1 & s2) | (d & ~s1 & ~s2)
+ *
+ * subtraction (s2 - s1):
+ *   c = (s1 & ~s2) | (d & ~s2) | (d & s1)
+ *   v = (~d & ~s1 & s2) | (d & s1 & ~s2)
+ */
+void e68_cc_flush (e68000_t *c)
 {
-	uint16_t set = 0;
+	uint16_t set;
+	uint32_t d, s1, s2, cy, v;
+
+	d = c->cc_d;
+	s1 = c->cc_s1;
+	s2 = c->cc_s2;
 
-	if ((val & 0xffff) == 0) {
+	set = 0;
+
+	if ((d & (c->cc_msb | (c->cc_msb - 1))) == 0) {
 		set |= E68_SR_Z;
 	}
-	else if (val & 0x8000) {
+	else if (d & c->cc_msb) {
 		set |= E68_SR_N;
 	}
 
-	c->sr &= (0xff00 | ~msk);
-	c->sr |= (set & msk);
+	if (c->cc_op == E68_CC_ADD) {
+		cy = (s1 & s2) | (~d & s1) | (~d & s2);
+		v = (~d & s1 & s2) | (d & ~s1 & ~s2);
+	}
+	else if (c->cc_op == E68_CC_SUB) {
+		cy = (s1 & ~s2) | (d & ~s2) | (d & s1);
+		v = (~d & ~s1 & s2) | (d & s1 & ~s2);
+	}
+	else {
+		cy = 0;
+		v = 0;
+	}
+
+	if (cy & c->cc_msb) {
+		set |= E68_SR_C;
+	}
+
+	if (v & c->cc_msb) {
+		set |= E68_SR_V;
+	}
+
+	c->sr &= ~c->cc_msk;
+	c->sr |= (set & c->cc_msk);
+
+	c->cc_op = E68_CC_NONE;
+}
+
+void e68_cc_set_nz_8 (e68000_t *c, uint8_t msk, uint8_t val)
+{
+	e68_cc_set_lazy (c, E68_CC_NZ, msk & E68_SR_NZVC, 0x80, val, 0, 0);
+}
+
+void e68_cc_set_nz_16 (e68000_t *c, uint8_t msk, uint16_t val)
+{
+	e68_cc_set_lazy (c, E68_CC_NZ, msk & E68_SR_NZVC, 0x8000, val, 0, 0);
 }
 
 void e68_cc_set_nz_32 (e68000_t *c, uint8_t msk, uint32_t val)
 {
-	uint16_t set = 0;
+	e68_cc_set_lazy (c, E68_CC_NZ, msk & E68_SR_NZVC, 0x80000000, val, 0, 0);
+}
 
-	if ((val & 0xffffffff) == 0) {
-		set |= E68_SR_Z;
+/*
+ * Set X after addition, c = (s1 & s2) | (~d & s1) | (~d & s2)
+ */
+static inline
+void e68_cc_set_add_x (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2, uint32_t msb)
+{
+	if (((s1 & s2) | (~d & s1) | (~d & s2)) & msb) {
+		c->sr |= E68_SR_X;
 	}
-	else if (val & 0x80000000) {
-		set |= E68_SR_N;
+	else {
+		c->sr &= ~E68_SR_X;
 	}
-
-	c->sr &= (0xff00 | ~msk);
-	c->sr |= (set & msk);
 }
 
 /*
- * Set XNVC after addition
- *
- * c = (s1 & s2) | (~d & s1) | (~d & s2)
- * v = (~d & s1 & s2) | (d & ~s1 & ~s2)
+ * Set X after subtraction, c = (s1 & ~s2) | (d & ~s2) | (d & s1)
  */
 static inline
-void e68_cc_set_add (e68000_t *c, unsigned d, unsigned s1, unsigned s2)
+void e68_cc_set_sub_x (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2, uint32_t msb)
 {
-	uint16_t set = 0;
-
-	d &= 1;
-	s1 &= 1;
-	s2 &= 1;
-
-	if (d) {
-		set |= E68_SR_N;
-
-		if (s1 && s2) {
-			set |= E68_SR_C | E68_SR_X;
-		}
-
-		if (!(s1 || s2)) {
-			set |= E68_SR_V;
-		}
+	if (((s1 & ~s2) | (d & ~s2) | (d & s1)) & msb) {
+		c->sr |= E68_SR_X;
 	}
 	else {
-		if (s1 || s2) {
-			set |= E68_SR_C | E68_SR_X;
-		}
-
-		if (s1 && s2) {
-			set |= E68_SR_V;
-		}
+		c->sr &= ~E68_SR_X;
 	}
-
-	c->sr &= ~(E68_SR_X | E68_SR_N | E68_SR_V | E68_SR_C);
-	c->sr |= set;
 }
 
 void e68_cc_set_add_8 (e68000_t *c, uint8_t d, uint8_t s1, uint8_t s2)
 {
-	e68_set_sr_z (c, (d & 0xff) == 0);
-	e68_cc_set_add (c, d >> 7, s1 >> 7, s2 >> 7);
+	e68_cc_set_add_x (c, d, s1, s2, 0x80);
+	e68_cc_set_lazy (c, E68_CC_ADD, E68_SR_NZVC, 0x80, d, s1, s2);
 }
 
 void e68_cc_set_add_16 (e68000_t *c, uint16_t d, uint16_t s1, uint16_t s2)
 {
-	e68_set_sr_z (c, (d & 0xffff) == 0);
-	e68_cc_set_add (c, d >> 15, s1 >> 15, s2 >> 15);
+	e68_cc_set_add_x (c, d, s1, s2, 0x8000);
+	e68_cc_set_lazy (c, E68_CC_ADD, E68_SR_NZVC, 0x8000, d, s1, s2);
 }
 
 void e68_cc_set_add_32 (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2)
 {
-	e68_set_sr_z (c, (d & 0xffffffff) == 0);
-	e68_cc_set_add (c, d >> 31, s1 >> 31, s2 >> 31);
+	e68_cc_set_add_x (c, d, s1, s2, 0x80000000);
+	e68_cc_set_lazy (c, E68_CC_ADD, E68_SR_NZVC, 0x80000000, d, s1, s2);
 }
 
-void e68_cc_set_addx_8 (e68000_t *c, uint8_t d, uint8_t s1, uint8_t s2)
+/*
+ * ADDX and SUBX only clear Z, so they need the previous flags and are
+ * computed right away.
+ */
+static
+void e68_cc_set_addx (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2, uint32_t msb)
 {
-	e68_cc_set_add (c, d >> 7, s1 >> 7, s2 >> 7);
+	e68_cc_sync (c);
 
-	if (d & 0xff) {
-		e68_set_sr_z (c, 0);
-	}
-}
+	c->cc_op = E68_CC_ADD;
+	c->cc_msk = E68_SR_NVC;
+	c->cc_msb = msb;
+	c->cc_d = d;
+	c->cc_s1 = s1;
+	c->cc_s2 = s2;
 
-void e68_cc_set_addx_16 (e68000_t *c, uint16_t d, uint16_t s1, uint16_t s2)
-{
-	e68_cc_set_add (c, d >> 15, s1 >> 15, s2 >> 15);
+	e68_cc_flush (c);
+
+	e68_cc_set_add_x (c, d, s1, s2, msb);
 
-	if (d & 0xffff) {
-		e68_set_sr_z (c, 0);
+	if (d & (msb | (msb - 1))) {
+		c->sr &= ~E68_SR_Z;
 	}
 }
 
-void e68_cc_set_addx_32 (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2)
+void e68_cc_set_addx_8 (e68000_t *c, uint8_t d, uint8_t s1, uint8_t s2)
 {
-	e68_cc_set_add (c, d >> 31, s1 >> 31, s2 >> 31);
-
-	if (d & 0xffffffff) {
-		e68_set_sr_z (c, 0);
-	}
+	e68_cc_set_addx (c, d, s1, s2, 0x80);
 }
 
-
-/*
- * Set NVC after subtraction (s2 - s1)
- *
- * c = (s1 & ~s2) | (d & ~s2) | (d & s1)
- * v = (~d & ~s1 & s2) | (d & s1 & ~s2)
- */
-static inline
-void e68_cc_set_sub (e68000_t *c, uint16_t msk, unsigned d, unsigned s1, unsigned s2)
+void e68_cc_set_addx_16 (e68000_t *c, uint16_t d, uint16_t s1, uint16_t s2)
 {
-	uint16_t set = 0;
-
-	d &= 1;
-	s1 &= 1;
-	s2 &= 1;
-
-	if (d) {
-		set |= E68_SR_N;
-
-		if (s1 || !s2) {
-			set |= E68_SR_C | E68_SR_X;
-		}
-
-		if (s1 && !s2) {
-			set |= E68_SR_V;
-		}
-	}
-	else {
-		if (s1 && !s2) {
-			set |= E68_SR_C | E68_SR_X;
-		}
-
-		if (!s1 && s2) {
-			set |= E68_SR_V;
-		}
-	}
+	e68_cc_set_addx (c, d, s1, s2, 0x8000);
+}
 
-	c->sr &= ~msk;
-	c->sr |= (set & msk);
+void e68_cc_set_addx_32 (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2)
+{
+	e68_cc_set_addx (c, d, s1, s2, 0x80000000);
 }
 
 void e68_cc_set_cmp_8 (e68000_t *c, uint8_t d, uint8_t s1, uint8_t s2)
 {
-	e68_cc_set_sub (c, E68_SR_NZVC, d >> 7, s1 >> 7, s2 >> 7);
-
-	if ((d & 0xff) == 0) {
-		c->sr |= E68_SR_Z;
-	}
+	e68_cc_set_lazy (c, E68_CC_SUB, E68_SR_NZVC, 0x80, d, s1, s2);
 }
 
 void e68_cc_set_cmp_16 (e68000_t *c, uint16_t d, uint16_t s1, uint16_t s2)
 {
-	e68_cc_set_sub (c, E68_SR_NZVC, d >> 15, s1 >> 15, s2 >> 15);
-
-	if ((d & 0xffff) == 0) {
-		c->sr |= E68_SR_Z;
-	}
+	e68_cc_set_lazy (c, E68_CC_SUB, E68_SR_NZVC, 0x8000, d, s1, s2);
 }
 
 void e68_cc_set_cmp_32 (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2)
 {
-	e68_cc_set_sub (c, E68_SR_NZVC, d >> 31, s1 >> 31, s2 >> 31);
-
-	if ((d & 0xffffffff) == 0) {
-		c->sr |= E68_SR_Z;
-	}
+	e68_cc_set_lazy (c, E68_CC_SUB, E68_SR_NZVC, 0x80000000, d, s1, s2);
 }
 
 void e68_cc_set_sub_8 (e68000_t *c, uint8_t d, uint8_t s1, uint8_t s2)
 {
-	e68_cc_set_sub (c, E68_SR_XNZVC, d >> 7, s1 >> 7, s2 >> 7);
-
-	if ((d & 0xff) == 0) {
-		c->sr |= E68_SR_Z;
-	}
+	e68_cc_set_sub_x (c, d, s1, s2, 0x80);
+	e68_cc_set_lazy (c, E68_CC_SUB, E68_SR_NZVC, 0x80, d, s1, s2);
 }
 
 void e68_cc_set_sub_16 (e68000_t *c, uint16_t d, uint16_t s1, uint16_t s2)
 {
-	e68_cc_set_sub (c, E68_SR_XNZVC, d >> 15, s1 >> 15, s2 >> 15);
-
-	if ((d & 0xffff) == 0) {
-		c->sr |= E68_SR_Z;
-	}
+	e68_cc_set_sub_x (c, d, s1, s2, 0x8000);
+	e68_cc_set_lazy (c, E68_CC_SUB, E68_SR_NZVC, 0x8000, d, s1, s2);
 }
 
 void e68_cc_set_sub_32 (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2)
 {
-	e68_cc_set_sub (c, E68_SR_XNZVC, d >> 31, s1 >> 31, s2 >> 31);
-
-	if ((d & 0xffffffff) == 0) {
-		c->sr |= E68_SR_Z;
-	}
+	e68_cc_set_sub_x (c, d, s1, s2, 0x80000000);
+	e68_cc_set_lazy (c, E68_CC_SUB, E68_SR_NZVC, 0x80000000, d, s1, s2);
 }
 
-void e68_cc_set_subx_8 (e68000_t *c, uint8_t d, uint8_t s1, uint8_t s2)
+static
+void e68_cc_set_subx (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2, uint32_t msb)
 {
-	e68_cc_set_sub (c, E68_SR_XNVC, d >> 7, s1 >> 7, s2 >> 7);
+	e68_cc_sync (c);
 
-	if (d & 0xff) {
+	c->cc_op = E68_CC_SUB;
+	c->cc_msk = E68_SR_NVC;
+	c->cc_msb = msb;
+	c->cc_d = d;
+	c->cc_s1 = s1;
+	c->cc_s2 = s2;
+
+	e68_cc_flush (c);
+
+	e68_cc_set_sub_x (c, d, s1, s2, msb);
+
+	if (d & (msb | (msb - 1))) {
 		c->sr &= ~E68_SR_Z;
 	}
 }
 
-void e68_cc_set_subx_16 (e68000_t *c, uint16_t d, uint16_t s1, uint16_t s2)
+void e68_cc_set_subx_8 (e68000_t *c, uint8_t d, uint8_t s1, uint8_t s2)
 {
-	e68_cc_set_sub (c, E68_SR_XNVC, d >> 15, s1 >> 15, s2 >> 15);
+	e68_cc_set_subx (c, d, s1, s2, 0x80);
+}
 
-	if (d & 0xffff) {
-		c->sr &= ~E68_SR_Z;
-	}
+void e68_cc_set_subx_16 (e68000_t *c, uint16_t d, uint16_t s1, uint16_t s2)
+{
+	e68_cc_set_subx (c, d, s1, s2, 0x8000);
 }
 
 void e68_cc_set_subx_32 (e68000_t *c, uint32_t d, uint32_t s1, uint32_t s2)
 {
-	e68_cc_set_sub (c, E68_SR_XNVC, d >> 31, s1 >> 31, s2 >> 31);
-
-	if (d & 0xffffffff) {
-		c->sr &= ~E68_SR_Z;
-	}
+	e68_cc_set_subx (c, d, s1, s2, 0x80000000);
 }
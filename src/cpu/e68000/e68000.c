@@ -49,6 +49,21 @@ void e68_init (e68000_t *c)
 	c->ram = NULL;
 	c->ram_cnt = 0;
 
+	c->rom = NULL;
+	c->rom_addr = 0;
+	c->rom_cnt = 0;
+
+	c->wr_addr = 0;
+	c->wr_cnt = 0;
+	c->wr_shift = 0;
+	c->wr_map = NULL;
+
+	c->jit = NULL;
+
+	c->optab = NULL;
+
+	e68_icache_init (c);
+
 	c->reset_ext = NULL;
 	c->reset = NULL;
 	c->reset_val = 0;
@@ -71,11 +86,13 @@ void e68_init (e68000_t *c)
 
 	c->supervisor = 1;
 	c->halt = 2;
+	c->attn = 1;
 
 	c->int_ipl = 0;
 	c->int_nmi = 0;
 
 	c->delay = 1;
+	c->clk_stop = 0;
 
 	c->except_cnt = 0;
 	c->except_addr = 0;
@@ -88,6 +105,7 @@ void e68_init (e68000_t *c)
 	e68_set_opcodes (c);
 
 	c->sr = E68_SR_S;
+	c->cc_op = E68_CC_NONE;
 
 	for (i = 0; i < 8; i++) {
 		e68_set_dreg32 (c, i, 0);
@@ -132,6 +150,11 @@ e68000_t *e68_new (void)
 
 void e68_free (e68000_t *c)
 {
+	e68_jit_free (c);
+	e68_icache_free (c);
+
+	free (c->optab);
+	c->optab = NULL;
 }
 
 void e68_del (e68000_t *c)
@@ -166,6 +189,34 @@ void e68_set_ram (e68000_t *c, unsigned char *ram, unsigned long cnt)
 
 	c->ram = ram;
 	c->ram_cnt = cnt;
+
+	e68_icache_set_ram (c);
+
+	/* writes behind the watch may have been missed */
+	e68_watch_all (c);
+}
+
+void e68_set_rom (e68000_t *c, const unsigned char *rom, unsigned long addr, unsigned long cnt)
+{
+	if (rom == NULL) {
+		cnt = 0;
+	}
+
+	c->rom = rom;
+	c->rom_addr = addr & 0x00ffffff;
+	c->rom_cnt = cnt;
+}
+
+void e68_set_watch (e68000_t *c, unsigned long addr, unsigned long cnt, unsigned shift, unsigned char *map)
+{
+	if (map == NULL) {
+		cnt = 0;
+	}
+
+	c->wr_addr = addr & 0x00ffffff;
+	c->wr_cnt = cnt;
+	c->wr_shift = shift;
+	c->wr_map = map;
 }
 
 void e68_set_reset_fct (e68000_t *c, void *ext, void *fct)
@@ -216,18 +267,21 @@ void e68_set_68000 (e68000_t *c)
 {
 	c->flags = 0;
 	e68_set_opcodes (c);
+	e68_icache_flush (c);
 }
 
 void e68_set_68010 (e68000_t *c)
 {
 	c->flags = E68_FLAG_68010;
 	e68_set_opcodes (c);
+	e68_icache_flush (c);
 }
 
 void e68_set_68020 (e68000_t *c)
 {
 	c->flags = E68_FLAG_68010 | E68_FLAG_68020 | E68_FLAG_NOADDR;
 	e68_set_opcodes_020 (c);
+	e68_icache_flush (c);
 }
 
 unsigned long e68_get_opcnt (const e68000_t *c)
@@ -253,11 +307,13 @@ unsigned e68_get_halt (e68000_t *c)
 void e68_set_halt (e68000_t *c, unsigned val)
 {
 	c->halt = val & 0x03;
+	c->attn = 1;
 }
 
 void e68_set_bus_error (e68000_t *c, int val)
 {
 	c->bus_error = (val != 0);
+	c->attn = 1;
 }
 
 unsigned e68_get_exception_cnt (const e68000_t *c)
@@ -544,7 +600,9 @@ void e68_set_sr (e68000_t *c, unsigned short val)
 		e68_set_supervisor (c, (val & E68_SR_S) != 0);
 	}
 
+	c->cc_op = E68_CC_NONE;
 	c->sr = val & E68_SR_MASK;
+	c->attn = 1;
 }
 
 static
@@ -555,6 +613,7 @@ void e68_double_exception (e68000_t *c, unsigned vct, const char *name)
 	);
 
 	c->halt = 1;
+	c->attn = 1;
 }
 
 static
@@ -772,6 +831,7 @@ void e68_interrupt (e68000_t *c, unsigned level)
 	}
 
 	c->int_ipl = level;
+	c->attn = 1;
 }
 
 static
@@ -820,36 +880,16 @@ void e68_reset (e68000_t *c)
 	c->bus_error = 0;
 	c->exception = 0;
 
+	e68_icache_flush (c);
+
 	e68_exception_reset (c);
 
 	e68_set_reset (c, 0);
 }
 
-void e68_execute (e68000_t *c)
+static inline
+void e68_check_intr (e68000_t *c)
 {
-	if (c->halt == 0) {
-		c->last_pc[++c->last_pc_idx & (E68_LAST_PC_CNT - 1)] = e68_get_pc (c);
-		c->bus_error = 0;
-		c->trace_sr = e68_get_sr (c);
-
-		c->ir[0] = c->ir[1];
-
-		c->opcodes[(c->ir[0] >> 6) & 0x3ff] (c);
-
-		c->oprcnt += 1;
-
-		if (c->trace_sr & E68_SR_T) {
-			e68_exception_trace (c);
-		}
-	}
-	else {
-		e68_set_clk (c, 4);
-
-		if (c->halt & ~1U) {
-			return;
-		}
-	}
-
 	if (c->int_nmi) {
 		c->halt &= ~1U;
 		e68_exception_avec (c, 7);
@@ -881,9 +921,101 @@ void e68_execute (e68000_t *c)
 	}
 }
 
+/*
+ * Recompute the attention flag after the checks in e68_execute()
+ */
+static inline
+void e68_update_attn (e68000_t *c)
+{
+	c->attn = c->halt || c->int_nmi || c->bus_error || (c->sr & E68_SR_T);
+
+	if (c->int_ipl > e68_get_iml (c)) {
+		c->attn = 1;
+	}
+}
+
+/*
+ * Execute one instruction without the checks in e68_execute(). Only
+ * valid while the attention flag is clear.
+ */
+static inline
+void e68_execute_fast (e68000_t *c)
+{
+#ifndef E68_LEAN
+	c->last_pc[++c->last_pc_idx & (E68_LAST_PC_CNT - 1)] = e68_get_pc (c);
+#else
+	/* keep e68_get_last_pc (c, 0) valid for exception logging */
+	c->last_pc[c->last_pc_idx & (E68_LAST_PC_CNT - 1)] = e68_get_pc (c);
+#endif
+
+	c->ir[0] = c->ir[1];
+
+	if (c->ic != NULL) {
+		e68_icache_get (c) (c);
+	}
+	else {
+		c->opcodes[(c->ir[0] >> 6) & 0x3ff] (c);
+	}
+
+#ifndef E68_LEAN
+	c->oprcnt += 1;
+#endif
+
+	if (c->attn) {
+		/* raised by the instruction */
+		e68_check_intr (c);
+		e68_update_attn (c);
+	}
+}
+
+void e68_execute (e68000_t *c)
+{
+	if (c->halt == 0) {
+		c->last_pc[++c->last_pc_idx & (E68_LAST_PC_CNT - 1)] = e68_get_pc (c);
+		c->bus_error = 0;
+		/* only the T bit is needed, don't compute the condition codes */
+		c->trace_sr = c->sr;
+
+		c->ir[0] = c->ir[1];
+
+		if (c->ic != NULL) {
+			e68_icache_get (c) (c);
+		}
+		else {
+			c->opcodes[(c->ir[0] >> 6) & 0x3ff] (c);
+		}
+
+		c->oprcnt += 1;
+
+		if (c->trace_sr & E68_SR_T) {
+			e68_exception_trace (c);
+		}
+	}
+	else {
+		e68_set_clk (c, 4);
+
+		if (c->halt & ~1U) {
+			return;
+		}
+	}
+
+	e68_check_intr (c);
+}
+
 void e68_clock (e68000_t *c, unsigned long n)
 {
+	c->clk_stop = 0;
+
 	while (n >= c->delay) {
+		if ((c->jit != NULL) && e68_jit_exec (c, &n)) {
+			if (c->clk_stop) {
+				c->clk_stop = 0;
+				return;
+			}
+
+			continue;
+		}
+
 		n -= c->delay;
 
 		c->clkcnt += c->delay;
@@ -898,8 +1030,63 @@ void e68_clock (e68000_t *c, unsigned long n)
 			fflush (stderr);
 			break;
 		}
+
+		if (c->clk_stop) {
+			c->clk_stop = 0;
+			return;
+		}
 	}
 
 	c->clkcnt += n;
 	c->delay -= n;
 }
+
+void e68_run_cycles (e68000_t *c, unsigned long n)
+{
+	c->clk_stop = 0;
+
+	while (n >= c->delay) {
+		if ((c->jit != NULL) && (c->attn == 0) && e68_jit_exec (c, &n)) {
+			if (c->clk_stop) {
+				c->clk_stop = 0;
+				return;
+			}
+
+			continue;
+		}
+
+		n -= c->delay;
+
+		c->clkcnt += c->delay;
+		c->delay = 0;
+
+		if (c->attn) {
+			e68_execute (c);
+			e68_update_attn (c);
+		}
+		else {
+			e68_execute_fast (c);
+		}
+
+		if (c->delay == 0) {
+			fprintf (stderr, "warning: delay == 0 at %08lx\n",
+				(unsigned long) e68_get_pc (c)
+			);
+			fflush (stderr);
+			break;
+		}
+
+		if (c->clk_stop) {
+			c->clk_stop = 0;
+			return;
+		}
+	}
+
+	c->clkcnt += n;
+	c->delay -= n;
+}
+
+void e68_clock_stop (e68000_t *c)
+{
+	c->clk_stop = 1;
+}
@@ -46,6 +46,16 @@ struct e68000_s;
 
 #define E68_LAST_PC_CNT 32
 
+/*
+ * The lean core doesn't update the last PC history and the instruction
+ * counter in e68_run_cycles(), only the most recent last PC is kept.
+ * e68_execute() and e68_clock() still do, so they can be used for
+ * debugging.
+ */
+#if !defined(SDL_SIM) && !defined(E68_LEAN)
+#define E68_LEAN 1
+#endif
+
 #define E68_SR_C 0x0001
 #define E68_SR_V 0x0002
 #define E68_SR_Z 0x0004
@@ -55,6 +65,16 @@ struct e68000_s;
 #define E68_SR_S 0x2000
 #define E68_SR_T 0x8000
 
+/*
+ * Lazy condition codes. The N, Z, V and C flags of the last arithmetic
+ * operation are only computed when they are needed. X is always kept
+ * up to date in sr.
+ */
+#define E68_CC_NONE 0
+#define E68_CC_NZ   1
+#define E68_CC_ADD  2
+#define E68_CC_SUB  3
+
 #define e68_get_dreg8(c, n) ((c)->dreg[(n) & 7] & 0xff)
 #define e68_get_dreg16(c, n) ((c)->dreg[(n) & 7] & 0xffff)
 #define e68_get_dreg32(c, n) ((c)->dreg[(n) & 7] & 0xffffffff)
@@ -65,8 +85,8 @@ struct e68000_s;
 #define e68_get_ir_pc(c) ((c)->ir_pc & 0xffffffff)
 #define e68_get_usp(c) (((c)->supervisor ? (c)->usp : (c)->areg[7]) & 0xffffffff)
 #define e68_get_ssp(c) (((c)->supervisor ? (c)->areg[7] : (c)->ssp) & 0xffffffff)
-#define e68_get_sr(c) ((c)->sr & 0xffff)
-#define e68_get_ccr(c) ((c)->sr & 0xff)
+#define e68_get_sr(c) (e68_cc_sync (c), (c)->sr & 0xffff)
+#define e68_get_ccr(c) (e68_cc_sync (c), (c)->sr & 0xff)
 #define e68_get_vbr(c) ((c)->vbr & 0xffffffff)
 #define e68_get_sfc(c) ((c)->sfc & 0x00000003)
 #define e68_get_dfc(c) ((c)->dfc & 0x00000003)
@@ -76,22 +96,23 @@ struct e68000_s;
 #define e68_get_iml(c) (((c)->sr >> 8) & 7)
 
 #define e68_set_pc(c, v) do { (c)->pc = (v) & 0xffffffff; } while (0)
-#define e68_set_ir_pc(c, v) do { (c)->ir_pc = (v) & 0xffffffff; } while (0)
+#define e68_set_ir_pc(c, v) do { (c)->ir_pc = (v) & 0xffffffff; e68_icache_jump (c); } while (0)
 #define e68_set_vbr(c, v) do { (c)->vbr = (v) & 0xffffffff; } while (0)
 #define e68_set_sfc(c, v) do { (c)->sfc = (v) & 0x00000003; } while (0)
 #define e68_set_dfc(c, v) do { (c)->dfc = (v) & 0x00000003; } while (0)
 #define e68_set_cacr(c, v) do { (c)->cacr = (v) & 0xffffffff; } while (0)
 #define e68_set_caar(c, v) do { (c)->cacr = (v) & 0xffffffff; } while (0)
 
-#define e68_get_sr_c(c) (((c)->sr & E68_SR_C) != 0)
-#define e68_get_sr_v(c) (((c)->sr & E68_SR_V) != 0)
-#define e68_get_sr_z(c) (((c)->sr & E68_SR_Z) != 0)
-#define e68_get_sr_n(c) (((c)->sr & E68_SR_N) != 0)
+#define e68_get_sr_c(c) (e68_cc_sync (c), ((c)->sr & E68_SR_C) != 0)
+#define e68_get_sr_v(c) (e68_cc_sync (c), ((c)->sr & E68_SR_V) != 0)
+#define e68_get_sr_z(c) (e68_cc_sync (c), ((c)->sr & E68_SR_Z) != 0)
+#define e68_get_sr_n(c) (e68_cc_sync (c), ((c)->sr & E68_SR_N) != 0)
 #define e68_get_sr_x(c) (((c)->sr & E68_SR_X) != 0)
 #define e68_get_sr_s(c) (((c)->sr & E68_SR_S) != 0)
 #define e68_get_sr_t(c) (((c)->sr & E68_SR_T) != 0)
 
 #define e68_set_cc(c, m, v) do { \
+		e68_cc_sync (c); \
 		if (v) (c)->sr |= (m); else (c)->sr &= ~(m); \
 	} while (0)
 
@@ -108,6 +129,36 @@ struct e68000_s;
 typedef void (*e68_opcode_f) (struct e68000_s *c);
 
 
+/*
+ * Instruction cache. Each entry holds the handler and the instruction
+ * words starting at a given PC. Only code in RAM and in the ROM region
+ * registered with e68_icache_set_rom() is cached. Writes to RAM through
+ * the CPU invalidate the affected entries, all other writers must call
+ * e68_icache_write() or e68_icache_flush().
+ */
+#ifndef E68_ICACHE_CNT
+#define E68_ICACHE_CNT 1024
+#endif
+
+#define E68_ICACHE_WORDS 8
+#define E68_ICACHE_SHIFT 6
+
+typedef struct {
+	uint32_t       addr;
+	uint32_t       size;
+	e68_opcode_f   op;
+	uint16_t       ir[E68_ICACHE_WORDS];
+} e68_icache_ent_t;
+
+typedef struct {
+	uint32_t         rom_addr;
+	uint32_t         rom_size;
+	e68_icache_ent_t ent[E68_ICACHE_CNT];
+} e68_icache_t;
+
+typedef struct e68_jit_s e68_jit_t;
+
+
 typedef struct e68000_s {
 	unsigned       flags;
 
@@ -124,6 +175,23 @@ typedef struct e68000_s {
 	unsigned char  *ram;
 	unsigned long  ram_cnt;
 
+	const unsigned char *rom;
+	uint32_t       rom_addr;
+	unsigned long  rom_cnt;
+
+	uint32_t       wr_addr;
+	uint32_t       wr_cnt;
+	unsigned       wr_shift;
+	unsigned char  *wr_map;
+
+	e68_icache_t   *ic;
+	unsigned char  *ic_page;
+	uint32_t       ic_addr;
+	uint32_t       ic_size;
+	const uint16_t *ic_ir;
+
+	e68_jit_t      *jit;
+
 	void           *reset_ext;
 	void           (*reset) (void *ext, unsigned char val);
 	unsigned char  reset_val;
@@ -150,6 +218,13 @@ typedef struct e68000_s {
 	uint32_t       ir_pc;
 	uint16_t       ir[3];
 	uint16_t       sr;
+
+	unsigned       cc_op;
+	uint16_t       cc_msk;
+	uint32_t       cc_msb;
+	uint32_t       cc_d;
+	uint32_t       cc_s1;
+	uint32_t       cc_s2;
 	uint32_t       usp;
 	uint32_t       ssp;
 	uint32_t       vbr;
@@ -168,6 +243,9 @@ typedef struct e68000_s {
 	char           supervisor;
 	unsigned char  halt;
 	char           bus_error;
+
+	/* set when the next instruction needs the checks in e68_execute() */
+	unsigned char  attn;
 	char           exception;
 
 	unsigned       ea_typ;
@@ -180,6 +258,7 @@ typedef struct e68000_s {
 	char           int_nmi;
 
 	unsigned long  delay;
+	char           clk_stop;
 
 	unsigned       except_cnt;
 	uint32_t       except_addr;
@@ -189,11 +268,83 @@ typedef struct e68000_s {
 	unsigned long  oprcnt;
 	unsigned long  clkcnt;
 
-	e68_opcode_f   opcodes[1024];
-	e68_opcode_f   op49c0[8];
+	/* shared const tables, or optab for the 68020 */
+	const e68_opcode_f *opcodes;
+	const e68_opcode_f *op49c0;
+	e68_opcode_f   *optab;
 } e68000_t;
 
 
+/*!***************************************************************************
+ * @short Compute the pending lazy condition codes and store them in sr
+ *****************************************************************************/
+void e68_cc_flush (e68000_t *c);
+
+static inline
+void e68_cc_sync (e68000_t *c)
+{
+	if (c->cc_op != E68_CC_NONE) {
+		e68_cc_flush (c);
+	}
+}
+
+
+/*!***************************************************************************
+ * @short Invalidate the cached instructions in the page containing addr
+ *****************************************************************************/
+void e68_icache_invalidate (e68000_t *c, uint32_t addr);
+
+/*!***************************************************************************
+ * @short Make the cached instruction words at ir_pc available for prefetch
+ *****************************************************************************/
+void e68_icache_jump (e68000_t *c);
+
+static inline
+void e68_icache_check (e68000_t *c, uint32_t addr, unsigned n)
+{
+	uint32_t page;
+
+	if (c->ic_page == NULL) {
+		return;
+	}
+
+	page = addr >> E68_ICACHE_SHIFT;
+
+	if (c->ic_page[page >> 3] & (1 << (page & 7))) {
+		e68_icache_invalidate (c, addr);
+	}
+
+	page = (addr + n - 1) >> E68_ICACHE_SHIFT;
+
+	if (c->ic_page[page >> 3] & (1 << (page & 7))) {
+		e68_icache_invalidate (c, addr + n - 1);
+	}
+}
+
+/*
+ * Mark the parts of the write watch region that are written by an access
+ * of n bytes at addr.
+ */
+static inline
+void e68_watch_check (e68000_t *c, uint32_t addr, unsigned n)
+{
+	uint32_t ofs;
+
+	ofs = addr - c->wr_addr;
+
+	if (ofs < c->wr_cnt) {
+		c->wr_map[ofs >> c->wr_shift] = 1;
+	}
+
+	if (n > 1) {
+		ofs += n - 1;
+
+		if (ofs < c->wr_cnt) {
+			c->wr_map[ofs >> c->wr_shift] = 1;
+		}
+	}
+}
+
 
 static inline
 void e68_set_dreg8 (e68000_t *c, unsigned reg, uint8_t val)
@@ -248,12 +399,18 @@ uint8_t e68_get_mem8 (e68000_t *c, uint32_t addr)
 		return (c->ram[addr]);
 	}
 
+	if ((addr - c->rom_addr) < c->rom_cnt) {
+		return (c->rom[addr - c->rom_addr]);
+	}
+
 	return (c->get_uint8 (c->mem_ext, addr & 0x00ffffff));
 }
 
 static inline
 uint16_t e68_get_mem16 (e68000_t *c, uint32_t addr)
 {
+	uint32_t ofs;
+
 #ifdef E68000_LOG_MEM
 	if (c->log_mem != NULL) {
 		c->log_mem (c->log_ext, addr, 4);
@@ -266,13 +423,19 @@ uint16_t e68_get_mem16 (e68000_t *c, uint32_t addr)
 		return ((c->ram[addr] << 8) | c->ram[addr + 1]);
 	}
 
+	ofs = addr - c->rom_addr;
+
+	if ((ofs < c->rom_cnt) && ((c->rom_cnt - ofs) >= 2)) {
+		return ((c->rom[ofs] << 8) | c->rom[ofs + 1]);
+	}
+
 	return (c->get_uint16 (c->mem_ext, addr));
 }
 
 static inline
 uint32_t e68_get_mem32 (e68000_t *c, uint32_t addr)
 {
-	uint32_t val;
+	uint32_t val, ofs;
 
 #ifdef E68000_LOG_MEM
 	if (c->log_mem != NULL) {
@@ -291,6 +454,17 @@ uint32_t e68_get_mem32 (e68000_t *c, uint32_t addr)
 		return (val);
 	}
 
+	ofs = addr - c->rom_addr;
+
+	if ((ofs < c->rom_cnt) && ((c->rom_cnt - ofs) >= 4)) {
+		val = c->rom[ofs];
+		val = (val << 8) | c->rom[ofs + 1];
+		val = (val << 8) | c->rom[ofs + 2];
+		val = (val << 8) | c->rom[ofs + 3];
+
+		return (val);
+	}
+
 	return (c->get_uint32 (c->mem_ext, addr));
 }
 
@@ -306,6 +480,8 @@ void e68_set_mem8 (e68000_t *c, uint32_t addr, uint8_t val)
 	addr &= 0x00ffffff;
 
 	if (addr < c->ram_cnt) {
+		e68_icache_check (c, addr, 1);
+		e68_watch_check (c, addr, 1);
 		c->ram[addr] = val;
 	}
 	else {
@@ -325,6 +501,8 @@ void e68_set_mem16 (e68000_t *c, uint32_t addr, uint16_t val)
 	addr &= 0x00ffffff;
 
 	if ((addr + 1) < c->ram_cnt) {
+		e68_icache_check (c, addr, 2);
+		e68_watch_check (c, addr, 2);
 		c->ram[addr] = (val >> 8) & 0xff;
 		c->ram[addr + 1] = val & 0xff;
 	}
@@ -345,6 +523,8 @@ void e68_set_mem32 (e68000_t *c, uint32_t addr, uint32_t val)
 	addr &= 0x00ffffff;
 
 	if ((addr + 3) < c->ram_cnt) {
+		e68_icache_check (c, addr, 4);
+		e68_watch_check (c, addr, 4);
 		c->ram[addr] = (val >> 24) & 0xff;
 		c->ram[addr + 1] = (val >> 16) & 0xff;
 		c->ram[addr + 2] = (val >> 8) & 0xff;
@@ -387,6 +567,61 @@ void e68_set_mem_fct (e68000_t *c, void *ext,
 
 void e68_set_ram (e68000_t *c, unsigned char *ram, unsigned long cnt);
 
+/*!***************************************************************************
+ * @short Set a read-only memory region that is read directly
+ * @param rom  The region's data or NULL to disable direct reads
+ * @param addr The region's base address
+ * @param cnt  The region's size in bytes
+ *
+ * Reads from the region bypass the get_uint* callbacks. Writes still go
+ * through the set_uint* callbacks.
+ *****************************************************************************/
+void e68_set_rom (e68000_t *c, const unsigned char *rom, unsigned long addr, unsigned long cnt);
+
+/*!***************************************************************************
+ * @short Watch CPU writes to a RAM region
+ * @param addr  The region's base address
+ * @param cnt   The region's size in bytes or 0 to disable the watch
+ * @param shift Each byte in map covers (1 << shift) bytes of the region
+ * @param map   The map, ((cnt - 1) >> shift) + 1 bytes
+ *
+ * Every write to the region sets the corresponding map bytes to 1. The
+ * map is never cleared by the CPU. Writes through e68_icache_write()
+ * are marked as well, e68_icache_flush() and e68_set_ram() mark the
+ * whole region.
+ *****************************************************************************/
+void e68_set_watch (e68000_t *c, unsigned long addr, unsigned long cnt, unsigned shift, unsigned char *map);
+
+/*!***************************************************************************
+ * @short Set the ROM region that may be cached by the instruction cache
+ *
+ * The region must be read through the get_uint16 callback without side
+ * effects and must not change, except through e68_icache_flush().
+ *****************************************************************************/
+void e68_icache_set_rom (e68000_t *c, unsigned long addr, unsigned long size);
+
+/*!***************************************************************************
+ * @short Invalidate all cached instructions
+ *****************************************************************************/
+void e68_icache_flush (e68000_t *c);
+
+/*!***************************************************************************
+ * @short Tell the instruction cache and the write watch about a RAM write
+ *        that bypassed the CPU
+ *****************************************************************************/
+void e68_icache_write (e68000_t *c, unsigned long addr, unsigned long size);
+
+/*!***************************************************************************
+ * @short  Enable or disable the dynamic recompiler
+ * @return Non-zero if the recompiler is not available
+ *
+ * The recompiler is only built with E68_JIT on x86-64 hosts and only
+ * works with a plain 68000 and an enabled instruction cache. Code it
+ * can't translate, and all accesses outside of RAM, are executed by the
+ * interpreter.
+ *****************************************************************************/
+int e68_set_jit (e68000_t *c, int enable);
+
 void e68_set_reset_fct (e68000_t *c, void *ext, void *fct);
 
 void e68_set_inta_fct (e68000_t *c, void *ext, void *fct);
@@ -516,9 +751,29 @@ void e68_execute (e68000_t *c);
 
 /*!***************************************************************************
  * @short Clock a 68000 cpu core
+ *
+ * If e68_clock_stop() is called while the clock is running, e68_clock()
+ * returns after the current instruction and the remaining clock cycles
+ * are not consumed. Use e68_get_clkcnt() to find out how many cycles
+ * were actually executed.
  *****************************************************************************/
 void e68_clock (e68000_t *c, unsigned long n);
 
+/*!***************************************************************************
+ * @short Run a 68000 cpu core for n clock cycles
+ *
+ * Like e68_clock(), but interrupts, trace, halt and bus errors are only
+ * checked while the attention flag is set. The flag is raised by
+ * e68_interrupt(), SR writes, e68_set_halt() and e68_set_bus_error(), so
+ * the result is the same as with e68_clock().
+ *****************************************************************************/
+void e68_run_cycles (e68000_t *c, unsigned long n);
+
+/*!***************************************************************************
+ * @short Make e68_clock() return after the current instruction
+ *****************************************************************************/
+void e68_clock_stop (e68000_t *c);
+
 
 /*****************************************************************************
  * disasm
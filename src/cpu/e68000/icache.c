@@ -0,0 +1,278 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/cpu/e68000/icache.c                                      *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#include <stdlib.h>
+
+#include "e68000.h"
+#include "internal.h"
+
+//We need speed here!
+#pragma GCC optimize ("O3")
+
+
+/* an invalid tag, instructions are never fetched from odd addresses */
+#define E68_ICACHE_NONE 1
+
+
+int e68_icache_init (e68000_t *c)
+{
+	c->ic = malloc (sizeof (e68_icache_t));
+	c->ic_page = NULL;
+
+	c->ic_addr = 0;
+	c->ic_size = 0;
+	c->ic_ir = NULL;
+
+	if (c->ic == NULL) {
+		return (1);
+	}
+
+	c->ic->rom_addr = 0;
+	c->ic->rom_size = 0;
+
+	e68_icache_flush (c);
+
+	return (0);
+}
+
+void e68_icache_free (e68000_t *c)
+{
+	free (c->ic_page);
+	free (c->ic);
+
+	c->ic_page = NULL;
+	c->ic = NULL;
+	c->ic_size = 0;
+}
+
+void e68_icache_set_ram (e68000_t *c)
+{
+	unsigned long cnt;
+
+	free (c->ic_page);
+	c->ic_page = NULL;
+
+	if ((c->ic != NULL) && (c->ram_cnt > 0)) {
+		cnt = ((c->ram_cnt >> E68_ICACHE_SHIFT) + 8) / 8;
+		c->ic_page = calloc (cnt, 1);
+	}
+
+	e68_icache_flush (c);
+}
+
+void e68_icache_set_rom (e68000_t *c, unsigned long addr, unsigned long size)
+{
+	if (c->ic == NULL) {
+		return;
+	}
+
+	c->ic->rom_addr = addr & 0x00ffffff;
+	c->ic->rom_size = size;
+
+	e68_icache_flush (c);
+}
+
+void e68_icache_flush (e68000_t *c)
+{
+	unsigned i;
+
+	c->ic_size = 0;
+
+	e68_jit_flush (c);
+	e68_watch_all (c);
+
+	if (c->ic == NULL) {
+		return;
+	}
+
+	for (i = 0; i < E68_ICACHE_CNT; i++) {
+		c->ic->ent[i].addr = E68_ICACHE_NONE;
+		c->ic->ent[i].size = 0;
+	}
+
+	if (c->ic_page != NULL) {
+		unsigned long cnt;
+
+		cnt = ((c->ram_cnt >> E68_ICACHE_SHIFT) + 8) / 8;
+
+		for (i = 0; i < cnt; i++) {
+			c->ic_page[i] = 0;
+		}
+	}
+}
+
+void e68_icache_invalidate (e68000_t *c, uint32_t addr)
+{
+	uint32_t         page, base, end;
+	e68_icache_ent_t *ent;
+
+	page = addr >> E68_ICACHE_SHIFT;
+
+	base = page << E68_ICACHE_SHIFT;
+	end = base + (1UL << E68_ICACHE_SHIFT);
+
+	/* entries starting in the previous page may reach into this one */
+	if (base >= 2 * (E68_ICACHE_WORDS - 1)) {
+		base -= 2 * (E68_ICACHE_WORDS - 1);
+	}
+	else {
+		base = 0;
+	}
+
+	while (base < end) {
+		ent = &c->ic->ent[(base >> 1) & (E68_ICACHE_CNT - 1)];
+
+		if ((ent->addr & 0x00ffffff) == base) {
+			ent->addr = E68_ICACHE_NONE;
+		}
+
+		base += 2;
+	}
+
+	e68_jit_invalidate (c, addr);
+
+	c->ic_page[page >> 3] &= ~(1 << (page & 7));
+
+	/* the current instruction may have been overwritten */
+	c->ic_size = 0;
+}
+
+void e68_icache_write (e68000_t *c, unsigned long addr, unsigned long size)
+{
+	unsigned long page, ofs;
+
+	addr &= 0x00ffffff;
+
+	if ((c->wr_cnt > 0) && (size > 0)) {
+		for (ofs = 0; ofs < size; ofs += 1UL << c->wr_shift) {
+			e68_watch_check (c, addr + ofs, 1);
+		}
+
+		e68_watch_check (c, addr + size - 1, 1);
+	}
+
+	if ((c->ic_page == NULL) || (size == 0)) {
+		return;
+	}
+
+	if (addr >= c->ram_cnt) {
+		return;
+	}
+
+	if ((c->ram_cnt - addr) < size) {
+		size = c->ram_cnt - addr;
+	}
+
+	page = addr >> E68_ICACHE_SHIFT;
+
+	while ((page << E68_ICACHE_SHIFT) < (addr + size)) {
+		if (c->ic_page[page >> 3] & (1 << (page & 7))) {
+			e68_icache_invalidate (c, page << E68_ICACHE_SHIFT);
+		}
+
+		page += 1;
+	}
+}
+
+void e68_icache_jump (e68000_t *c)
+{
+	e68_icache_ent_t *ent;
+
+	if (c->ic == NULL) {
+		return;
+	}
+
+	ent = &c->ic->ent[(c->ir_pc >> 1) & (E68_ICACHE_CNT - 1)];
+
+	if (ent->addr != c->ir_pc) {
+		if (e68_icache_fill (c, ent, c->ir_pc)) {
+			c->ic_size = 0;
+			return;
+		}
+	}
+
+	c->ic_addr = ent->addr;
+	c->ic_size = ent->size;
+	c->ic_ir = ent->ir;
+}
+
+int e68_icache_fill (e68000_t *c, e68_icache_ent_t *ent, uint32_t pc)
+{
+	unsigned i, n;
+	uint32_t addr;
+
+	addr = pc & 0x00ffffff;
+
+	if (addr & 1) {
+		return (1);
+	}
+
+	if (((addr + 1) < c->ram_cnt) && (c->ic_page != NULL)) {
+		n = (c->ram_cnt - addr) / 2;
+
+		if (n > E68_ICACHE_WORDS) {
+			n = E68_ICACHE_WORDS;
+		}
+
+		for (i = 0; i < n; i++) {
+			ent->ir[i] = (c->ram[addr + 2 * i] << 8) | c->ram[addr + 2 * i + 1];
+		}
+
+		i = addr >> E68_ICACHE_SHIFT;
+		c->ic_page[i >> 3] |= 1 << (i & 7);
+
+		i = (addr + 2 * n - 1) >> E68_ICACHE_SHIFT;
+		c->ic_page[i >> 3] |= 1 << (i & 7);
+	}
+	else if ((addr - c->ic->rom_addr) < c->ic->rom_size) {
+		n = (c->ic->rom_addr + c->ic->rom_size - addr) / 2;
+
+		if (n > E68_ICACHE_WORDS) {
+			n = E68_ICACHE_WORDS;
+		}
+
+		for (i = 0; i < n; i++) {
+			ent->ir[i] = c->get_uint16 (c->mem_ext, addr + 2 * i);
+		}
+	}
+	else {
+		return (1);
+	}
+
+	if (n < 2) {
+		ent->addr = E68_ICACHE_NONE;
+		return (1);
+	}
+
+	ent->addr = pc;
+	ent->size = 2 * n;
+	ent->op = NULL;
+
+	if (c->optab == NULL) {
+		ent->op = e68_get_op_spec (ent->ir[0]);
+	}
+
+	if (ent->op == NULL) {
+		ent->op = c->opcodes[(ent->ir[0] >> 6) & 0x3ff];
+	}
+
+	return (0);
+}
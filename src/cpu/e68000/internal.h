@@ -33,6 +33,7 @@
 
 #define E68_SR_XC (E68_SR_X | E68_SR_C)
 #define E68_SR_NZVC (E68_SR_N | E68_SR_Z | E68_SR_V | E68_SR_C)
+#define E68_SR_NVC (E68_SR_N | E68_SR_V | E68_SR_C)
 #define E68_SR_XNVC (E68_SR_X | E68_SR_N | E68_SR_V | E68_SR_C)
 #define E68_SR_XNZVC (E68_SR_X | E68_SR_N | E68_SR_Z | E68_SR_V | E68_SR_C)
 
@@ -59,6 +60,7 @@ uint32_t e68_exts16 (uint32_t val)
 static inline
 void e68_set_ccr (e68000_t *c, uint8_t val)
 {
+	c->cc_op = E68_CC_NONE;
 	c->sr = (c->sr & 0xff00) | (val & 0x00ff);
 }
 
@@ -67,6 +69,7 @@ void e68_set_iml (e68000_t *c, unsigned val)
 {
 	c->sr &= 0xf8ff;
 	c->sr |= (val & 7) << 8;
+	c->attn = 1;
 }
 
 static inline
@@ -139,20 +142,83 @@ uint32_t e68_get_uint32 (const void *buf, unsigned i)
 	return (r);
 }
 
+/*
+ * Mark the whole write watch region
+ */
+static inline
+void e68_watch_all (e68000_t *c)
+{
+	uint32_t i;
+
+	for (i = 0; i < c->wr_cnt; i += 1UL << c->wr_shift) {
+		c->wr_map[i >> c->wr_shift] = 1;
+	}
+}
+
+int e68_icache_init (e68000_t *c);
+void e68_icache_free (e68000_t *c);
+void e68_icache_set_ram (e68000_t *c);
+int e68_icache_fill (e68000_t *c, e68_icache_ent_t *ent, uint32_t pc);
+
+void e68_jit_free (e68000_t *c);
+void e68_jit_flush (e68000_t *c);
+void e68_jit_invalidate (e68000_t *c, uint32_t addr);
+
+/*
+ * Run translated code at pc. Returns 0 if nothing was executed, otherwise
+ * *n is updated to the remaining clock cycles.
+ */
+int e68_jit_exec (e68000_t *c, unsigned long *n);
+
+/*
+ * Look up the instruction at pc in the instruction cache and make its
+ * words available to e68_prefetch(). Returns the opcode handler.
+ */
+static inline
+e68_opcode_f e68_icache_get (e68000_t *c)
+{
+	e68_icache_ent_t *ent;
+
+	ent = &c->ic->ent[(c->pc >> 1) & (E68_ICACHE_CNT - 1)];
+
+	if ((ent->addr != c->pc) || (ent->ir[0] != c->ir[0])) {
+		if (e68_icache_fill (c, ent, c->pc)) {
+			c->ic_size = 0;
+			return (c->opcodes[(c->ir[0] >> 6) & 0x3ff]);
+		}
+	}
+
+	c->ic_addr = ent->addr;
+	c->ic_size = ent->size;
+	c->ic_ir = ent->ir;
+
+	return (ent->op);
+}
+
 static inline
 int e68_prefetch (e68000_t *c)
 {
+	uint32_t ofs;
+
 	if (c->ir_pc & 1) {
 		e68_exception_address (c, c->ir_pc, 0, 0);
 		return (1);
 	}
 
 	c->ir[1] = c->ir[2];
-	c->ir[2] = e68_get_mem16 (c, c->ir_pc);
 
-	if (c->bus_error) {
-		e68_exception_bus (c, c->ir_pc, 0, 0);
-		return (1);
+	ofs = c->ir_pc - c->ic_addr;
+
+	if (ofs < c->ic_size) {
+		c->ir[2] = c->ic_ir[ofs >> 1];
+	}
+	else {
+		c->ir[2] = e68_get_mem16 (c, c->ir_pc);
+
+		if (c->bus_error) {
+			e68_exception_bus (c, c->ir_pc, 0, 0);
+			return (1);
+		}
 	}
 
 	c->ir_pc += 2;
@@ -270,5 +336,18 @@ int e68_ea_set_val32 (e68000_t *c, uint32_t val);
 void e68_set_opcodes (e68000_t *c);
 void e68_set_opcodes_020 (e68000_t *c);
 
+/*
+ * Switch to a private, writable copy of the 68000 opcode table. Returns
+ * the 1024 opcodes followed by the 8 entries for 49C0, or NULL on error.
+ */
+e68_opcode_f *e68_get_opcodes (e68000_t *c);
+
+/*
+ * Get an opcode handler that is specialized for the effective address
+ * modes of op. Returns NULL if there is none and the generic handler
+ * must be used.
+ */
+e68_opcode_f e68_get_op_spec (unsigned op);
+
 
 #endif
@@ -0,0 +1,2016 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/cpu/e68000/jit.c                                         *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+/*
+ * Dynamic recompiler for x86-64 hosts.
+ *
+ * Hot code is translated into blocks of native code. A block is a linear
+ * run of instructions starting at a given PC. Conditional branches leave
+ * the block through a side exit, BRA or an instruction that can't be
+ * translated ends it. Branches to an instruction inside the same block
+ * stay in native code, so small loops run without returning to the
+ * interpreter.
+ *
+ * The register file in e68000_t stays the canonical state. Every
+ * translated instruction does the same bookkeeping as e68_clock() and
+ * e68_execute() (clock budget, clkcnt, delay, oprcnt, last_pc, ir[0]),
+ * so the interpreter can take over at any instruction boundary.
+ *
+ * Translated code only accesses the fast path RAM. Before an instruction
+ * changes any state, all of its memory operands are checked. If one of
+ * them is outside of RAM or would write to a page that holds cached or
+ * translated code, the block exits and the interpreter executes the
+ * instruction. Blocks are invalidated through the instruction cache page
+ * bitmap, so writes through e68_set_mem*() and e68_icache_write() drop
+ * them just like cached instructions. Writes to the write watch region
+ * are left to the interpreter as well, so they get marked.
+ */
+
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "e68000.h"
+#include "internal.h"
+
+
+#if defined(E68_JIT) && defined(__x86_64__) && !defined(E68000_LOG_MEM)
+
+#include <sys/mman.h>
+
+//We need speed here!
+#pragma GCC optimize ("O3")
+
+
+#define E68_JIT_CNT   4096
+#define E68_JIT_HOT   16
+#define E68_JIT_FAIL  0xffffffff
+#define E68_JIT_NONE  1
+
+/* maximum number of instructions and bytes (including prefetch) per block */
+#define E68_JIT_INSN  64
+#define E68_JIT_SPAN  256
+
+#define E68_JIT_CODE_SIZE (8UL << 20)
+#define E68_JIT_CODE_MAX  (E68_JIT_INSN * 384 + 1024)
+
+#define E68_JIT_LABEL_CNT (4 * E68_JIT_INSN + 8)
+#define E68_JIT_FIX_CNT   (8 * E68_JIT_INSN + 8)
+
+/* x86-64 registers */
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RSP 4
+#define RBP 5
+#define RSI 6
+#define RDI 7
+#define R8  8
+#define R9  9
+#define R10 10
+#define R11 11
+#define R12 12
+#define R13 13
+#define R14 14
+#define R15 15
+
+/* x86-64 condition codes */
+#define X86_B  0x02
+#define X86_AE 0x03
+#define X86_E  0x04
+#define X86_NE 0x05
+
+/* translated instruction types */
+enum {
+	JIT_MOVE,
+	JIT_MOVEA,
+	JIT_MOVEQ,
+	JIT_ALU,
+	JIT_ALUA,
+	JIT_QUICK,
+	JIT_QUICKA,
+	JIT_TST,
+	JIT_CLR,
+	JIT_LEA,
+	JIT_BCC,
+	JIT_DBCC
+};
+
+/* ALU operations */
+enum {
+	JIT_ADD,
+	JIT_SUB,
+	JIT_CMP,
+	JIT_AND,
+	JIT_OR
+};
+
+/* effective address modes */
+enum {
+	JIT_EA_DREG,
+	JIT_EA_AREG,
+	JIT_EA_AIND,
+	JIT_EA_AINC,
+	JIT_EA_ADEC,
+	JIT_EA_ADISP,
+	JIT_EA_AIDX,
+	JIT_EA_PCIDX,
+	JIT_EA_ABS,
+	JIT_EA_IMM
+};
+
+typedef unsigned long (*e68_jit_block_f) (e68000_t *c, unsigned long n);
+
+typedef struct {
+	uint32_t        pc;
+	uint32_t        end;
+	uint32_t        cnt;
+	uint16_t        ir[2];
+	e68_jit_block_f fct;
+} e68_jit_ent_t;
+
+typedef struct {
+	unsigned mode;
+	unsigned reg;
+	unsigned idx;
+	int      idx_long;
+	uint32_t val;
+} e68_jit_ea_t;
+
+typedef struct {
+	uint32_t     pc;
+	unsigned     len;
+	uint16_t     op;
+	unsigned     type;
+	unsigned     alu;
+	unsigned     size;
+	unsigned     reg;
+	uint32_t     imm;
+	unsigned     cond;
+	uint32_t     target;
+	unsigned     clk;
+	e68_jit_ea_t src;
+	e68_jit_ea_t dst;
+} e68_jit_insn_t;
+
+typedef struct {
+	unsigned char *pos;
+	unsigned      label;
+} e68_jit_fix_t;
+
+struct e68_jit_s {
+	unsigned char  *code;
+	unsigned long  code_used;
+
+	/* translation state */
+	unsigned char  *p;
+	unsigned char  *end;
+	int            err;
+
+	unsigned       pend;
+
+	unsigned       insn_cnt;
+	e68_jit_insn_t insn[E68_JIT_INSN];
+	uint16_t       word[E68_JIT_SPAN / 2];
+
+	unsigned       label_cnt;
+	unsigned char  *label[E68_JIT_LABEL_CNT];
+
+	unsigned       fix_cnt;
+	e68_jit_fix_t  fix[E68_JIT_FIX_CNT];
+
+	e68_jit_ent_t  ent[E68_JIT_CNT];
+};
+
+
+/*****************************************************************************
+ * runtime helpers called from translated code
+ *****************************************************************************/
+
+static
+int e68_jit_cond (e68000_t *c, unsigned cond)
+{
+	uint16_t sr;
+	int      n, z, v, cy;
+
+	sr = e68_get_sr (c);
+
+	n = (sr & E68_SR_N) != 0;
+	z = (sr & E68_SR_Z) != 0;
+	v = (sr & E68_SR_V) != 0;
+	cy = (sr & E68_SR_C) != 0;
+
+	switch (cond & 15) {
+	case 0x00:
+		return (1);
+	case 0x01:
+		return (0);
+	case 0x02:
+		return (!cy && !z);
+	case 0x03:
+		return (cy || z);
+	case 0x04:
+		return (!cy);
+	case 0x05:
+		return (cy);
+	case 0x06:
+		return (!z);
+	case 0x07:
+		return (z);
+	case 0x08:
+		return (!v);
+	case 0x09:
+		return (v);
+	case 0x0a:
+		return (!n);
+	case 0x0b:
+		return (n);
+	case 0x0c:
+		return (n == v);
+	case 0x0d:
+		return (n != v);
+	case 0x0e:
+		return (!z && (n == v));
+	default:
+		return (z || (n != v));
+	}
+}
+
+/*
+ * A taken branch to a target outside of the block, the same as the
+ * second half of e68_op_bcc() and e68_op_dbcc().
+ */
+static
+void e68_jit_jump (e68000_t *c, uint32_t addr)
+{
+	e68_set_ir_pc (c, addr);
+
+	if (e68_prefetch (c)) {
+		return;
+	}
+
+	if (e68_prefetch (c)) {
+		return;
+	}
+
+	e68_set_pc (c, e68_get_ir_pc (c) - 4);
+}
+
+
+/*****************************************************************************
+ * x86-64 code emitter
+ *****************************************************************************/
+
+#define OFS(f) ((int) offsetof (e68000_t, f))
+#define OFS_DREG(n) (OFS (dreg) + 4 * (int) (n))
+#define OFS_AREG(n) (OFS (areg) + 4 * (int) (n))
+
+static
+void jit_b (e68_jit_t *j, unsigned val)
+{
+	if (j->p < j->end) {
+		*(j->p++) = val & 0xff;
+	}
+	else {
+		j->err = 1;
+	}
+}
+
+static
+void jit_w (e68_jit_t *j, unsigned val)
+{
+	jit_b (j, val);
+	jit_b (j, val >> 8);
+}
+
+static
+void jit_l (e68_jit_t *j, uint32_t val)
+{
+	jit_w (j, val & 0xffff);
+	jit_w (j, (val >> 16) & 0xffff);
+}
+
+static
+void jit_q (e68_jit_t *j, uint64_t val)
+{
+	jit_l (j, val & 0xffffffff);
+	jit_l (j, (val >> 32) & 0xffffffff);
+}
+
+static
+void jit_prefix (e68_jit_t *j, int p66, int w, unsigned r, unsigned x, unsigned b, unsigned op)
+{
+	unsigned rex;
+
+	if (p66) {
+		jit_b (j, 0x66);
+	}
+
+	rex = 0x40 | (w ? 8 : 0) | ((r & 8) >> 1) | ((x & 8) >> 2) | ((b & 8) >> 3);
+
+	if (rex != 0x40) {
+		jit_b (j, rex);
+	}
+
+	if (op > 0xff) {
+		jit_b (j, op >> 8);
+	}
+
+	jit_b (j, op);
+}
+
+static
+void jit_disp (e68_jit_t *j, unsigned modrm, unsigned b, int disp, int sib)
+{
+	if ((disp == 0) && ((b & 7) != 5)) {
+		jit_b (j, modrm);
+
+		if (sib >= 0) {
+			jit_b (j, sib);
+		}
+	}
+	else if ((disp >= -128) && (disp <= 127)) {
+		jit_b (j, modrm | 0x40);
+
+		if (sib >= 0) {
+			jit_b (j, sib);
+		}
+
+		jit_b (j, disp);
+	}
+	else {
+		jit_b (j, modrm | 0x80);
+
+		if (sib >= 0) {
+			jit_b (j, sib);
+		}
+
+		jit_l (j, disp);
+	}
+}
+
+/* op r, [b + disp] */
+static
+void jit_op_mem (e68_jit_t *j, int p66, int w, unsigned op, unsigned r, unsigned b, int disp)
+{
+	jit_prefix (j, p66, w, r, 0, b, op);
+
+	if ((b & 7) == 4) {
+		jit_disp (j, ((r & 7) << 3) | 4, b, disp, 0x24);
+	}
+	else {
+		jit_disp (j, ((r & 7) << 3) | (b & 7), b, disp, -1);
+	}
+}
+
+/* op r, [b + x * (1 << s) + disp] */
+static
+void jit_op_sib (e68_jit_t *j, int p66, int w, unsigned op, unsigned r, unsigned b, unsigned x, unsigned s, int disp)
+{
+	jit_prefix (j, p66, w, r, x, b, op);
+	jit_disp (j, ((r & 7) << 3) | 4, b, disp, (s << 6) | ((x & 7) << 3) | (b & 7));
+}
+
+/* op rm, r */
+static
+void jit_op_reg (e68_jit_t *j, int p66, int w, unsigned op, unsigned r, unsigned rm)
+{
+	jit_prefix (j, p66, w, r, 0, rm, op);
+	jit_b (j, 0xc0 | ((r & 7) << 3) | (rm & 7));
+}
+
+/* mov r32, imm32 */
+static
+void jit_mov_ri (e68_jit_t *j, unsigned r, uint32_t val)
+{
+	jit_prefix (j, 0, 0, 0, 0, r, 0xb8 + (r & 7));
+	jit_l (j, val);
+}
+
+/* mov r32, r32 */
+static
+void jit_mov_rr (e68_jit_t *j, unsigned dst, unsigned src)
+{
+	jit_op_reg (j, 0, 0, 0x89, src, dst);
+}
+
+/* op r32, imm32 with op = /n of 81 */
+static
+void jit_alu_ri (e68_jit_t *j, int w, unsigned n, unsigned r, uint32_t val)
+{
+	jit_op_reg (j, 0, w, 0x81, n, r);
+	jit_l (j, val);
+}
+
+/* shift r32 with op = /n of C1 */
+static
+void jit_shift_ri (e68_jit_t *j, int w, unsigned n, unsigned r, unsigned cnt)
+{
+	jit_op_reg (j, 0, w, 0xc1, n, r);
+	jit_b (j, cnt);
+}
+
+/* lea r32, [b + disp] */
+static
+void jit_lea (e68_jit_t *j, unsigned r, unsigned b, int disp)
+{
+	jit_op_mem (j, 0, 0, 0x8d, r, b, disp);
+}
+
+static
+void jit_call (e68_jit_t *j, void *fct)
+{
+	/* mov rax, imm64 ; call rax */
+	jit_prefix (j, 0, 1, 0, 0, RAX, 0xb8);
+	jit_q (j, (uint64_t) (uintptr_t) fct);
+	jit_b (j, 0xff);
+	jit_b (j, 0xd0);
+}
+
+static
+unsigned jit_new_label (e68_jit_t *j)
+{
+	if (j->label_cnt >= E68_JIT_LABEL_CNT) {
+		j->err = 1;
+		return (0);
+	}
+
+	j->label[j->label_cnt] = NULL;
+
+	return (j->label_cnt++);
+}
+
+static
+void jit_bind (e68_jit_t *j, unsigned label)
+{
+	j->label[label] = j->p;
+}
+
+static
+void jit_fixup (e68_jit_t *j, unsigned label)
+{
+	if (j->fix_cnt >= E68_JIT_FIX_CNT) {
+		j->err = 1;
+		return;
+	}
+
+	j->fix[j->fix_cnt].pos = j->p;
+	j->fix[j->fix_cnt].label = label;
+	j->fix_cnt += 1;
+
+	jit_l (j, 0);
+}
+
+static
+void jit_jcc (e68_jit_t *j, unsigned cc, unsigned label)
+{
+	jit_b (j, 0x0f);
+	jit_b (j, 0x80 + cc);
+	jit_fixup (j, label);
+}
+
+static
+void jit_jmp (e68_jit_t *j, unsigned label)
+{
+	jit_b (j, 0xe9);
+	jit_fixup (j, label);
+}
+
+static
+int jit_resolve (e68_jit_t *j)
+{
+	unsigned      i;
+	unsigned char *dst, *pos;
+	long          rel;
+
+	for (i = 0; i < j->fix_cnt; i++) {
+		pos = j->fix[i].pos;
+		dst = j->label[j->fix[i].label];
+
+		if (dst == NULL) {
+			return (1);
+		}
+
+		rel = dst - (pos + 4);
+
+		pos[0] = rel & 0xff;
+		pos[1] = (rel >> 8) & 0xff;
+		pos[2] = (rel >> 16) & 0xff;
+		pos[3] = (rel >> 24) & 0xff;
+	}
+
+	return (0);
+}
+
+
+/*****************************************************************************
+ * decoder
+ *****************************************************************************/
+
+/*
+ * Get an instruction word for translation. Only code that the instruction
+ * cache would cache is translated.
+ */
+static
+int jit_get_word (e68000_t *c, uint32_t addr, uint16_t *val)
+{
+	addr &= 0x00ffffff;
+
+	if (((addr + 1) < c->ram_cnt) && (c->ic_page != NULL)) {
+		*val = (c->ram[addr] << 8) | c->ram[addr + 1];
+		return (0);
+	}
+
+	if ((addr - c->ic->rom_addr) < c->ic->rom_size) {
+		if ((addr + 2 - c->ic->rom_addr) <= c->ic->rom_size) {
+			*val = c->get_uint16 (c->mem_ext, addr);
+			return (0);
+		}
+	}
+
+	return (1);
+}
+
+typedef struct {
+	e68_jit_t *j;
+	e68000_t  *c;
+	uint32_t  start;
+	uint32_t  pc;
+	unsigned  cnt;
+} e68_jit_dec_t;
+
+static
+int jit_fetch (e68_jit_dec_t *d, uint16_t *val)
+{
+	unsigned idx;
+
+	idx = (d->pc - d->start) / 2;
+
+	/* keep room for the two prefetched words after the block */
+	if ((idx + 2) >= (E68_JIT_SPAN / 2)) {
+		return (1);
+	}
+
+	if (idx >= d->cnt) {
+		if (jit_get_word (d->c, d->pc, &d->j->word[idx])) {
+			return (1);
+		}
+
+		d->cnt = idx + 1;
+	}
+
+	*val = d->j->word[idx];
+
+	d->pc += 2;
+
+	return (0);
+}
+
+/*
+ * Decode an effective address. mask is the valid ea mask of the
+ * interpreter handler. Adds the clock cycles of the address calculation
+ * and of the access to *clk.
+ */
+static
+int jit_dec_ea (e68_jit_dec_t *d, e68_jit_ea_t *ea, unsigned ea6, unsigned size, unsigned mask, unsigned *clk)
+{
+	uint16_t ext, ext2;
+	uint32_t base;
+	unsigned mem;
+
+	ea->reg = ea6 & 7;
+	ea->val = 0;
+	ea->idx = 0;
+	ea->idx_long = 0;
+
+	mem = 1;
+
+	switch ((ea6 >> 3) & 7) {
+	case 0:
+		if ((mask & 0x0001) == 0) {
+			return (1);
+		}
+		ea->mode = JIT_EA_DREG;
+		mem = 0;
+		break;
+
+	case 1:
+		if (((mask & 0x0002) == 0) || (size == 8)) {
+			return (1);
+		}
+		ea->mode = JIT_EA_AREG;
+		mem = 0;
+		break;
+
+	case 2:
+		if ((mask & 0x0004) == 0) {
+			return (1);
+		}
+		ea->mode = JIT_EA_AIND;
+		break;
+
+	case 3:
+		if ((mask & 0x0008) == 0) {
+			return (1);
+		}
+		ea->mode = JIT_EA_AINC;
+		ea->val = ((ea->reg == 7) && (size == 8)) ? 2 : (size / 8);
+		break;
+
+	case 4:
+		if ((mask & 0x0010) == 0) {
+			return (1);
+		}
+		ea->mode = JIT_EA_ADEC;
+		ea->val = ((ea->reg == 7) && (size == 8)) ? 2 : (size / 8);
+		*clk += 2;
+		break;
+
+	case 5:
+		if ((mask & 0x0020) == 0) {
+			return (1);
+		}
+		if (jit_fetch (d, &ext)) {
+			return (1);
+		}
+		ea->mode = JIT_EA_ADISP;
+		ea->val = e68_exts16 (ext);
+		*clk += 4;
+		break;
+
+	case 6:
+		if ((mask & 0x0040) == 0) {
+			return (1);
+		}
+		if (jit_fetch (d, &ext)) {
+			return (1);
+		}
+		ea->mode = JIT_EA_AIDX;
+		ea->val = e68_exts8 (ext);
+		ea->idx = (ext >> 12) & 15;
+		ea->idx_long = (ext & 0x0800) != 0;
+		*clk += 6;
+		break;
+
+	default:
+		switch (ea6 & 7) {
+		case 0:
+			if ((mask & 0x0080) == 0) {
+				return (1);
+			}
+			if (jit_fetch (d, &ext)) {
+				return (1);
+			}
+			ea->mode = JIT_EA_ABS;
+			ea->val = e68_exts16 (ext);
+			*clk += 4;
+			break;
+
+		case 1:
+			if ((mask & 0x0100) == 0) {
+				return (1);
+			}
+			if (jit_fetch (d, &ext) || jit_fetch (d, &ext2)) {
+				return (1);
+			}
+			ea->mode = JIT_EA_ABS;
+			ea->val = ((uint32_t) ext << 16) | ext2;
+			*clk += 8;
+			break;
+
+		case 2:
+			if ((mask & 0x0200) == 0) {
+				return (1);
+			}
+			base = d->pc;
+			if (jit_fetch (d, &ext)) {
+				return (1);
+			}
+			ea->mode = JIT_EA_ABS;
+			ea->val = (base + e68_exts16 (ext)) & 0xffffffff;
+			*clk += 4;
+			break;
+
+		case 3:
+			if ((mask & 0x0400) == 0) {
+				return (1);
+			}
+			base = d->pc;
+			if (jit_fetch (d, &ext)) {
+				return (1);
+			}
+			ea->mode = JIT_EA_PCIDX;
+			ea->val = (base + e68_exts8 (ext)) & 0xffffffff;
+			ea->idx = (ext >> 12) & 15;
+			ea->idx_long = (ext & 0x0800) != 0;
+			*clk += 6;
+			break;
+
+		case 4:
+			if ((mask & 0x0800) == 0) {
+				return (1);
+			}
+			if (jit_fetch (d, &ext)) {
+				return (1);
+			}
+			ea->mode = JIT_EA_IMM;
+			ea->val = ext;
+			if (size == 32) {
+				if (jit_fetch (d, &ext2)) {
+					return (1);
+				}
+				ea->val = (ea->val << 16) | ext2;
+				*clk += 8;
+			}
+			else {
+				if (size == 8) {
+					ea->val &= 0xff;
+				}
+				*clk += 4;
+			}
+			mem = 0;
+			break;
+
+		default:
+			return (1);
+		}
+		break;
+	}
+
+	if (mem) {
+		*clk += (size == 32) ? 8 : 4;
+	}
+
+	return (0);
+}
+
+static
+unsigned jit_size (unsigned bits)
+{
+	static const unsigned tab[4] = { 8, 16, 32, 0 };
+
+	return (tab[bits & 3]);
+}
+
+/*
+ * Decode the ALU group (OR, SUB, CMP, AND, ADD) with a register
+ * destination. clk holds the base clock cycles for byte, word, long,
+ * word address and long address destinations, 0 if not supported.
+ */
+static
+int jit_dec_alu (e68_jit_dec_t *d, e68_jit_insn_t *in, unsigned alu,
+	const unsigned char *clk, const unsigned short *mask)
+{
+	unsigned opm;
+
+	opm = (in->op >> 6) & 7;
+
+	in->alu = alu;
+	in->reg = (in->op >> 9) & 7;
+
+	if (opm < 3) {
+		in->type = JIT_ALU;
+		in->size = jit_size (opm);
+		in->clk = clk[opm];
+	}
+	else if (opm == 3) {
+		in->type = JIT_ALUA;
+		in->size = 16;
+		in->clk = clk[3];
+	}
+	else if (opm == 7) {
+		in->type = JIT_ALUA;
+		in->size = 32;
+		in->clk = clk[4];
+	}
+	else {
+		return (1);
+	}
+
+	if (in->clk == 0) {
+		return (1);
+	}
+
+	return (jit_dec_ea (d, &in->src, in->op & 0x3f, in->size, mask[(opm < 3) ? opm : 3], &in->clk));
+}
+
+static
+int jit_dec_insn (e68_jit_dec_t *d, e68_jit_insn_t *in)
+{
+	uint16_t op, ext;
+	unsigned mode;
+
+	static const unsigned char  clk_or[5] = { 8, 8, 10, 0, 0 };
+	static const unsigned char  clk_sub[5] = { 8, 8, 10, 8, 10 };
+	static const unsigned char  clk_cmp[5] = { 4, 4, 6, 8, 8 };
+	static const unsigned char  clk_and[5] = { 4, 4, 6, 0, 0 };
+	static const unsigned char  clk_add[5] = { 4, 4, 6, 8, 6 };
+	static const unsigned short msk_logic[4] = { 0x0ffd, 0x0ffd, 0x0ffd, 0x0ffd };
+	static const unsigned short msk_arith[4] = { 0x0ffd, 0x0fff, 0x0fff, 0x0fff };
+
+	in->pc = d->pc;
+
+	if (jit_fetch (d, &op)) {
+		return (1);
+	}
+
+	in->op = op;
+	in->clk = 0;
+
+	mode = (op >> 3) & 7;
+
+	switch ((op >> 12) & 15) {
+	case 0x01:
+	case 0x02:
+	case 0x03:
+		in->size = (op & 0x1000) ? ((op & 0x2000) ? 16 : 8) : 32;
+		in->reg = (op >> 9) & 7;
+		in->clk = 4;
+
+		if (jit_dec_ea (d, &in->src, op & 0x3f, in->size, 0x0fff, &in->clk)) {
+			return (1);
+		}
+
+		if (((op >> 6) & 7) == 1) {
+			if (in->size == 8) {
+				return (1);
+			}
+
+			in->type = JIT_MOVEA;
+		}
+		else {
+			in->type = JIT_MOVE;
+
+			if (jit_dec_ea (d, &in->dst, ((op >> 3) & 0x38) | ((op >> 9) & 7), in->size, 0x01fd, &in->clk)) {
+				return (1);
+			}
+		}
+		break;
+
+	case 0x04:
+		if (((op & 0xf1c0) == 0x41c0) && (mode >= 2)) {
+			in->type = JIT_LEA;
+			in->reg = (op >> 9) & 7;
+			in->size = 32;
+			in->clk = 4;
+
+			if (jit_dec_ea (d, &in->src, op & 0x3f, 32, 0x07e4, &in->clk)) {
+				return (1);
+			}
+
+			/* the address, not the access */
+			in->clk -= 8;
+		}
+		else if (((op & 0xff00) == 0x4a00) && ((op & 0xc0) != 0xc0)) {
+			in->type = JIT_TST;
+			in->size = jit_size (op >> 6);
+			in->clk = 8;
+
+			if (jit_dec_ea (d, &in->src, op & 0x3f, in->size, 0x01fd, &in->clk)) {
+				return (1);
+			}
+		}
+		else if (((op & 0xff00) == 0x4200) && ((op & 0xc0) != 0xc0) && (mode == 0)) {
+			in->type = JIT_CLR;
+			in->size = jit_size (op >> 6);
+			in->reg = op & 7;
+			in->clk = (in->size == 32) ? 6 : 4;
+		}
+		else {
+			return (1);
+		}
+		break;
+
+	case 0x05:
+		if ((op & 0xc0) == 0xc0) {
+			if (mode != 1) {
+				return (1);
+			}
+
+			if (jit_fetch (d, &ext)) {
+				return (1);
+			}
+
+			in->type = JIT_DBCC;
+			in->cond = (op >> 8) & 15;
+			in->reg = op & 7;
+			in->target = (in->pc + 2 + e68_exts16 (ext)) & 0xffffffff;
+
+			if (in->target & 1) {
+				return (1);
+			}
+			break;
+		}
+
+		in->alu = (op & 0x0100) ? JIT_SUB : JIT_ADD;
+		in->size = jit_size (op >> 6);
+		in->imm = (op >> 9) & 7;
+		in->reg = op & 7;
+
+		if (in->imm == 0) {
+			in->imm = 8;
+		}
+
+		if (mode == 0) {
+			in->type = JIT_QUICK;
+			in->clk = (in->size == 32) ? 12 : 8;
+		}
+		else if ((mode == 1) && (in->size != 8)) {
+			in->type = JIT_QUICKA;
+			in->clk = (in->size == 32) ? 12 : 8;
+		}
+		else {
+			return (1);
+		}
+		break;
+
+	case 0x06:
+		in->type = JIT_BCC;
+		in->cond = (op >> 8) & 15;
+
+		if (in->cond == 1) {
+			/* BSR */
+			return (1);
+		}
+
+		if (op & 0xff) {
+			in->target = in->pc + 2 + e68_exts8 (op);
+		}
+		else {
+			if (jit_fetch (d, &ext)) {
+				return (1);
+			}
+
+			in->target = in->pc + 2 + e68_exts16 (ext);
+		}
+
+		in->target &= 0xffffffff;
+
+		if (in->target & 1) {
+			return (1);
+		}
+		break;
+
+	case 0x07:
+		if (op & 0x0100) {
+			return (1);
+		}
+
+		in->type = JIT_MOVEQ;
+		in->reg = (op >> 9) & 7;
+		in->imm = e68_exts8 (op);
+		in->clk = 4;
+		break;
+
+	case 0x08:
+		if (jit_dec_alu (d, in, JIT_OR, clk_or, msk_logic)) {
+			return (1);
+		}
+		break;
+
+	case 0x09:
+		if (jit_dec_alu (d, in, JIT_SUB, clk_sub, msk_arith)) {
+			return (1);
+		}
+		break;
+
+	case 0x0b:
+		if (jit_dec_alu (d, in, JIT_CMP, clk_cmp, msk_arith)) {
+			return (1);
+		}
+		break;
+
+	case 0x0c:
+		if (jit_dec_alu (d, in, JIT_AND, clk_and, msk_logic)) {
+			return (1);
+		}
+		break;
+
+	case 0x0d:
+		if (jit_dec_alu (d, in, JIT_ADD, clk_add, msk_arith)) {
+			return (1);
+		}
+		break;
+
+	default:
+		return (1);
+	}
+
+	in->len = (d->pc - in->pc) / 2;
+
+	return (0);
+}
+
+
+/*****************************************************************************
+ * code generation
+ *****************************************************************************/
+
+/*
+ * Host register usage in translated code:
+ *   rbx  e68000_t *
+ *   r12  remaining clock budget
+ *   r13  delay of the previous instruction
+ *   r14  RAM base
+ *   r15  RAM size
+ *   rbp  instruction cache page bitmap
+ *   rsi  source address, r8 its pending address register update
+ *   rdi  destination address, r9 its pending address register update
+ */
+
+#define JIT_NO_REG 16
+
+static
+unsigned jit_label_exit (e68_jit_t *j, unsigned idx)
+{
+	return (E68_JIT_INSN + 1 + idx);
+}
+
+static
+void jit_get_areg (e68_jit_t *j, unsigned r, unsigned n)
+{
+	if (j->pend == n) {
+		jit_mov_rr (j, r, R8);
+	}
+	else {
+		jit_op_mem (j, 0, 0, 0x8b, r, RBX, OFS_AREG (n));
+	}
+}
+
+/* load the (sign extended) index register into r10 */
+static
+void jit_get_index (e68_jit_t *j, const e68_jit_ea_t *ea)
+{
+	if (ea->idx & 8) {
+		jit_get_areg (j, R10, ea->idx & 7);
+	}
+	else {
+		jit_op_mem (j, 0, 0, 0x8b, R10, RBX, OFS_DREG (ea->idx));
+	}
+
+	if (ea->idx_long == 0) {
+		/* movsx r10d, r10w */
+		jit_op_reg (j, 0, 0, 0x0fbf, R10, R10);
+	}
+}
+
+/*
+ * Compute the address of a memory operand into r. An address register
+ * update is computed into upd. Returns the updated register or
+ * JIT_NO_REG.
+ */
+static
+unsigned jit_ea_addr (e68_jit_t *j, const e68_jit_ea_t *ea, unsigned r, unsigned upd)
+{
+	switch (ea->mode) {
+	case JIT_EA_AIND:
+		jit_get_areg (j, r, ea->reg);
+		break;
+
+	case JIT_EA_AINC:
+		jit_get_areg (j, r, ea->reg);
+		jit_lea (j, upd, r, ea->val);
+		return (ea->reg);
+
+	case JIT_EA_ADEC:
+		jit_get_areg (j, upd, ea->reg);
+		jit_alu_ri (j, 0, 5, upd, ea->val);
+		jit_mov_rr (j, r, upd);
+		return (ea->reg);
+
+	case JIT_EA_ADISP:
+		jit_get_areg (j, r, ea->reg);
+		jit_alu_ri (j, 0, 0, r, ea->val);
+		break;
+
+	case JIT_EA_AIDX:
+		jit_get_index (j, ea);
+		jit_get_areg (j, r, ea->reg);
+		jit_op_reg (j, 0, 0, 0x01, R10, r);
+		jit_alu_ri (j, 0, 0, r, ea->val);
+		break;
+
+	case JIT_EA_PCIDX:
+		jit_get_index (j, ea);
+		jit_mov_ri (j, r, ea->val);
+		jit_op_reg (j, 0, 0, 0x01, R10, r);
+		break;
+
+	case JIT_EA_ABS:
+		jit_mov_ri (j, r, ea->val);
+		break;
+	}
+
+	return (JIT_NO_REG);
+}
+
+static
+int jit_ea_is_mem (const e68_jit_ea_t *ea)
+{
+	return (ea->mode >= JIT_EA_AIND) && (ea->mode <= JIT_EA_ABS);
+}
+
+/* exit if the page containing the address in r holds cached code */
+static
+void jit_check_page (e68_jit_t *j, unsigned r, unsigned label)
+{
+	jit_mov_rr (j, R11, r);
+	jit_shift_ri (j, 0, 5, R11, E68_ICACHE_SHIFT);
+	jit_mov_rr (j, RCX, R11);
+	jit_shift_ri (j, 0, 5, R11, 3);
+	jit_alu_ri (j, 0, 4, RCX, 7);
+	/* movzx r11d, byte [rbp + r11] */
+	jit_op_sib (j, 0, 0, 0x0fb6, R11, RBP, R11, 0, 0);
+	/* bt r11d, ecx */
+	jit_op_reg (j, 0, 0, 0x0fa3, RCX, R11);
+	jit_jcc (j, X86_B, label);
+}
+
+/* exit if the address in r is inside of the write watch region */
+static
+void jit_check_watch (e68_jit_t *j, unsigned r, unsigned label)
+{
+	jit_mov_rr (j, R11, r);
+	/* sub r11d, [rbx + wr_addr] */
+	jit_op_mem (j, 0, 0, 0x2b, R11, RBX, OFS (wr_addr));
+	/* cmp r11d, [rbx + wr_cnt] */
+	jit_op_mem (j, 0, 0, 0x3b, R11, RBX, OFS (wr_cnt));
+	jit_jcc (j, X86_B, label);
+}
+
+/*
+ * Mask the address in r to 24 bits and exit if the access is not
+ * completely inside of RAM, or if a write would hit cached code or
+ * the write watch region.
+ */
+static
+void jit_check_ram (e68_jit_t *j, unsigned r, unsigned size, int wr, unsigned label)
+{
+	jit_alu_ri (j, 0, 4, r, 0x00ffffff);
+	jit_lea (j, R10, r, size / 8 - 1);
+	/* cmp r10, r15 */
+	jit_op_reg (j, 0, 1, 0x39, R15, R10);
+	jit_jcc (j, X86_AE, label);
+
+	if (wr) {
+		jit_check_page (j, r, label);
+		jit_check_page (j, R10, label);
+		jit_check_watch (j, r, label);
+		jit_check_watch (j, R10, label);
+	}
+}
+
+/* load an operand zero extended into r */
+static
+void jit_load (e68_jit_t *j, const e68_jit_ea_t *ea, unsigned size, unsigned r, unsigned addr)
+{
+	switch (ea->mode) {
+	case JIT_EA_DREG:
+	case JIT_EA_AREG:
+		if (ea->mode == JIT_EA_DREG) {
+			addr = OFS_DREG (ea->reg);
+		}
+		else {
+			addr = OFS_AREG (ea->reg);
+		}
+
+		if (size == 32) {
+			jit_op_mem (j, 0, 0, 0x8b, r, RBX, addr);
+		}
+		else {
+			jit_op_mem (j, 0, 0, (size == 16) ? 0x0fb7 : 0x0fb6, r, RBX, addr);
+		}
+		break;
+
+	case JIT_EA_IMM:
+		jit_mov_ri (j, r, ea->val);
+		break;
+
+	default:
+		if (size == 32) {
+			jit_op_sib (j, 0, 0, 0x8b, r, R14, addr, 0, 0);
+			/* bswap */
+			jit_prefix (j, 0, 0, 0, 0, r, 0x0fc8 + (r & 7));
+		}
+		else if (size == 16) {
+			jit_op_sib (j, 0, 0, 0x0fb7, r, R14, addr, 0, 0);
+			/* rol r16, 8 */
+			jit_op_reg (j, 1, 0, 0xc1, 0, r);
+			jit_b (j, 8);
+		}
+		else {
+			jit_op_sib (j, 0, 0, 0x0fb6, r, R14, addr, 0, 0);
+		}
+		break;
+	}
+}
+
+/* store eax to a data register or to memory at [r14 + addr] */
+static
+void jit_store (e68_jit_t *j, const e68_jit_ea_t *ea, unsigned size, unsigned addr)
+{
+	if (ea->mode == JIT_EA_DREG) {
+		addr = OFS_DREG (ea->reg);
+
+		if (size == 32) {
+			jit_op_mem (j, 0, 0, 0x89, RAX, RBX, addr);
+		}
+		else if (size == 16) {
+			jit_op_mem (j, 1, 0, 0x89, RAX, RBX, addr);
+		}
+		else {
+			jit_op_mem (j, 0, 0, 0x88, RAX, RBX, addr);
+		}
+
+		return;
+	}
+
+	if (size == 32) {
+		jit_mov_rr (j, RDX, RAX);
+		jit_prefix (j, 0, 0, 0, 0, RDX, 0x0fc8 + RDX);
+		jit_op_sib (j, 0, 0, 0x89, RDX, R14, addr, 0, 0);
+	}
+	else if (size == 16) {
+		jit_mov_rr (j, RDX, RAX);
+		jit_op_reg (j, 1, 0, 0xc1, 0, RDX);
+		jit_b (j, 8);
+		jit_op_sib (j, 1, 0, 0x89, RDX, R14, addr, 0, 0);
+	}
+	else {
+		jit_op_sib (j, 0, 0, 0x88, RAX, R14, addr, 0, 0);
+	}
+}
+
+/* store a sized result in eax to a data register */
+static
+void jit_store_dreg (e68_jit_t *j, unsigned reg, unsigned size)
+{
+	e68_jit_ea_t ea;
+
+	ea.mode = JIT_EA_DREG;
+	ea.reg = reg;
+
+	jit_store (j, &ea, size, 0);
+}
+
+static
+void jit_commit (e68_jit_t *j, unsigned reg, unsigned upd)
+{
+	if (reg != JIT_NO_REG) {
+		jit_op_mem (j, 0, 0, 0x89, upd, RBX, OFS_AREG (reg));
+	}
+}
+
+/* zero extend eax to size */
+static
+void jit_zext (e68_jit_t *j, unsigned r, unsigned size)
+{
+	if (size == 8) {
+		jit_op_reg (j, 0, 0, 0x0fb6, r, r);
+	}
+	else if (size == 16) {
+		jit_op_reg (j, 0, 0, 0x0fb7, r, r);
+	}
+	else {
+		jit_mov_rr (j, r, r);
+	}
+}
+
+/* record a lazy condition code operation, result in eax, s1 in ecx, s2 in edx */
+static
+void jit_set_cc (e68_jit_t *j, unsigned op, unsigned size)
+{
+	uint32_t msb;
+
+	msb = 1UL << (size - 1);
+
+	jit_op_mem (j, 0, 0, 0xc7, 0, RBX, OFS (cc_op));
+	jit_l (j, op);
+	jit_op_mem (j, 1, 0, 0xc7, 0, RBX, OFS (cc_msk));
+	jit_w (j, E68_SR_N | E68_SR_Z | E68_SR_V | E68_SR_C);
+	jit_op_mem (j, 0, 0, 0xc7, 0, RBX, OFS (cc_msb));
+	jit_l (j, msb);
+	jit_op_mem (j, 0, 0, 0x89, RAX, RBX, OFS (cc_d));
+
+	if (op == E68_CC_NZ) {
+		jit_op_mem (j, 0, 0, 0xc7, 0, RBX, OFS (cc_s1));
+		jit_l (j, 0);
+		jit_op_mem (j, 0, 0, 0xc7, 0, RBX, OFS (cc_s2));
+		jit_l (j, 0);
+	}
+	else {
+		jit_op_mem (j, 0, 0, 0x89, RCX, RBX, OFS (cc_s1));
+		jit_op_mem (j, 0, 0, 0x89, RDX, RBX, OFS (cc_s2));
+	}
+}
+
+/*
+ * Compute eax = edx + ecx or eax = edx - ecx for zero extended operands.
+ * The carry is bit <size> of the 64 bit result. Optionally copy it to X.
+ */
+static
+void jit_addsub (e68_jit_t *j, int sub, unsigned size, int setx)
+{
+	if (sub) {
+		jit_op_reg (j, 0, 1, 0x89, RDX, RAX);
+		jit_op_reg (j, 0, 1, 0x29, RCX, RAX);
+	}
+	else {
+		jit_op_reg (j, 0, 1, 0x89, RDX, RAX);
+		jit_op_reg (j, 0, 1, 0x01, RCX, RAX);
+	}
+
+	if (setx) {
+		jit_op_reg (j, 0, 1, 0x89, RAX, R10);
+		jit_shift_ri (j, 1, 5, R10, size - 4);
+		jit_alu_ri (j, 0, 4, R10, E68_SR_X);
+		/* and word [sr], ~X ; or word [sr], r10w */
+		jit_op_mem (j, 1, 0, 0x81, 4, RBX, OFS (sr));
+		jit_w (j, ~E68_SR_X & 0xffff);
+		jit_op_mem (j, 1, 0, 0x09, R10, RBX, OFS (sr));
+	}
+
+	jit_zext (j, RAX, size);
+}
+
+static
+void jit_flush_cc (e68_jit_t *j)
+{
+	unsigned skip;
+
+	skip = jit_new_label (j);
+
+	jit_op_mem (j, 0, 0, 0x83, 7, RBX, OFS (cc_op));
+	jit_b (j, E68_CC_NONE);
+	jit_jcc (j, X86_E, skip);
+	jit_op_reg (j, 0, 1, 0x89, RBX, RDI);
+	jit_call (j, e68_cc_flush);
+	jit_bind (j, skip);
+}
+
+/*
+ * The bookkeeping of e68_clock() and e68_execute() at the start of an
+ * instruction.
+ */
+static
+void jit_insn_start (e68_jit_t *j, const e68_jit_insn_t *in, unsigned idx)
+{
+	/* if (n < delay) exit */
+	jit_op_reg (j, 0, 1, 0x39, R13, R12);
+	jit_jcc (j, X86_B, jit_label_exit (j, idx));
+
+	/* n -= delay ; clkcnt += delay */
+	jit_op_reg (j, 0, 1, 0x29, R13, R12);
+	jit_op_mem (j, 0, 1, 0x01, R13, RBX, OFS (clkcnt));
+
+	/* last_pc[++last_pc_idx & (E68_LAST_PC_CNT - 1)] = pc */
+	jit_op_mem (j, 0, 0, 0x8b, RAX, RBX, OFS (last_pc_idx));
+	jit_alu_ri (j, 0, 0, RAX, 1);
+	jit_op_mem (j, 0, 0, 0x89, RAX, RBX, OFS (last_pc_idx));
+	jit_alu_ri (j, 0, 4, RAX, E68_LAST_PC_CNT - 1);
+	jit_op_sib (j, 0, 0, 0xc7, 0, RBX, RAX, 2, OFS (last_pc));
+	jit_l (j, in->pc);
+
+	/* ir[0] = opcode */
+	jit_op_mem (j, 1, 0, 0xc7, 0, RBX, OFS (ir));
+	jit_w (j, in->op);
+}
+
+static
+void jit_insn_end (e68_jit_t *j, unsigned clk)
+{
+	jit_mov_ri (j, R13, clk);
+	/* add qword [oprcnt], 1 */
+	jit_op_mem (j, 0, 1, 0x83, 0, RBX, OFS (oprcnt));
+	jit_b (j, 1);
+}
+
+/* find the instruction at addr in the block */
+static
+int jit_find_insn (e68_jit_t *j, uint32_t addr)
+{
+	unsigned i;
+
+	for (i = 0; i < j->insn_cnt; i++) {
+		if (j->insn[i].pc == addr) {
+			return (i);
+		}
+	}
+
+	return (-1);
+}
+
+/* the taken path of a branch */
+static
+void jit_branch (e68_jit_t *j, const e68_jit_insn_t *in, uint32_t pc, unsigned clk)
+{
+	int idx;
+
+	jit_insn_end (j, clk);
+
+	idx = jit_find_insn (j, in->target);
+
+	if (idx >= 0) {
+		jit_jmp (j, idx);
+		return;
+	}
+
+	/* leave the block through e68_jit_jump() */
+	jit_op_mem (j, 0, 1, 0x89, R13, RBX, OFS (delay));
+	jit_op_mem (j, 0, 0, 0xc7, 0, RBX, OFS (pc));
+	jit_l (j, pc);
+	jit_op_reg (j, 0, 1, 0x89, RBX, RDI);
+	jit_mov_ri (j, RSI, in->target);
+	jit_call (j, e68_jit_jump);
+	jit_op_reg (j, 0, 1, 0x89, R12, RAX);
+	jit_jmp (j, E68_JIT_INSN);
+}
+
+static
+void jit_gen_insn (e68_jit_t *j, const e68_jit_insn_t *in, unsigned idx)
+{
+	unsigned exit, next, lab;
+	unsigned upd_src, upd_dst;
+
+	exit = jit_label_exit (j, idx);
+	next = idx + 1;
+
+	j->pend = JIT_NO_REG;
+
+	upd_src = JIT_NO_REG;
+	upd_dst = JIT_NO_REG;
+
+	/* compute and check all memory operands before changing any state */
+	if (in->type == JIT_LEA) {
+		jit_ea_addr (j, &in->src, RSI, R8);
+	}
+	else if (jit_ea_is_mem (&in->src)) {
+		upd_src = jit_ea_addr (j, &in->src, RSI, R8);
+		j->pend = upd_src;
+	}
+
+	if ((in->type == JIT_MOVE) && jit_ea_is_mem (&in->dst)) {
+		upd_dst = jit_ea_addr (j, &in->dst, RDI, R9);
+	}
+
+	if ((in->type != JIT_LEA) && jit_ea_is_mem (&in->src)) {
+		jit_check_ram (j, RSI, in->size, 0, exit);
+	}
+
+	if ((in->type == JIT_MOVE) && jit_ea_is_mem (&in->dst)) {
+		jit_check_ram (j, RDI, in->size, 1, exit);
+	}
+
+	jit_insn_start (j, in, idx);
+
+	switch (in->type) {
+	case JIT_MOVE:
+		jit_commit (j, upd_src, R8);
+		jit_load (j, &in->src, in->size, RAX, RSI);
+		jit_commit (j, upd_dst, R9);
+		jit_store (j, &in->dst, in->size, RDI);
+		jit_set_cc (j, E68_CC_NZ, in->size);
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_MOVEA:
+		jit_commit (j, upd_src, R8);
+		jit_load (j, &in->src, in->size, RAX, RSI);
+
+		if (in->size == 16) {
+			jit_op_reg (j, 0, 0, 0x0fbf, RAX, RAX);
+		}
+
+		jit_op_mem (j, 0, 0, 0x89, RAX, RBX, OFS_AREG (in->reg));
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_MOVEQ:
+		jit_mov_ri (j, RAX, in->imm);
+		jit_op_mem (j, 0, 0, 0x89, RAX, RBX, OFS_DREG (in->reg));
+		jit_set_cc (j, E68_CC_NZ, 32);
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_ALU:
+		jit_commit (j, upd_src, R8);
+		jit_load (j, &in->src, in->size, RCX, RSI);
+		jit_op_mem (j, 0, 0, (in->size == 32) ? 0x8b : ((in->size == 16) ? 0x0fb7 : 0x0fb6),
+			RDX, RBX, OFS_DREG (in->reg)
+		);
+
+		if ((in->alu == JIT_AND) || (in->alu == JIT_OR)) {
+			jit_mov_rr (j, RAX, RCX);
+			jit_op_reg (j, 0, 0, (in->alu == JIT_AND) ? 0x21 : 0x09, RDX, RAX);
+			jit_set_cc (j, E68_CC_NZ, in->size);
+		}
+		else {
+			jit_addsub (j, in->alu != JIT_ADD, in->size, in->alu != JIT_CMP);
+			jit_set_cc (j, (in->alu == JIT_ADD) ? E68_CC_ADD : E68_CC_SUB, in->size);
+		}
+
+		if (in->alu != JIT_CMP) {
+			jit_store_dreg (j, in->reg, in->size);
+		}
+
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_ALUA:
+		jit_commit (j, upd_src, R8);
+		jit_load (j, &in->src, in->size, RCX, RSI);
+
+		if (in->size == 16) {
+			jit_op_reg (j, 0, 0, 0x0fbf, RCX, RCX);
+		}
+
+		jit_op_mem (j, 0, 0, 0x8b, RDX, RBX, OFS_AREG (in->reg));
+
+		if (in->alu == JIT_CMP) {
+			jit_addsub (j, 1, 32, 0);
+			jit_set_cc (j, E68_CC_SUB, 32);
+		}
+		else {
+			jit_mov_rr (j, RAX, RDX);
+			jit_op_reg (j, 0, 0, (in->alu == JIT_ADD) ? 0x01 : 0x29, RCX, RAX);
+			jit_op_mem (j, 0, 0, 0x89, RAX, RBX, OFS_AREG (in->reg));
+		}
+
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_QUICK:
+		jit_mov_ri (j, RCX, in->imm);
+		jit_op_mem (j, 0, 0, (in->size == 32) ? 0x8b : ((in->size == 16) ? 0x0fb7 : 0x0fb6),
+			RDX, RBX, OFS_DREG (in->reg)
+		);
+		jit_addsub (j, in->alu == JIT_SUB, in->size, 1);
+		jit_set_cc (j, (in->alu == JIT_ADD) ? E68_CC_ADD : E68_CC_SUB, in->size);
+		jit_store_dreg (j, in->reg, in->size);
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_QUICKA:
+		jit_op_mem (j, 0, 0, 0x81, (in->alu == JIT_ADD) ? 0 : 5, RBX, OFS_AREG (in->reg));
+		jit_l (j, in->imm);
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_TST:
+		jit_commit (j, upd_src, R8);
+		jit_load (j, &in->src, in->size, RAX, RSI);
+		jit_set_cc (j, E68_CC_NZ, in->size);
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_CLR:
+		jit_flush_cc (j);
+		jit_op_mem (j, 1, 0, 0x81, 4, RBX, OFS (sr));
+		jit_w (j, ~(E68_SR_N | E68_SR_V | E68_SR_C | E68_SR_Z) & 0xffff);
+		jit_op_mem (j, 1, 0, 0x81, 1, RBX, OFS (sr));
+		jit_w (j, E68_SR_Z);
+		jit_mov_ri (j, RAX, 0);
+		jit_store_dreg (j, in->reg, in->size);
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_LEA:
+		jit_op_mem (j, 0, 0, 0x89, RSI, RBX, OFS_AREG (in->reg));
+		jit_insn_end (j, in->clk);
+		break;
+
+	case JIT_BCC:
+		lab = jit_new_label (j);
+
+		if (in->cond != 0) {
+			jit_op_reg (j, 0, 1, 0x89, RBX, RDI);
+			jit_mov_ri (j, RSI, in->cond);
+			jit_call (j, e68_jit_cond);
+			jit_op_reg (j, 0, 0, 0x85, RAX, RAX);
+			jit_jcc (j, X86_E, lab);
+		}
+
+		jit_branch (j, in, (in->op & 0xff) ? in->pc : (in->pc + 2), 10);
+
+		jit_bind (j, lab);
+
+		if (in->cond != 0) {
+			jit_insn_end (j, (in->op & 0xff) ? 8 : 12);
+		}
+		break;
+
+	case JIT_DBCC:
+		lab = jit_new_label (j);
+
+		if (in->cond == 0) {
+			jit_jmp (j, lab);
+		}
+		else if (in->cond != 1) {
+			jit_op_reg (j, 0, 1, 0x89, RBX, RDI);
+			jit_mov_ri (j, RSI, in->cond);
+			jit_call (j, e68_jit_cond);
+			jit_op_reg (j, 0, 0, 0x85, RAX, RAX);
+			jit_jcc (j, X86_NE, lab);
+		}
+
+		/* decrement the counter and check for -1 */
+		jit_op_mem (j, 0, 0, 0x0fb7, RAX, RBX, OFS_DREG (in->reg));
+		jit_alu_ri (j, 0, 5, RAX, 1);
+		jit_op_mem (j, 1, 0, 0x89, RAX, RBX, OFS_DREG (in->reg));
+
+		next = jit_new_label (j);
+
+		jit_alu_ri (j, 0, 7, RAX, 0xffffffff);
+		jit_jcc (j, X86_NE, next);
+		jit_insn_end (j, 14);
+		jit_jmp (j, idx + 1);
+
+		jit_bind (j, next);
+		jit_branch (j, in, in->pc + 2, 10);
+
+		jit_bind (j, lab);
+		jit_insn_end (j, 12);
+		break;
+	}
+}
+
+/* the state at the start of instruction idx */
+static
+void jit_gen_exit (e68_jit_t *j, unsigned idx, uint32_t start)
+{
+	uint32_t pc;
+	unsigned ofs;
+
+	pc = (idx < j->insn_cnt) ? j->insn[idx].pc : (j->insn[idx - 1].pc + 2 * j->insn[idx - 1].len);
+	ofs = (pc - start) / 2;
+
+	jit_op_mem (j, 0, 0, 0xc7, 0, RBX, OFS (pc));
+	jit_l (j, pc);
+	jit_op_mem (j, 0, 0, 0xc7, 0, RBX, OFS (ir_pc));
+	jit_l (j, pc + 4);
+	jit_op_mem (j, 0, 0, 0xc7, 0, RBX, OFS (ir) + 2);
+	jit_l (j, j->word[ofs] | ((uint32_t) j->word[ofs + 1] << 16));
+	jit_op_mem (j, 0, 1, 0x89, R13, RBX, OFS (delay));
+	jit_op_reg (j, 0, 1, 0x89, R12, RAX);
+	jit_jmp (j, E68_JIT_INSN);
+}
+
+static
+void jit_gen_block (e68_jit_t *j, uint32_t start)
+{
+	unsigned i;
+
+	static const unsigned char regs[6] = { RBX, RBP, R12, R13, R14, R15 };
+
+	j->label_cnt = 2 * E68_JIT_INSN + 2;
+	j->fix_cnt = 0;
+
+	for (i = 0; i < j->label_cnt; i++) {
+		j->label[i] = NULL;
+	}
+
+	for (i = 0; i < 6; i++) {
+		jit_prefix (j, 0, 0, 0, 0, regs[i], 0x50 + (regs[i] & 7));
+	}
+
+	/* sub rsp, 8 */
+	jit_op_reg (j, 0, 1, 0x83, 5, RSP);
+	jit_b (j, 8);
+
+	jit_op_reg (j, 0, 1, 0x89, RDI, RBX);
+	jit_op_reg (j, 0, 1, 0x89, RSI, R12);
+	jit_op_mem (j, 0, 1, 0x8b, R13, RBX, OFS (delay));
+	jit_op_mem (j, 0, 1, 0x8b, R14, RBX, OFS (ram));
+	jit_op_mem (j, 0, 1, 0x8b, R15, RBX, OFS (ram_cnt));
+	jit_op_mem (j, 0, 1, 0x8b, RBP, RBX, OFS (ic_page));
+
+	for (i = 0; i < j->insn_cnt; i++) {
+		jit_bind (j, i);
+		jit_gen_insn (j, &j->insn[i], i);
+	}
+
+	/* falling off the end of the block */
+	jit_bind (j, j->insn_cnt);
+
+	for (i = j->insn_cnt + 1; i > 0; i--) {
+		jit_bind (j, jit_label_exit (j, i - 1));
+		jit_gen_exit (j, i - 1, start);
+	}
+
+	jit_bind (j, E68_JIT_INSN);
+
+	/* add rsp, 8 */
+	jit_op_reg (j, 0, 1, 0x83, 0, RSP);
+	jit_b (j, 8);
+
+	for (i = 6; i > 0; i--) {
+		jit_prefix (j, 0, 0, 0, 0, regs[i - 1], 0x58 + (regs[i - 1] & 7));
+	}
+
+	jit_b (j, 0xc3);
+}
+
+
+/*****************************************************************************
+ * block management
+ *****************************************************************************/
+
+static
+void e68_jit_mark (e68000_t *c, uint32_t addr, uint32_t end)
+{
+	uint32_t page;
+
+	addr &= 0x00ffffff;
+	end &= 0x00ffffff;
+
+	if ((c->ic_page == NULL) || (end <= addr) || (end > c->ram_cnt)) {
+		return;
+	}
+
+	for (page = addr >> E68_ICACHE_SHIFT; page <= ((end - 1) >> E68_ICACHE_SHIFT); page++) {
+		c->ic_page[page >> 3] |= 1 << (page & 7);
+	}
+}
+
+static
+int e68_jit_translate (e68000_t *c, e68_jit_ent_t *ent)
+{
+	e68_jit_t      *j = c->jit;
+	e68_jit_dec_t  d;
+	e68_jit_insn_t *in;
+	uint32_t       end;
+	uint16_t       tmp;
+
+	if ((c->pc & 1) || (c->flags & (E68_FLAG_68010 | E68_FLAG_68020))) {
+		return (1);
+	}
+
+	d.j = j;
+	d.c = c;
+	d.start = c->pc;
+	d.pc = c->pc;
+	d.cnt = 0;
+
+	j->insn_cnt = 0;
+
+	while (j->insn_cnt < E68_JIT_INSN) {
+		in = &j->insn[j->insn_cnt];
+
+		if (jit_dec_insn (&d, in)) {
+			break;
+		}
+
+		/* the two words prefetched after the instruction */
+		end = d.pc;
+
+		if (jit_fetch (&d, &tmp) || jit_fetch (&d, &tmp)) {
+			break;
+		}
+
+		d.pc = end;
+
+		j->insn_cnt += 1;
+
+		if ((in->type == JIT_BCC) && (in->cond == 0)) {
+			break;
+		}
+	}
+
+	if (j->insn_cnt == 0) {
+		return (1);
+	}
+
+	in = &j->insn[j->insn_cnt - 1];
+	end = in->pc + 2 * in->len;
+
+	if ((E68_JIT_CODE_SIZE - j->code_used) < E68_JIT_CODE_MAX) {
+		e68_jit_flush (c);
+
+		/* the flush also cleared the entry that is being filled */
+		ent->pc = d.start;
+		ent->cnt = E68_JIT_HOT;
+		ent->fct = NULL;
+	}
+
+	j->p = j->code + j->code_used;
+	j->end = j->p + E68_JIT_CODE_MAX;
+	j->err = 0;
+
+	jit_gen_block (j, d.start);
+
+	if (j->err || jit_resolve (j)) {
+		return (1);
+	}
+
+	ent->fct = (e68_jit_block_f) (void *) (j->code + j->code_used);
+	ent->end = end + 4;
+	ent->ir[0] = j->word[0];
+	ent->ir[1] = j->word[1];
+
+	j->code_used = (j->p - j->code + 15) & ~15UL;
+
+	e68_jit_mark (c, ent->pc, ent->end);
+
+	return (0);
+}
+
+void e68_jit_flush (e68000_t *c)
+{
+	unsigned i;
+
+	if (c->jit == NULL) {
+		return;
+	}
+
+	for (i = 0; i < E68_JIT_CNT; i++) {
+		c->jit->ent[i].pc = E68_JIT_NONE;
+		c->jit->ent[i].cnt = 0;
+		c->jit->ent[i].fct = NULL;
+	}
+
+	c->jit->code_used = 0;
+}
+
+void e68_jit_invalidate (e68000_t *c, uint32_t addr)
+{
+	uint32_t      base, end;
+	e68_jit_ent_t *ent;
+
+	if (c->jit == NULL) {
+		return;
+	}
+
+	base = addr & ~((1UL << E68_ICACHE_SHIFT) - 1);
+	end = base + (1UL << E68_ICACHE_SHIFT);
+
+	/* blocks starting in the previous pages may reach into this one */
+	base = (base >= E68_JIT_SPAN) ? (base - E68_JIT_SPAN) : 0;
+
+	while (base < end) {
+		ent = &c->jit->ent[(base >> 1) & (E68_JIT_CNT - 1)];
+
+		if ((ent->pc & 0x00ffffff) == base) {
+			ent->pc = E68_JIT_NONE;
+			ent->fct = NULL;
+		}
+
+		base += 2;
+	}
+}
+
+int e68_jit_exec (e68000_t *c, unsigned long *n)
+{
+	e68_jit_ent_t *ent;
+	unsigned long cnt;
+
+	if (c->halt || c->int_nmi || (c->sr & E68_SR_T)) {
+		return (0);
+	}
+
+	if (c->int_ipl > e68_get_iml (c)) {
+		return (0);
+	}
+
+	ent = &c->jit->ent[(c->pc >> 1) & (E68_JIT_CNT - 1)];
+
+	if (ent->pc != c->pc) {
+		ent->pc = c->pc;
+		ent->cnt = 1;
+		ent->fct = NULL;
+		return (0);
+	}
+
+	if (ent->fct == NULL) {
+		if (ent->cnt == E68_JIT_FAIL) {
+			return (0);
+		}
+
+		ent->cnt += 1;
+
+		if (ent->cnt < E68_JIT_HOT) {
+			return (0);
+		}
+
+		if (e68_jit_translate (c, ent)) {
+			ent->cnt = E68_JIT_FAIL;
+			ent->fct = NULL;
+			return (0);
+		}
+	}
+
+	if ((ent->ir[0] != c->ir[1]) || (ent->ir[1] != c->ir[2])) {
+		return (0);
+	}
+
+	cnt = c->oprcnt;
+
+	*n = ent->fct (c, *n);
+
+	if (c->oprcnt == cnt) {
+		/* the first instruction can't run in native code */
+		ent->cnt = E68_JIT_FAIL;
+		ent->fct = NULL;
+		return (0);
+	}
+
+	return (1);
+}
+
+int e68_set_jit (e68000_t *c, int enable)
+{
+	e68_jit_t *j;
+	void      *code;
+
+	if (enable == 0) {
+		e68_jit_free (c);
+		return (0);
+	}
+
+	if (c->jit != NULL) {
+		return (0);
+	}
+
+	if ((c->ic == NULL) || (c->flags & (E68_FLAG_68010 | E68_FLAG_68020))) {
+		return (1);
+	}
+
+	code = mmap (NULL, E68_JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+	);
+
+	if (code == MAP_FAILED) {
+		return (1);
+	}
+
+	j = malloc (sizeof (e68_jit_t));
+
+	if (j == NULL) {
+		munmap (code, E68_JIT_CODE_SIZE);
+		return (1);
+	}
+
+	j->code = code;
+
+	c->jit = j;
+
+	e68_jit_flush (c);
+
+	return (0);
+}
+
+void e68_jit_free (e68000_t *c)
+{
+	if (c->jit == NULL) {
+		return;
+	}
+
+	munmap (c->jit->code, E68_JIT_CODE_SIZE);
+	free (c->jit);
+
+	c->jit = NULL;
+}
+
+#else
+
+int e68_set_jit (e68000_t *c, int enable)
+{
+	return (enable != 0);
+}
+
+void e68_jit_free (e68000_t *c)
+{
+}
+
+void e68_jit_flush (e68000_t *c)
+{
+}
+
+void e68_jit_invalidate (e68000_t *c, uint32_t addr)
+{
+}
+
+int e68_jit_exec (e68000_t *c, unsigned long *n)
+{
+	return (0);
+}
+
+#endif
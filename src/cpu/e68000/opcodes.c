@@ -20,6 +20,8 @@
  *****************************************************************************/
 
 
+#include <stdlib.h>
+
 #include "e68000.h"
 #include "internal.h"
 
@@ -3740,6 +3742,8 @@ static void opc100_00 (e68000_t *c)
 
 	d = (uint16_t) s1 + (uint16_t) s2 + e68_get_sr_x (c);
 
+	e68_cc_sync (c);
+
 	/* incorrect */
 	if (((s1 & 0x0f) + (s2 & 0x0f)) > 9) {
 		d += 0x06;
@@ -5190,24 +5194,27 @@ static void opf000 (e68000_t *c)
 	e68_exception_fxxx (c);
 }
 
-static
+/* undefined opcodes */
+#define opundf e68_op_undefined
+
+static const
 e68_opcode_f e68_opcodes[1024] = {
-	op0000, op0040, op0080,   NULL, op0100, op0140, op0180, op01c0, /* 0000 */
-	op0200, op0240, op0280,   NULL, op0100, op0140, op0180, op01c0, /* 0200 */
-	op0400, op0440, op0480,   NULL, op0100, op0140, op0180, op01c0, /* 0400 */
-	op0600, op0640, op0680,   NULL, op0100, op0140, op0180, op01c0, /* 0600 */
+	op0000, op0040, op0080, opundf, op0100, op0140, op0180, op01c0, /* 0000 */
+	op0200, op0240, op0280, opundf, op0100, op0140, op0180, op01c0, /* 0200 */
+	op0400, op0440, op0480, opundf, op0100, op0140, op0180, op01c0, /* 0400 */
+	op0600, op0640, op0680, opundf, op0100, op0140, op0180, op01c0, /* 0600 */
 	op0800, op0840, op0880, op08c0, op0100, op0140, op0180, op01c0, /* 0800 */
-	op0a00, op0a40, op0a80,   NULL, op0100, op0140, op0180, op01c0, /* 0A00 */
-	op0c00, op0c40, op0c80,   NULL, op0100, op0140, op0180, op01c0, /* 0C00 */
-	op0e00, op0e40, op0e80,   NULL, op0100, op0140, op0180, op01c0, /* 0E00 */
-	op1000,   NULL, op1000, op1000, op1000, op1000, op1000, op1000, /* 1000 */
-	op1000,   NULL, op1000, op1000, op1000, op1000, op1000, op1000, /* 1200 */
-	op1000,   NULL, op1000, op1000, op1000, op1000, op1000, op1000, /* 1400 */
-	op1000,   NULL, op1000, op1000, op1000, op1000, op1000, op1000, /* 1600 */
-	op1000,   NULL, op1000, op1000, op1000, op1000, op1000, op1000, /* 1800 */
-	op1000,   NULL, op1000, op1000, op1000, op1000, op1000, op1000, /* 1A00 */
-	op1000,   NULL, op1000, op1000, op1000, op1000, op1000, op1000, /* 1C00 */
-	op1000,   NULL, op1000, op1000, op1000, op1000, op1000, op1000, /* 1E00 */
+	op0a00, op0a40, op0a80, opundf, op0100, op0140, op0180, op01c0, /* 0A00 */
+	op0c00, op0c40, op0c80, opundf, op0100, op0140, op0180, op01c0, /* 0C00 */
+	op0e00, op0e40, op0e80, opundf, op0100, op0140, op0180, op01c0, /* 0E00 */
+	op1000, opundf, op1000, op1000, op1000, op1000, op1000, op1000, /* 1000 */
+	op1000, opundf, op1000, op1000, op1000, op1000, op1000, op1000, /* 1200 */
+	op1000, opundf, op1000, op1000, op1000, op1000, op1000, op1000, /* 1400 */
+	op1000, opundf, op1000, op1000, op1000, op1000, op1000, op1000, /* 1600 */
+	op1000, opundf, op1000, op1000, op1000, op1000, op1000, op1000, /* 1800 */
+	op1000, opundf, op1000, op1000, op1000, op1000, op1000, op1000, /* 1A00 */
+	op1000, opundf, op1000, op1000, op1000, op1000, op1000, op1000, /* 1C00 */
+	op1000, opundf, op1000, op1000, op1000, op1000, op1000, op1000, /* 1E00 */
 	op2000, op2040, op2000, op2000, op2000, op2000, op2000, op2000, /* 2000 */
 	op2000, op2040, op2000, op2000, op2000, op2000, op2000, op2000, /* 2200 */
 	op2000, op2040, op2000, op2000, op2000, op2000, op2000, op2000, /* 2400 */
@@ -5224,14 +5231,14 @@ e68_opcode_f e68_opcodes[1024] = {
 	op3000, op3040, op3000, op3000, op3000, op3000, op3000, op3000, /* 3A00 */
 	op3000, op3040, op3000, op3000, op3000, op3000, op3000, op3000, /* 3C00 */
 	op3000, op3040, op3000, op3000, op3000, op3000, op3000, op3000, /* 3E00 */
-	op4000, op4040, op4080, op40c0,   NULL,   NULL, op4180, op41c0, /* 4000 */
-	op4200, op4240, op4280, op42c0,   NULL,   NULL, op4180, op41c0, /* 4200 */
-	op4400, op4440, op4480, op44c0,   NULL,   NULL, op4180, op41c0, /* 4400 */
-	op4600, op4640, op4680, op46c0,   NULL,   NULL, op4180, op41c0, /* 4600 */
-	op4800, op4840, op4880, op48c0,   NULL,   NULL, op4180, op49c0, /* 4800 */
-	op4a00, op4a40, op4a80, op4ac0,   NULL,   NULL, op4180, op41c0, /* 4A00 */
-	  NULL,   NULL, op4c80, op4cc0,   NULL,   NULL, op4180, op41c0, /* 4C00 */
-	  NULL, op4e40, op4e80, op4ec0,   NULL,   NULL, op4180, op41c0, /* 4E00 */
+	op4000, op4040, op4080, op40c0, opundf, opundf, op4180, op41c0, /* 4000 */
+	op4200, op4240, op4280, op42c0, opundf, opundf, op4180, op41c0, /* 4200 */
+	op4400, op4440, op4480, op44c0, opundf, opundf, op4180, op41c0, /* 4400 */
+	op4600, op4640, op4680, op46c0, opundf, opundf, op4180, op41c0, /* 4600 */
+	op4800, op4840, op4880, op48c0, opundf, opundf, op4180, op49c0, /* 4800 */
+	op4a00, op4a40, op4a80, op4ac0, opundf, opundf, op4180, op41c0, /* 4A00 */
+	opundf, opundf, op4c80, op4cc0, opundf, opundf, op4180, op41c0, /* 4C00 */
+	opundf, op4e40, op4e80, op4ec0, opundf, opundf, op4180, op41c0, /* 4E00 */
 	op5000, op5040, op5080, op50c0, op5100, op5140, op5180, op51c0, /* 5000 */
 	op5000, op5040, op5080, op52c0, op5100, op5140, op5180, op53c0, /* 5200 */
 	op5000, op5040, op5080, op54c0, op5100, op5140, op5180, op55c0, /* 5400 */
@@ -5248,14 +5255,14 @@ e68_opcode_f e68_opcodes[1024] = {
 	op6a00, op6a00, op6a00, op6a00, op6b00, op6b00, op6b00, op6b00, /* 6A00 */
 	op6c00, op6c00, op6c00, op6c00, op6d00, op6d00, op6d00, op6d00, /* 6C00 */
 	op6e00, op6e00, op6e00, op6e00, op6f00, op6f00, op6f00, op6f00, /* 6E00 */
-	op7000, op7000, op7000, op7000,   NULL,   NULL,   NULL,   NULL, /* 7000 */
-	op7000, op7000, op7000, op7000,   NULL,   NULL,   NULL,   NULL, /* 7200 */
-	op7000, op7000, op7000, op7000,   NULL,   NULL,   NULL,   NULL, /* 7400 */
-	op7000, op7000, op7000, op7000,   NULL,   NULL,   NULL,   NULL, /* 7600 */
-	op7000, op7000, op7000, op7000,   NULL,   NULL,   NULL,   NULL, /* 7800 */
-	op7000, op7000, op7000, op7000,   NULL,   NULL,   NULL,   NULL, /* 7A00 */
-	op7000, op7000, op7000, op7000,   NULL,   NULL,   NULL,   NULL, /* 7C00 */
-	op7000, op7000, op7000, op7000,   NULL,   NULL,   NULL,   NULL, /* 7E00 */
+	op7000, op7000, op7000, op7000, opundf, opundf, opundf, opundf, /* 7000 */
+	op7000, op7000, op7000, op7000, opundf, opundf, opundf, opundf, /* 7200 */
+	op7000, op7000, op7000, op7000, opundf, opundf, opundf, opundf, /* 7400 */
+	op7000, op7000, op7000, op7000, opundf, opundf, opundf, opundf, /* 7600 */
+	op7000, op7000, op7000, op7000, opundf, opundf, opundf, opundf, /* 7800 */
+	op7000, op7000, op7000, op7000, opundf, opundf, opundf, opundf, /* 7A00 */
+	op7000, op7000, op7000, op7000, opundf, opundf, opundf, opundf, /* 7C00 */
+	op7000, op7000, op7000, op7000, opundf, opundf, opundf, opundf, /* 7E00 */
 	op8000, op8040, op8080, op80c0, op8100, op8140, op8180, op81c0, /* 8000 */
 	op8000, op8040, op8080, op80c0, op8100, op8140, op8180, op81c0, /* 8200 */
 	op8000, op8040, op8080, op80c0, op8100, op8140, op8180, op81c0, /* 8400 */
@@ -5308,10 +5315,10 @@ e68_opcode_f e68_opcodes[1024] = {
 	ope000, ope040, ope080, ope2c0, ope100, ope140, ope180, ope3c0, /* E200 */
 	ope000, ope040, ope080, ope4c0, ope100, ope140, ope180, ope5c0, /* E400 */
 	ope000, ope040, ope080, ope6c0, ope100, ope140, ope180, ope7c0, /* E600 */
-	ope000, ope040, ope080,   NULL, ope100, ope140, ope180,   NULL, /* E800 */
-	ope000, ope040, ope080,   NULL, ope100, ope140, ope180,   NULL, /* EA00 */
-	ope000, ope040, ope080,   NULL, ope100, ope140, ope180,   NULL, /* EC00 */
-	ope000, ope040, ope080,   NULL, ope100, ope140, ope180,   NULL, /* EE00 */
+	ope000, ope040, ope080, opundf, ope100, ope140, ope180, opundf, /* E800 */
+	ope000, ope040, ope080, opundf, ope100, ope140, ope180, opundf, /* EA00 */
+	ope000, ope040, ope080, opundf, ope100, ope140, ope180, opundf, /* EC00 */
+	ope000, ope040, ope080, opundf, ope100, ope140, ope180, opundf, /* EE00 */
 	opf000, opf000, opf000, opf000, opf000, opf000, opf000, opf000, /* F000 */
 	opf000, opf000, opf000, opf000, opf000, opf000, opf000, opf000,
 	opf000, opf000, opf000, opf000, opf000, opf000, opf000, opf000,
@@ -5322,24 +5329,42 @@ e68_opcode_f e68_opcodes[1024] = {
 	opf000, opf000, opf000, opf000, opf000, opf000, opf000, opf000
 };
 
-static e68_opcode_f e68_op_49c0[8] = {
-	  NULL, op41c0, op41c0, op41c0, op41c0, op41c0, op41c0, op41c0
+static const e68_opcode_f e68_op_49c0[8] = {
+	opundf, op41c0, op41c0, op41c0, op41c0, op41c0, op41c0, op41c0
 };
 
 void e68_set_opcodes (e68000_t *c)
+{
+	/* the 68020 table is dropped so that icache fills use the spec ops */
+	free (c->optab);
+	c->optab = NULL;
+
+	c->opcodes = e68_opcodes;
+	c->op49c0 = e68_op_49c0;
+}
+
+e68_opcode_f *e68_get_opcodes (e68000_t *c)
 {
 	unsigned i;
 
-	for (i = 0; i < 1024; i++) {
-		if (e68_opcodes[i] != NULL) {
-			c->opcodes[i] = e68_opcodes[i];
-		}
-		else {
-			c->opcodes[i] = e68_op_undefined;
+	if (c->optab == NULL) {
+		c->optab = malloc ((1024 + 8) * sizeof (e68_opcode_f));
+
+		if (c->optab == NULL) {
+			return (NULL);
 		}
 	}
 
+	for (i = 0; i < 1024; i++) {
+		c->optab[i] = e68_opcodes[i];
+	}
+
 	for (i = 0; i < 8; i++) {
-		c->op49c0[i] = (e68_op_49c0[i] == NULL) ? e68_op_undefined : e68_op_49c0[i];
+		c->optab[1024 + i] = e68_op_49c0[i];
 	}
+
+	c->opcodes = c->optab;
+	c->op49c0 = c->optab + 1024;
+
+	return (c->optab);
 }
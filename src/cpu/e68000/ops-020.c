@@ -984,7 +984,7 @@ static void opefc0 (e68000_t *c)
 	e68_op_prefetch (c);
 }
 
-static
+static const
 e68_opcode_f e68020_opcodes[1024] = {
 	  NULL,   NULL,   NULL, op00c0,   NULL,   NULL,   NULL,   NULL, /* 0000 */
 	  NULL,   NULL,   NULL, op00c0,   NULL,   NULL,   NULL,   NULL, /* 0200 */
@@ -1116,26 +1116,32 @@ e68_opcode_f e68020_opcodes[1024] = {
 	  NULL,   NULL,   NULL,   NULL,   NULL,   NULL,   NULL,   NULL  /* FE00 */
 };
 
-static e68_opcode_f e68_op_49c0[8] = {
+static const e68_opcode_f e68_op_49c0[8] = {
 	op49c0_00, NULL, NULL, NULL, NULL, NULL, NULL, NULL
 };
 
 
 void e68_set_opcodes_020 (e68000_t *c)
 {
-	unsigned i;
+	unsigned     i;
+	e68_opcode_f *tab;
+
+	tab = e68_get_opcodes (c);
 
-	e68_set_opcodes (c);
+	if (tab == NULL) {
+		e68_set_opcodes (c);
+		return;
+	}
 
 	for (i = 0; i < 1024; i++) {
 		if (e68020_opcodes[i] != NULL) {
-			c->opcodes[i] = e68020_opcodes[i];
+			tab[i] = e68020_opcodes[i];
 		}
 	}
 
 	for (i = 0; i < 8; i++) {
 		if (e68_op_49c0[i] != NULL) {
-			c->op49c0[i] = e68_op_49c0[i];
+			tab[1024 + i] = e68_op_49c0[i];
 		}
 	}
 }
@@ -0,0 +1,718 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/cpu/e68000/ops-spec.c                                    *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+/*
+ * Opcode handlers that are specialized for their effective address modes.
+ *
+ * The generic handlers decode both effective addresses through e68_ea_tab
+ * and e68_ea_get_val*() on every execution. The handlers below have the
+ * addressing modes and the operand size compiled in, only the register
+ * numbers are still taken from the opcode. The instruction cache stores
+ * the specialized handler when an instruction is first cached, so the
+ * decoding happens once per cached instruction.
+ *
+ * Bcc and DBcc have their condition compiled in instead, BSR and Scc are
+ * left to the generic handlers.
+ *
+ * The modes are numbered like the bits in the ea.c valid ea mask.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "e68000.h"
+#include "internal.h"
+
+//We need speed here!
+#pragma GCC optimize ("O3")
+
+
+#define EA_DN 0
+#define EA_AN 1
+#define EA_AI 2
+#define EA_PI 3
+#define EA_PD 4
+#define EA_DI 5
+#define EA_AW 7
+#define EA_AL 8
+#define EA_IM 11
+
+#define EA_CNT 12
+
+
+static inline
+int spec_addr (e68000_t *c, unsigned m, unsigned reg, unsigned size, uint32_t *addr)
+{
+	uint32_t a;
+	unsigned n;
+
+	n = ((reg == 7) && (size == 8)) ? 2 : (size >> 3);
+
+	switch (m) {
+	case EA_AI:
+		*addr = e68_get_areg32 (c, reg);
+		break;
+
+	case EA_PI:
+		a = e68_get_areg32 (c, reg);
+		e68_set_areg32 (c, reg, a + n);
+		*addr = a;
+		break;
+
+	case EA_PD:
+		a = e68_get_areg32 (c, reg) - n;
+		e68_set_areg32 (c, reg, a);
+		e68_set_clk (c, 2);
+		*addr = a;
+		break;
+
+	case EA_DI:
+		if (e68_prefetch (c)) {
+			return (1);
+		}
+
+		*addr = e68_get_areg32 (c, reg) + e68_exts16 (c->ir[1]);
+		e68_set_clk (c, 4);
+		break;
+
+	case EA_AW:
+		if (e68_prefetch (c)) {
+			return (1);
+		}
+
+		*addr = e68_exts16 (c->ir[1]);
+		e68_set_clk (c, 4);
+		break;
+
+	case EA_AL:
+		if (e68_prefetch (c)) {
+			return (1);
+		}
+
+		a = c->ir[1];
+
+		if (e68_prefetch (c)) {
+			return (1);
+		}
+
+		*addr = (a << 16) | c->ir[1];
+		e68_set_clk (c, 8);
+		break;
+	}
+
+	return (0);
+}
+
+static inline
+int spec_mem_get (e68000_t *c, uint32_t addr, unsigned size, uint32_t *val)
+{
+	if ((size != 8) && (addr & 1)) {
+		if ((c->flags & E68_FLAG_NOADDR) == 0) {
+			e68_exception_address (c, addr, 1, 0);
+			return (1);
+		}
+	}
+
+	if (size == 8) {
+		*val = e68_get_mem8 (c, addr);
+		e68_set_clk (c, 4);
+	}
+	else if (size == 16) {
+		*val = e68_get_mem16 (c, addr);
+		e68_set_clk (c, 4);
+	}
+	else {
+		*val = e68_get_mem32 (c, addr);
+		e68_set_clk (c, 8);
+	}
+
+	if (c->bus_error) {
+		e68_exception_bus (c, addr, 1, 0);
+		return (1);
+	}
+
+	return (0);
+}
+
+static inline
+int spec_mem_set (e68000_t *c, uint32_t addr, unsigned size, uint32_t val)
+{
+	if ((size != 8) && (addr & 1)) {
+		if ((c->flags & E68_FLAG_NOADDR) == 0) {
+			e68_exception_address (c, addr, 1, 1);
+			return (1);
+		}
+	}
+
+	if (size == 8) {
+		e68_set_mem8 (c, addr, val);
+		e68_set_clk (c, 4);
+	}
+	else if (size == 16) {
+		e68_set_mem16 (c, addr, val);
+		e68_set_clk (c, 4);
+	}
+	else {
+		e68_set_mem32 (c, addr, val);
+		e68_set_clk (c, 8);
+	}
+
+	if (c->bus_error) {
+		e68_exception_bus (c, addr, 1, 1);
+		return (1);
+	}
+
+	return (0);
+}
+
+static inline
+int spec_get (e68000_t *c, unsigned m, unsigned reg, unsigned size, uint32_t *val)
+{
+	uint32_t addr;
+
+	if (m == EA_DN) {
+		if (size == 8) {
+			*val = e68_get_dreg8 (c, reg);
+		}
+		else if (size == 16) {
+			*val = e68_get_dreg16 (c, reg);
+		}
+		else {
+			*val = e68_get_dreg32 (c, reg);
+		}
+
+		return (0);
+	}
+
+	if (m == EA_AN) {
+		if (size == 16) {
+			*val = e68_get_areg16 (c, reg);
+		}
+		else {
+			*val = e68_get_areg32 (c, reg);
+		}
+
+		return (0);
+	}
+
+	if (m == EA_IM) {
+		if (e68_prefetch (c)) {
+			return (1);
+		}
+
+		*val = c->ir[1];
+
+		if (size == 32) {
+			if (e68_prefetch (c)) {
+				return (1);
+			}
+
+			*val = (*val << 16) | c->ir[1];
+			e68_set_clk (c, 8);
+		}
+		else {
+			if (size == 8) {
+				*val &= 0xff;
+			}
+
+			e68_set_clk (c, 4);
+		}
+
+		return (0);
+	}
+
+	if (spec_addr (c, m, reg, size, &addr)) {
+		return (1);
+	}
+
+	return (spec_mem_get (c, addr, size, val));
+}
+
+static inline
+int spec_set (e68000_t *c, unsigned m, unsigned reg, unsigned size, uint32_t val)
+{
+	uint32_t addr;
+
+	if (m == EA_DN) {
+		if (size == 8) {
+			e68_set_dreg8 (c, reg, val);
+		}
+		else if (size == 16) {
+			e68_set_dreg16 (c, reg, val);
+		}
+		else {
+			e68_set_dreg32 (c, reg, val);
+		}
+
+		return (0);
+	}
+
+	if (spec_addr (c, m, reg, size, &addr)) {
+		return (1);
+	}
+
+	return (spec_mem_set (c, addr, size, val));
+}
+
+
+/* MOVE.S <EA>, <EA> */
+#define SPEC_MOVE(sz, s, d) \
+static void op_move##sz##_##s##_##d (e68000_t *c) \
+{ \
+	uint32_t val; \
+	if (spec_get (c, s, e68_ir_reg0 (c), sz, &val)) return; \
+	if (spec_set (c, d, e68_ir_reg9 (c), sz, val)) return; \
+	e68_set_clk (c, 4); \
+	e68_cc_set_nz_##sz (c, E68_SR_NZVC, val); \
+	e68_op_prefetch (c); \
+}
+
+/* MOVEA.S <EA>, Ax */
+#define SPEC_MOVEA(sz, s) \
+static void op_movea##sz##_##s (e68000_t *c) \
+{ \
+	uint32_t val; \
+	if (spec_get (c, s, e68_ir_reg0 (c), sz, &val)) return; \
+	e68_set_areg32 (c, e68_ir_reg9 (c), (sz == 16) ? e68_exts16 (val) : val); \
+	e68_set_clk (c, 4); \
+	e68_op_prefetch (c); \
+}
+
+/* TST.S <EA> */
+#define SPEC_TST(sz, s) \
+static void op_tst##sz##_##s (e68000_t *c) \
+{ \
+	uint32_t val; \
+	if (spec_get (c, s, e68_ir_reg0 (c), sz, &val)) return; \
+	e68_set_clk (c, 8); \
+	e68_cc_set_nz_##sz (c, E68_SR_NZVC, val); \
+	e68_op_prefetch (c); \
+}
+
+/* CMP.S <EA>, Dx */
+#define SPEC_CMP(sz, s) \
+static void op_cmp##sz##_##s (e68000_t *c) \
+{ \
+	uint32_t s1, s2; \
+	if (spec_get (c, s, e68_ir_reg0 (c), sz, &s1)) return; \
+	spec_get (c, EA_DN, e68_ir_reg9 (c), sz, &s2); \
+	e68_set_clk (c, (sz == 32) ? 6 : 4); \
+	e68_cc_set_cmp_##sz (c, s2 - s1, s1, s2); \
+	e68_op_prefetch (c); \
+}
+
+/* ADDQ.S #X, <EA>, the address is computed once for read and write */
+#define SPEC_ADDQ(sz, m) \
+static void op_addq##sz##_##m (e68000_t *c) \
+{ \
+	uint32_t s1, s2, d, addr; \
+	s1 = (c->ir[0] >> 9) & 7; \
+	if (s1 == 0) s1 = 8; \
+	if (m == EA_DN) { \
+		spec_get (c, EA_DN, e68_ir_reg0 (c), sz, &s2); \
+	} \
+	else { \
+		if (spec_addr (c, m, e68_ir_reg0 (c), sz, &addr)) return; \
+		if (spec_mem_get (c, addr, sz, &s2)) return; \
+	} \
+	d = s1 + s2; \
+	e68_set_clk (c, (sz == 32) ? 12 : 8); \
+	e68_cc_set_add_##sz (c, d, s1, s2); \
+	e68_op_prefetch (c); \
+	if (m == EA_DN) { \
+		spec_set (c, EA_DN, e68_ir_reg0 (c), sz, d); \
+	} \
+	else { \
+		spec_mem_set (c, addr, sz, d); \
+	} \
+}
+
+/* ADDQ.S #X, Ax, always 32 bits and without condition codes */
+#define SPEC_ADDQA(sz) \
+static void op_addq##sz##_1 (e68000_t *c) \
+{ \
+	unsigned r; \
+	uint32_t s1; \
+	r = e68_ir_reg0 (c); \
+	s1 = (c->ir[0] >> 9) & 7; \
+	if (s1 == 0) s1 = 8; \
+	e68_set_clk (c, (sz == 32) ? 12 : 8); \
+	e68_op_prefetch (c); \
+	e68_set_areg32 (c, r, e68_get_areg32 (c, r) + s1); \
+}
+
+/* the 68000 conditions, by condition code number */
+#define SPEC_CC_0(c) 1
+#define SPEC_CC_1(c) 0
+#define SPEC_CC_2(c) (!e68_get_sr_c (c) && !e68_get_sr_z (c))
+#define SPEC_CC_3(c) (e68_get_sr_c (c) || e68_get_sr_z (c))
+#define SPEC_CC_4(c) (!e68_get_sr_c (c))
+#define SPEC_CC_5(c) (e68_get_sr_c (c))
+#define SPEC_CC_6(c) (!e68_get_sr_z (c))
+#define SPEC_CC_7(c) (e68_get_sr_z (c))
+#define SPEC_CC_8(c) (!e68_get_sr_v (c))
+#define SPEC_CC_9(c) (e68_get_sr_v (c))
+#define SPEC_CC_10(c) (!e68_get_sr_n (c))
+#define SPEC_CC_11(c) (e68_get_sr_n (c))
+#define SPEC_CC_12(c) (e68_get_sr_n (c) == e68_get_sr_v (c))
+#define SPEC_CC_13(c) (e68_get_sr_n (c) != e68_get_sr_v (c))
+#define SPEC_CC_14(c) ((e68_get_sr_n (c) == e68_get_sr_v (c)) && !e68_get_sr_z (c))
+#define SPEC_CC_15(c) ((e68_get_sr_n (c) != e68_get_sr_v (c)) || e68_get_sr_z (c))
+
+/* Bcc with an 8 bit displacement */
+static inline
+void spec_bcc_s (e68000_t *c, int cond)
+{
+	if (cond) {
+		e68_set_clk (c, 10);
+		e68_set_ir_pc (c, e68_get_pc (c) + 2 + e68_exts8 (c->ir[0]));
+		e68_op_prefetch (c);
+	}
+	else {
+		e68_set_clk (c, 8);
+	}
+
+	e68_op_prefetch (c);
+	e68_set_pc (c, e68_get_ir_pc (c) - 4);
+}
+
+/* Bcc with a 16 bit displacement */
+static inline
+void spec_bcc_w (e68000_t *c, int cond)
+{
+	uint32_t addr;
+
+	addr = e68_get_pc (c) + 2;
+
+	e68_op_prefetch (c);
+
+	if (cond) {
+		e68_set_clk (c, 10);
+		e68_set_ir_pc (c, addr + e68_exts16 (c->ir[1]));
+		e68_op_prefetch (c);
+	}
+	else {
+		e68_set_clk (c, 12);
+	}
+
+	e68_op_prefetch (c);
+	e68_set_pc (c, e68_get_ir_pc (c) - 4);
+}
+
+/* DBcc Dx, dist */
+static inline
+void spec_dbcc (e68000_t *c, int cond)
+{
+	unsigned reg;
+	uint16_t val;
+	uint32_t addr;
+
+	e68_op_prefetch (c);
+
+	if (cond) {
+		e68_set_clk (c, 12);
+		e68_op_prefetch (c);
+		return;
+	}
+
+	addr = e68_get_pc (c) + e68_exts16 (c->ir[1]);
+
+	reg = e68_ir_reg0 (c);
+	val = (e68_get_dreg16 (c, reg) - 1) & 0xffff;
+	e68_set_dreg16 (c, reg, val);
+
+	if (val == 0xffff) {
+		e68_set_clk (c, 14);
+		e68_op_prefetch (c);
+		return;
+	}
+
+	e68_set_clk (c, 10);
+	e68_set_ir_pc (c, addr);
+	e68_op_prefetch (c);
+	e68_op_prefetch (c);
+	e68_set_pc (c, e68_get_ir_pc (c) - 4);
+}
+
+#define SPEC_BCC(cc) \
+static void op_bccs_##cc (e68000_t *c) { spec_bcc_s (c, SPEC_CC_##cc (c)); } \
+static void op_bccw_##cc (e68000_t *c) { spec_bcc_w (c, SPEC_CC_##cc (c)); }
+
+#define SPEC_DBCC(cc) \
+static void op_dbcc_##cc (e68000_t *c) { spec_dbcc (c, SPEC_CC_##cc (c)); }
+
+#define SPEC_MOVE_DST(sz, s) \
+	SPEC_MOVE(sz, s, 0) SPEC_MOVE(sz, s, 2) SPEC_MOVE(sz, s, 3) \
+	SPEC_MOVE(sz, s, 4) SPEC_MOVE(sz, s, 5)
+
+#define SPEC_MOVE_SRC(sz) \
+	SPEC_MOVE_DST(sz, 0) SPEC_MOVE_DST(sz, 2) SPEC_MOVE_DST(sz, 3) \
+	SPEC_MOVE_DST(sz, 4) SPEC_MOVE_DST(sz, 5) SPEC_MOVE_DST(sz, 7) \
+	SPEC_MOVE_DST(sz, 8) SPEC_MOVE_DST(sz, 11)
+
+#define SPEC_SRC(op, sz) \
+	op(sz, 0) op(sz, 2) op(sz, 3) op(sz, 4) \
+	op(sz, 5) op(sz, 7) op(sz, 8)
+
+SPEC_MOVE_SRC(8)
+SPEC_MOVE_SRC(16)
+SPEC_MOVE_SRC(32)
+SPEC_MOVE_DST(16, 1)
+SPEC_MOVE_DST(32, 1)
+
+SPEC_SRC(SPEC_MOVEA, 16)
+SPEC_SRC(SPEC_MOVEA, 32)
+SPEC_MOVEA(16, 1) SPEC_MOVEA(16, 11)
+SPEC_MOVEA(32, 1) SPEC_MOVEA(32, 11)
+
+SPEC_SRC(SPEC_TST, 8)
+SPEC_SRC(SPEC_TST, 16)
+SPEC_SRC(SPEC_TST, 32)
+
+SPEC_SRC(SPEC_CMP, 8)
+SPEC_SRC(SPEC_CMP, 16)
+SPEC_SRC(SPEC_CMP, 32)
+SPEC_CMP(16, 1) SPEC_CMP(16, 11)
+SPEC_CMP(32, 1) SPEC_CMP(32, 11)
+SPEC_CMP(8, 11)
+
+
+#define SPEC_ADDQ_DST(sz) \
+	SPEC_ADDQ(sz, 0) SPEC_ADDQ(sz, 2) SPEC_ADDQ(sz, 3) SPEC_ADDQ(sz, 4) \
+	SPEC_ADDQ(sz, 5) SPEC_ADDQ(sz, 7) SPEC_ADDQ(sz, 8)
+
+SPEC_ADDQ_DST(8)
+SPEC_ADDQ_DST(16)
+SPEC_ADDQ_DST(32)
+SPEC_ADDQA(16)
+SPEC_ADDQA(32)
+
+/* BSR (condition 1) is left to the generic handler */
+SPEC_BCC(0) SPEC_BCC(2) SPEC_BCC(3) SPEC_BCC(4) SPEC_BCC(5)
+SPEC_BCC(6) SPEC_BCC(7) SPEC_BCC(8) SPEC_BCC(9) SPEC_BCC(10)
+SPEC_BCC(11) SPEC_BCC(12) SPEC_BCC(13) SPEC_BCC(14) SPEC_BCC(15)
+
+SPEC_DBCC(0) SPEC_DBCC(1) SPEC_DBCC(2) SPEC_DBCC(3)
+SPEC_DBCC(4) SPEC_DBCC(5) SPEC_DBCC(6) SPEC_DBCC(7)
+SPEC_DBCC(8) SPEC_DBCC(9) SPEC_DBCC(10) SPEC_DBCC(11)
+SPEC_DBCC(12) SPEC_DBCC(13) SPEC_DBCC(14) SPEC_DBCC(15)
+
+
+#define SPEC_ROW(p, s) \
+	{ p##_##s##_0, NULL, p##_##s##_2, p##_##s##_3, p##_##s##_4, p##_##s##_5 }
+
+#define SPEC_MOVE_TAB(sz) { \
+	SPEC_ROW (op_move##sz, 0), \
+	SPEC_ROW (op_move##sz, 1), \
+	SPEC_ROW (op_move##sz, 2), \
+	SPEC_ROW (op_move##sz, 3), \
+	SPEC_ROW (op_move##sz, 4), \
+	SPEC_ROW (op_move##sz, 5), \
+	{ NULL }, \
+	SPEC_ROW (op_move##sz, 7), \
+	SPEC_ROW (op_move##sz, 8), \
+	{ NULL }, \
+	{ NULL }, \
+	SPEC_ROW (op_move##sz, 11) \
+	}
+
+#define SPEC_SRC_TAB(p, an, im) { \
+	p##_0, an, p##_2, p##_3, p##_4, p##_5, NULL, p##_7, p##_8, NULL, NULL, im \
+	}
+
+/* MOVE.W and MOVE.L [src][dst], MOVE.B has no An source */
+static const e68_opcode_f spec_move16[EA_CNT][6] = SPEC_MOVE_TAB (16);
+static const e68_opcode_f spec_move32[EA_CNT][6] = SPEC_MOVE_TAB (32);
+
+static const e68_opcode_f spec_move8[EA_CNT][6] = {
+	SPEC_ROW (op_move8, 0),
+	{ NULL },
+	SPEC_ROW (op_move8, 2),
+	SPEC_ROW (op_move8, 3),
+	SPEC_ROW (op_move8, 4),
+	SPEC_ROW (op_move8, 5),
+	{ NULL },
+	SPEC_ROW (op_move8, 7),
+	SPEC_ROW (op_move8, 8),
+	{ NULL },
+	{ NULL },
+	SPEC_ROW (op_move8, 11)
+};
+
+static const e68_opcode_f spec_movea[2][EA_CNT] = {
+	SPEC_SRC_TAB (op_movea16, op_movea16_1, op_movea16_11),
+	SPEC_SRC_TAB (op_movea32, op_movea32_1, op_movea32_11)
+};
+
+static const e68_opcode_f spec_tst[3][EA_CNT] = {
+	SPEC_SRC_TAB (op_tst8, NULL, NULL),
+	SPEC_SRC_TAB (op_tst16, NULL, NULL),
+	SPEC_SRC_TAB (op_tst32, NULL, NULL)
+};
+
+static const e68_opcode_f spec_cmp[3][EA_CNT] = {
+	SPEC_SRC_TAB (op_cmp8, NULL, op_cmp8_11),
+	SPEC_SRC_TAB (op_cmp16, op_cmp16_1, op_cmp16_11),
+	SPEC_SRC_TAB (op_cmp32, op_cmp32_1, op_cmp32_11)
+};
+
+
+static const e68_opcode_f spec_addq[3][EA_CNT] = {
+	SPEC_SRC_TAB (op_addq8, NULL, NULL),
+	SPEC_SRC_TAB (op_addq16, op_addq16_1, NULL),
+	SPEC_SRC_TAB (op_addq32, op_addq32_1, NULL)
+};
+
+#define SPEC_CC_TAB(p) { \
+	p##_0, p##_1, p##_2, p##_3, p##_4, p##_5, p##_6, p##_7, \
+	p##_8, p##_9, p##_10, p##_11, p##_12, p##_13, p##_14, p##_15 \
+	}
+
+static const e68_opcode_f spec_bcc[2][16] = {
+	{
+		op_bccs_0, NULL, op_bccs_2, op_bccs_3, op_bccs_4, op_bccs_5,
+		op_bccs_6, op_bccs_7, op_bccs_8, op_bccs_9, op_bccs_10,
+		op_bccs_11, op_bccs_12, op_bccs_13, op_bccs_14, op_bccs_15
+	},
+	{
+		op_bccw_0, NULL, op_bccw_2, op_bccw_3, op_bccw_4, op_bccw_5,
+		op_bccw_6, op_bccw_7, op_bccw_8, op_bccw_9, op_bccw_10,
+		op_bccw_11, op_bccw_12, op_bccw_13, op_bccw_14, op_bccw_15
+	}
+};
+
+static const e68_opcode_f spec_dbcc_tab[16] = SPEC_CC_TAB (op_dbcc);
+
+
+/*
+ * Map a 6 bit effective address to one of the modes above. Returns
+ * EA_CNT for modes that are not specialized.
+ */
+static
+unsigned spec_mode (unsigned ea)
+{
+	if (ea < 0x30) {
+		return (ea >> 3);
+	}
+
+	switch (ea) {
+	case 0x38:
+		return (EA_AW);
+
+	case 0x39:
+		return (EA_AL);
+
+	case 0x3c:
+		return (EA_IM);
+	}
+
+	return (EA_CNT);
+}
+
+e68_opcode_f e68_get_op_spec (unsigned op)
+{
+	unsigned src, dst;
+
+	switch ((op >> 12) & 0x0f) {
+	case 0x05:
+		if ((op & 0x00c0) == 0x00c0) {
+			if ((op & 0x0038) == 0x0008) {
+				return (spec_dbcc_tab[(op >> 8) & 0x0f]);
+			}
+
+			return (NULL);
+		}
+
+		if ((op & 0x0100) == 0) {
+			src = spec_mode (op & 0x3f);
+
+			if (src < EA_CNT) {
+				return (spec_addq[(op >> 6) & 3][src]);
+			}
+		}
+
+		return (NULL);
+
+	case 0x06:
+		return (spec_bcc[(op & 0xff) ? 0 : 1][(op >> 8) & 0x0f]);
+	}
+
+	src = spec_mode (op & 0x3f);
+
+	if (src >= EA_CNT) {
+		return (NULL);
+	}
+
+	switch ((op >> 12) & 0x0f) {
+	case 0x01:
+	case 0x02:
+	case 0x03:
+		dst = spec_mode (((op >> 3) & 0x38) | ((op >> 9) & 7));
+
+		if (dst == EA_AN) {
+			if ((op & 0x1000) == 0x1000) {
+				/* MOVEA.B does not exist */
+				if ((op & 0x2000) == 0) {
+					return (NULL);
+				}
+
+				return (spec_movea[0][src]);
+			}
+
+			return (spec_movea[1][src]);
+		}
+
+		if (dst > EA_DI) {
+			return (NULL);
+		}
+
+		switch ((op >> 12) & 0x0f) {
+		case 0x01:
+			return (spec_move8[src][dst]);
+
+		case 0x02:
+			return (spec_move32[src][dst]);
+
+		case 0x03:
+			return (spec_move16[src][dst]);
+		}
+		break;
+
+	case 0x04:
+		if ((op & 0x0f00) == 0x0a00) {
+			if ((op & 0x00c0) != 0x00c0) {
+				return (spec_tst[(op >> 6) & 3][src]);
+			}
+		}
+		break;
+
+	case 0x0b:
+		if ((op & 0x0100) == 0) {
+			if ((op & 0x00c0) != 0x00c0) {
+				return (spec_cmp[(op >> 6) & 3][src]);
+			}
+		}
+		break;
+	}
+
+	return (NULL);
+}
@@ -454,12 +454,83 @@ unsigned long mem_blk_get_uint32_null (const void *ext, unsigned long addr)
 
 
 static
-void mem_init_last (memory_t *mem)
+int mem_blk_direct_get (const mem_blk_t *blk)
 {
-	unsigned i;
+	if (blk->data == NULL) {
+		return (0);
+	}
+
+	return ((blk->get_uint8 == NULL) && (blk->get_uint16 == NULL) && (blk->get_uint32 == NULL));
+}
+
+static
+int mem_blk_direct_set (const mem_blk_t *blk)
+{
+	if ((blk->data == NULL) || blk->readonly) {
+		return (0);
+	}
+
+	return ((blk->set_uint8 == NULL) && (blk->set_uint16 == NULL) && (blk->set_uint32 == NULL));
+}
+
+void mem_map_update (memory_t *mem)
+{
+	unsigned      i, j;
+	unsigned long addr1, addr2;
+	mem_blk_t     *blk;
+	mem_map_t     *map;
+
+	for (i = 0; i < MEM_MAP_CNT; i++) {
+		map = &mem->map[i];
+
+		map->blk = NULL;
+		map->rd = NULL;
+		map->wr = NULL;
+		map->part = MEM_MAP_PART_NONE;
+
+		addr1 = (unsigned long) i << MEM_MAP_SHIFT;
+		addr2 = addr1 + MEM_MAP_MASK;
+
+		/* the first active block that overlaps the page */
+		for (j = 0; j < mem->cnt; j++) {
+			blk = mem->lst[j].blk;
+
+			if (blk->active && (blk->addr1 <= addr2) && (blk->addr2 >= addr1)) {
+				break;
+			}
+		}
+
+		if (j >= mem->cnt) {
+			continue;
+		}
+
+		if ((blk->addr1 > addr1) || (blk->addr2 < addr2)) {
+			map->blk = blk;
+			map->part = MEM_MAP_PART_ONE;
+
+			/* look for other blocks in the page */
+			for (j = j + 1; j < mem->cnt; j++) {
+				blk = mem->lst[j].blk;
+
+				if (blk->active && (blk->addr1 <= addr2) && (blk->addr2 >= addr1)) {
+					map->blk = NULL;
+					map->part = MEM_MAP_PART_MANY;
+					break;
+				}
+			}
+
+			continue;
+		}
 
-	for (i = 0; i < MEM_LAST_CNT; i++) {
-		mem->last[i] = NULL;
+		map->blk = blk;
+
+		if (mem_blk_direct_get (blk)) {
+			map->rd = blk->data + (addr1 - blk->addr1);
+		}
+
+		if (mem_blk_direct_set (blk)) {
+			map->wr = blk->data + (addr1 - blk->addr1);
+		}
 	}
 }
 
@@ -468,7 +539,7 @@ void mem_init (memory_t *mem)
 	mem->cnt = 0;
 	mem->lst = NULL;
 
-	mem_init_last (mem);
+	mem_map_update (mem);
 
 	mem->ext = NULL;
 	mem->get_uint8 = NULL;
@@ -579,7 +650,7 @@ void mem_add_blk (memory_t *mem, mem_blk_t *blk, int del)
 	lst->blk = blk;
 	lst->del = (del != 0);
 
-	mem_init_last (mem);
+	mem_map_update (mem);
 }
 
 void mem_rmv_blk (memory_t *mem, const mem_blk_t *blk)
@@ -601,7 +672,7 @@ void mem_rmv_blk (memory_t *mem, const mem_blk_t *blk)
 
 	mem->cnt = j;
 
-	mem_init_last (mem);
+	mem_map_update (mem);
 }
 
 void mem_rmv_all (memory_t *mem)
@@ -616,7 +687,7 @@ void mem_rmv_all (memory_t *mem)
 
 	mem->cnt = 0;
 
-	mem_init_last (mem);
+	mem_map_update (mem);
 }
 
 void mem_move_to_front (memory_t *mem, unsigned long addr)
@@ -639,24 +710,59 @@ void mem_move_to_front (memory_t *mem, unsigned long addr)
 
 			mem->lst[0].blk = blk;
 
+			mem_map_update (mem);
+
 			return;
 		}
 	}
 }
 
+/*
+ * Get a direct pointer to size bytes at addr if they are in the same page
+ * and the page can be accessed directly.
+ */
 static inline
-mem_blk_t *mem_get_blk_inline (memory_t *mem, unsigned long addr, unsigned last)
+unsigned char *mem_map_ptr (memory_t *mem, unsigned long addr, unsigned long size, int wr)
+{
+	const mem_map_t *map;
+	unsigned char   *ptr;
+
+	if (addr >= MEM_MAP_SIZE) {
+		return (NULL);
+	}
+
+	map = &mem->map[addr >> MEM_MAP_SHIFT];
+	ptr = wr ? map->wr : map->rd;
+
+	if ((ptr == NULL) || (((addr & MEM_MAP_MASK) + size - 1) > MEM_MAP_MASK)) {
+		return (NULL);
+	}
+
+	return (ptr + (addr & MEM_MAP_MASK));
+}
+
+static inline
+mem_blk_t *mem_get_blk_inline (memory_t *mem, unsigned long addr)
 {
 	unsigned  i;
 	mem_blk_t *blk;
 	mem_lst_t *lst;
 
-	last &= (MEM_LAST_CNT - 1);
+	if (addr < MEM_MAP_SIZE) {
+		const mem_map_t *map = &mem->map[addr >> MEM_MAP_SHIFT];
 
-	if (mem->last[last] != NULL) {
-		blk = mem->last[last]->blk;
-		if (blk->active && (addr >= blk->addr1) && (addr <= blk->addr2)) {
-			return (blk);
+		if (map->part == MEM_MAP_PART_NONE) {
+			return (map->blk);
+		}
+
+		if (map->part == MEM_MAP_PART_ONE) {
+			blk = map->blk;
+
+			if ((addr >= blk->addr1) && (addr <= blk->addr2)) {
+				return (blk);
+			}
+
+			return (NULL);
 		}
 	}
 
@@ -665,7 +771,6 @@ mem_blk_t *mem_get_blk_inline (memory_t *mem, unsigned long addr, unsigned last)
 	for (i = 0; i < mem->cnt; i++) {
 		blk = lst->blk;
 		if (blk->active && (addr >= blk->addr1) && (addr <= blk->addr2)) {
-			mem->last[last] = lst;
 			return (blk);
 		}
 
@@ -677,7 +782,7 @@ mem_blk_t *mem_get_blk_inline (memory_t *mem, unsigned long addr, unsigned last)
 
 mem_blk_t *mem_get_blk (memory_t *mem, unsigned long addr)
 {
-	return (mem_get_blk_inline (mem, addr, 0));
+	return (mem_get_blk_inline (mem, addr));
 }
 
 void *mem_get_ptr (memory_t *mem, unsigned long addr, unsigned long size)
@@ -701,11 +806,38 @@ void *mem_get_ptr (memory_t *mem, unsigned long addr, unsigned long size)
 	return (blk->data + addr);
 }
 
-unsigned char mem_get_uint8 (memory_t *mem, unsigned long addr)
+unsigned char *mem_get_ptr_direct (memory_t *mem, unsigned long addr, unsigned long size, int wr)
 {
 	mem_blk_t *blk;
 
-	blk = mem_get_blk_inline (mem, addr, 1);
+	if ((blk = mem_get_blk_inline (mem, addr)) == NULL) {
+		return (NULL);
+	}
+
+	if (wr) {
+		if (blk->readonly || (blk->set_uint8 != NULL)) {
+			return (NULL);
+		}
+	}
+	else if (blk->get_uint8 != NULL) {
+		return (NULL);
+	}
+
+	return (mem_get_ptr (mem, addr, size));
+}
+
+unsigned char mem_get_uint8 (memory_t *mem, unsigned long addr)
+{
+	mem_blk_t     *blk;
+	unsigned char *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 1, 0);
+
+	if (ptr != NULL) {
+		return (ptr[0]);
+	}
+
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		addr -= blk->addr1;
@@ -729,8 +861,15 @@ unsigned short mem_get_uint16_be (memory_t *mem, unsigned long addr)
 {
 	unsigned short val;
 	mem_blk_t      *blk;
+	unsigned char  *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 2, 0);
 
-	blk = mem_get_blk_inline (mem, addr, 1);
+	if (ptr != NULL) {
+		return (((unsigned short) ptr[0] << 8) | ptr[1]);
+	}
+
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if ((addr + 1) > blk->addr2) {
@@ -762,8 +901,15 @@ unsigned short mem_get_uint16_le (memory_t *mem, unsigned long addr)
 {
 	unsigned short val;
 	mem_blk_t      *blk;
+	unsigned char  *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 2, 0);
+
+	if (ptr != NULL) {
+		return (((unsigned short) ptr[1] << 8) | ptr[0]);
+	}
 
-	blk = mem_get_blk_inline (mem, addr, 1);
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if ((addr + 1) > blk->addr2) {
@@ -795,8 +941,17 @@ unsigned long mem_get_uint32_be (memory_t *mem, unsigned long addr)
 {
 	unsigned long val;
 	mem_blk_t     *blk;
+	unsigned char *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 4, 0);
+
+	if (ptr != NULL) {
+		return (((unsigned long) ptr[0] << 24) | ((unsigned long) ptr[1] << 16) |
+			((unsigned long) ptr[2] << 8) | ptr[3]
+		);
+	}
 
-	blk = mem_get_blk_inline (mem, addr, 1);
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if ((addr + 3) > blk->addr2) {
@@ -832,8 +987,17 @@ unsigned long mem_get_uint32_le (memory_t *mem, unsigned long addr)
 {
 	unsigned long val;
 	mem_blk_t     *blk;
+	unsigned char *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 4, 0);
 
-	blk = mem_get_blk_inline (mem, addr, 1);
+	if (ptr != NULL) {
+		return (((unsigned long) ptr[3] << 24) | ((unsigned long) ptr[2] << 16) |
+			((unsigned long) ptr[1] << 8) | ptr[0]
+		);
+	}
+
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if ((addr + 3) > blk->addr2) {
@@ -888,9 +1052,17 @@ void mem_set_uint8_rw (memory_t *mem, unsigned long addr, unsigned char val)
 
 void mem_set_uint8 (memory_t *mem, unsigned long addr, unsigned char val)
 {
-	mem_blk_t *blk;
+	mem_blk_t     *blk;
+	unsigned char *ptr;
 
-	blk = mem_get_blk_inline (mem, addr, 2);
+	ptr = mem_map_ptr (mem, addr, 1, 1);
+
+	if (ptr != NULL) {
+		ptr[0] = val;
+		return;
+	}
+
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if (blk->readonly) {
@@ -913,9 +1085,18 @@ void mem_set_uint8 (memory_t *mem, unsigned long addr, unsigned char val)
 
 void mem_set_uint16_be (memory_t *mem, unsigned long addr, unsigned short val)
 {
-	mem_blk_t *blk;
+	mem_blk_t     *blk;
+	unsigned char *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 2, 1);
 
-	blk = mem_get_blk_inline (mem, addr, 2);
+	if (ptr != NULL) {
+		ptr[0] = (val >> 8) & 0xff;
+		ptr[1] = val & 0xff;
+		return;
+	}
+
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if ((addr + 1) > blk->addr2) {
@@ -945,9 +1126,18 @@ void mem_set_uint16_be (memory_t *mem, unsigned long addr, unsigned short val)
 
 void mem_set_uint16_le (memory_t *mem, unsigned long addr, unsigned short val)
 {
-	mem_blk_t *blk;
+	mem_blk_t     *blk;
+	unsigned char *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 2, 1);
+
+	if (ptr != NULL) {
+		ptr[0] = val & 0xff;
+		ptr[1] = (val >> 8) & 0xff;
+		return;
+	}
 
-	blk = mem_get_blk_inline (mem, addr, 2);
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if ((addr + 1) > blk->addr2) {
@@ -977,9 +1167,20 @@ void mem_set_uint16_le (memory_t *mem, unsigned long addr, unsigned short val)
 
 void mem_set_uint32_be (memory_t *mem, unsigned long addr, unsigned long val)
 {
-	mem_blk_t *blk;
+	mem_blk_t     *blk;
+	unsigned char *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 4, 1);
+
+	if (ptr != NULL) {
+		ptr[0] = (val >> 24) & 0xff;
+		ptr[1] = (val >> 16) & 0xff;
+		ptr[2] = (val >> 8) & 0xff;
+		ptr[3] = val & 0xff;
+		return;
+	}
 
-	blk = mem_get_blk_inline (mem, addr, 2);
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if ((addr + 3) > blk->addr2) {
@@ -1013,9 +1214,20 @@ void mem_set_uint32_be (memory_t *mem, unsigned long addr, unsigned long val)
 
 void mem_set_uint32_le (memory_t *mem, unsigned long addr, unsigned long val)
 {
-	mem_blk_t *blk;
+	mem_blk_t     *blk;
+	unsigned char *ptr;
+
+	ptr = mem_map_ptr (mem, addr, 4, 1);
+
+	if (ptr != NULL) {
+		ptr[0] = val & 0xff;
+		ptr[1] = (val >> 8) & 0xff;
+		ptr[2] = (val >> 16) & 0xff;
+		ptr[3] = (val >> 24) & 0xff;
+		return;
+	}
 
-	blk = mem_get_blk_inline (mem, addr, 2);
+	blk = mem_get_blk_inline (mem, addr);
 
 	if (blk != NULL) {
 		if ((addr + 3) > blk->addr2) {
@@ -27,7 +27,18 @@
 #include <stdio.h>
 
 
-#define MEM_LAST_CNT 4
+/* The page table covers a 24 bit address space in 64 KB pages */
+#define MEM_MAP_SHIFT 16
+#define MEM_MAP_CNT   256
+#define MEM_MAP_MASK  ((1UL << MEM_MAP_SHIFT) - 1)
+#define MEM_MAP_SIZE  ((unsigned long) MEM_MAP_CNT << MEM_MAP_SHIFT)
+
+/* blk covers the entire page */
+#define MEM_MAP_PART_NONE 0
+/* blk is the only block in the page, the address must be checked */
+#define MEM_MAP_PART_ONE  1
+/* more than one block is in the page, the block list must be searched */
+#define MEM_MAP_PART_MANY 2
 
 
 typedef unsigned char (*mem_get_uint8_f) (void *blk, unsigned long addr);
@@ -81,11 +92,31 @@ typedef struct {
 } mem_lst_t;
 
 
+/*!***************************************************************************
+ * @short A page table entry
+ *****************************************************************************/
+typedef struct {
+	/*
+	 * The block that handles the page or NULL if there is none. If part
+	 * is MEM_MAP_PART_ONE, blk is the only block in the page but does
+	 * not cover all of it.
+	 */
+	mem_blk_t        *blk;
+
+	/* Direct pointers to the page or NULL if blk's functions must be used */
+	unsigned char    *rd;
+	unsigned char    *wr;
+
+	/* One of MEM_MAP_PART_* */
+	unsigned char    part;
+} mem_map_t;
+
+
 typedef struct {
 	unsigned         cnt;
 	mem_lst_t        *lst;
 
-	mem_lst_t        *last[MEM_LAST_CNT];
+	mem_map_t        map[MEM_MAP_CNT];
 
 	/* these functions are used if no block is found */
 	void             *ext;
@@ -292,6 +323,16 @@ void mem_rmv_blk (memory_t *mem, const mem_blk_t *blk);
  *****************************************************************************/
 void mem_rmv_all (memory_t *mem);
 
+/*!***************************************************************************
+ * @short Rebuild the page table
+ * @param mem The memory structure
+ *
+ * This is done automatically when blocks are added or removed. It must be
+ * called after changing the address, size, data, access functions or
+ * flags of a block that is already part of the memory structure.
+ *****************************************************************************/
+void mem_map_update (memory_t *mem);
+
 /*!***************************************************************************
  * @short Move a memory block to the front of the list
  * @param mem   The memory structure
@@ -315,6 +356,18 @@ mem_blk_t *mem_get_blk (memory_t *mem, unsigned long addr);
  *****************************************************************************/
 void *mem_get_ptr (memory_t *mem, unsigned long addr, unsigned long size);
 
+/*!***************************************************************************
+ * @short Get a pointer to memory that can be accessed directly
+ * @param  mem  The memory structure
+ * @param  addr The pointer address
+ * @param  size The requested block size
+ * @param  wr   If non-zero, the memory is written through the pointer
+ * @return A pointer to size bytes at addr, or NULL if the range is not
+ *         inside one memory block or the block has access functions or
+ *         is read-only (wr != 0)
+ *****************************************************************************/
+unsigned char *mem_get_ptr_direct (memory_t *mem, unsigned long addr, unsigned long size, int wr);
+
 unsigned char mem_get_uint8 (memory_t *mem, unsigned long addr);
 unsigned short mem_get_uint16_be (memory_t *mem, unsigned long addr);
 unsigned short mem_get_uint16_le (memory_t *mem, unsigned long addr);
@@ -0,0 +1,781 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/block/blkasync.c                                 *
+ * Created:     2026-10-17                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#include "blkasync.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#endif
+
+
+#define RA_NONE    0
+#define RA_PENDING 1
+#define RA_BUSY    2
+#define RA_READY   3
+#define RA_ERROR   4
+
+/* the events the two threads wait for */
+#define EV_WORK 0
+#define EV_DONE 1
+
+
+static void dsk_async_work (disk_async_t *ad);
+
+
+/*
+ * The platform part: a lock, two events and the worker thread. Each
+ * event has only one thread waiting for it, the worker for EV_WORK and
+ * the disk user for EV_DONE.
+ */
+
+#ifdef ESP_PLATFORM
+
+struct dsk_async_sys_s {
+	SemaphoreHandle_t lock;
+	SemaphoreHandle_t ev[2];
+
+	/* given by the worker task when it no longer uses the others */
+	SemaphoreHandle_t exit;
+};
+
+static
+void dsk_async_lock (disk_async_t *ad)
+{
+	xSemaphoreTake (ad->sys->lock, portMAX_DELAY);
+}
+
+static
+void dsk_async_unlock (disk_async_t *ad)
+{
+	xSemaphoreGive (ad->sys->lock);
+}
+
+/*
+ * A binary semaphore remembers a signal that arrives before the wait,
+ * so no signal is lost between releasing the lock and waiting.
+ */
+static
+void dsk_async_wait (disk_async_t *ad, unsigned ev)
+{
+	xSemaphoreGive (ad->sys->lock);
+	xSemaphoreTake (ad->sys->ev[ev], portMAX_DELAY);
+	xSemaphoreTake (ad->sys->lock, portMAX_DELAY);
+}
+
+static
+void dsk_async_signal (disk_async_t *ad, unsigned ev)
+{
+	xSemaphoreGive (ad->sys->ev[ev]);
+}
+
+static
+void dsk_async_task (void *ext)
+{
+	disk_async_t *ad;
+
+	ad = ext;
+
+	dsk_async_work (ad);
+
+	/* ad->sys may be deleted as soon as this is given */
+	xSemaphoreGive (ad->sys->exit);
+
+	vTaskDelete (NULL);
+}
+
+static
+void dsk_async_sys_del (disk_async_t *ad)
+{
+	struct dsk_async_sys_s *sys;
+
+	if ((sys = ad->sys) == NULL) {
+		return;
+	}
+
+	if (sys->lock != NULL) {
+		vSemaphoreDelete (sys->lock);
+	}
+
+	if (sys->ev[0] != NULL) {
+		vSemaphoreDelete (sys->ev[0]);
+	}
+
+	if (sys->ev[1] != NULL) {
+		vSemaphoreDelete (sys->ev[1]);
+	}
+
+	if (sys->exit != NULL) {
+		vSemaphoreDelete (sys->exit);
+	}
+
+	free (sys);
+
+	ad->sys = NULL;
+}
+
+static
+int dsk_async_sys_new (disk_async_t *ad)
+{
+	struct dsk_async_sys_s *sys;
+
+	if ((sys = malloc (sizeof (struct dsk_async_sys_s))) == NULL) {
+		return (1);
+	}
+
+	ad->sys = sys;
+
+	sys->lock = xSemaphoreCreateMutex();
+	sys->ev[0] = xSemaphoreCreateBinary();
+	sys->ev[1] = xSemaphoreCreateBinary();
+	sys->exit = xSemaphoreCreateBinary();
+
+	if ((sys->lock == NULL) || (sys->ev[0] == NULL) || (sys->ev[1] == NULL) || (sys->exit == NULL)) {
+		dsk_async_sys_del (ad);
+		return (1);
+	}
+
+	/* the emulation runs on core 0 */
+	if (xTaskCreatePinnedToCore (&dsk_async_task, "disk", 4 * 1024, ad, 5, NULL, 1) != pdPASS) {
+		dsk_async_sys_del (ad);
+		return (1);
+	}
+
+	return (0);
+}
+
+/*
+ * The task deletes itself, but it still uses the lock after it has set
+ * ad->quit. Wait until it is done with it.
+ */
+static
+void dsk_async_sys_join (disk_async_t *ad)
+{
+	xSemaphoreTake (ad->sys->exit, portMAX_DELAY);
+}
+
+#else
+
+struct dsk_async_sys_s {
+	pthread_t       thread;
+	pthread_mutex_t lock;
+	pthread_cond_t  ev[2];
+};
+
+static
+void dsk_async_lock (disk_async_t *ad)
+{
+	pthread_mutex_lock (&ad->sys->lock);
+}
+
+static
+void dsk_async_unlock (disk_async_t *ad)
+{
+	pthread_mutex_unlock (&ad->sys->lock);
+}
+
+static
+void dsk_async_wait (disk_async_t *ad, unsigned ev)
+{
+	pthread_cond_wait (&ad->sys->ev[ev], &ad->sys->lock);
+}
+
+static
+void dsk_async_signal (disk_async_t *ad, unsigned ev)
+{
+	pthread_cond_signal (&ad->sys->ev[ev]);
+}
+
+static
+void *dsk_async_thread (void *ext)
+{
+	dsk_async_work (ext);
+
+	return (NULL);
+}
+
+static
+void dsk_async_sys_del (disk_async_t *ad)
+{
+	if (ad->sys == NULL) {
+		return;
+	}
+
+	pthread_cond_destroy (&ad->sys->ev[1]);
+	pthread_cond_destroy (&ad->sys->ev[0]);
+	pthread_mutex_destroy (&ad->sys->lock);
+
+	free (ad->sys);
+
+	ad->sys = NULL;
+}
+
+static
+int dsk_async_sys_new (disk_async_t *ad)
+{
+	struct dsk_async_sys_s *sys;
+
+	if ((sys = malloc (sizeof (struct dsk_async_sys_s))) == NULL) {
+		return (1);
+	}
+
+	ad->sys = sys;
+
+	if (pthread_mutex_init (&sys->lock, NULL) == 0) {
+		if (pthread_cond_init (&sys->ev[0], NULL) == 0) {
+			if (pthread_cond_init (&sys->ev[1], NULL) == 0) {
+				if (pthread_create (&sys->thread, NULL, dsk_async_thread, ad) == 0) {
+					return (0);
+				}
+
+				pthread_cond_destroy (&sys->ev[1]);
+			}
+
+			pthread_cond_destroy (&sys->ev[0]);
+		}
+
+		pthread_mutex_destroy (&sys->lock);
+	}
+
+	free (sys);
+
+	ad->sys = NULL;
+
+	return (1);
+}
+
+static
+void dsk_async_sys_join (disk_async_t *ad)
+{
+	pthread_join (ad->sys->thread, NULL);
+}
+
+#endif
+
+
+/*
+ * The worker thread. Queued writes come first, so that the read-ahead
+ * buffer never sees data older than a queued write.
+ */
+static
+void dsk_async_work (disk_async_t *ad)
+{
+	int             r;
+	uint32_t        lba, cnt;
+	dsk_async_req_t *req;
+
+	dsk_async_lock (ad);
+
+	while ((ad->quit == 0) || (ad->wq_cnt > 0)) {
+		if (ad->wq_cnt > 0) {
+			req = &ad->wq[ad->wq_head];
+
+			dsk_async_unlock (ad);
+			r = dsk_write_lba (ad->sub, req->data, req->lba, req->cnt);
+			dsk_async_lock (ad);
+
+			if (r) {
+				ad->error = 1;
+			}
+
+			ad->wq_head = (ad->wq_head + 1) % ad->wq_max;
+			ad->wq_cnt -= 1;
+
+			dsk_async_signal (ad, EV_DONE);
+		}
+		else if (ad->ra_state == RA_PENDING) {
+			ad->ra_state = RA_BUSY;
+			ad->ra_stale = 0;
+
+			lba = ad->ra_lba;
+			cnt = ad->ra_cnt;
+
+			dsk_async_unlock (ad);
+			r = dsk_read_lba (ad->sub, ad->ra_buf, lba, cnt);
+			dsk_async_lock (ad);
+
+			if (ad->ra_stale) {
+				ad->ra_state = RA_NONE;
+			}
+			else {
+				ad->ra_state = r ? RA_ERROR : RA_READY;
+			}
+
+			dsk_async_signal (ad, EV_DONE);
+		}
+		else if (ad->flush == 1) {
+			ad->flush = 2;
+
+			dsk_async_unlock (ad);
+			dsk_set_msg (ad->sub, "flush", "");
+			dsk_async_lock (ad);
+
+			ad->flush = 0;
+
+			dsk_async_signal (ad, EV_DONE);
+		}
+		else {
+			dsk_async_wait (ad, EV_WORK);
+		}
+	}
+
+	ad->quit = 2;
+
+	dsk_async_signal (ad, EV_DONE);
+	dsk_async_unlock (ad);
+}
+
+
+/*
+ * Check if the read-ahead buffer holds or will hold blocks i to i + n - 1
+ */
+static
+int dsk_async_ra_has (const disk_async_t *ad, uint32_t i, uint32_t n)
+{
+	if (ad->ra_state == RA_NONE) {
+		return (0);
+	}
+
+	if ((i < ad->ra_lba) || ((i - ad->ra_lba) > ad->ra_cnt)) {
+		return (0);
+	}
+
+	if (n > (ad->ra_cnt - (i - ad->ra_lba))) {
+		return (0);
+	}
+
+	return (1);
+}
+
+/*
+ * Load the read-ahead buffer, starting at block i. The buffer must not
+ * be busy.
+ */
+static
+void dsk_async_ra_start (disk_async_t *ad, uint32_t i)
+{
+	ad->ra_lba = i;
+	ad->ra_cnt = ad->dsk.blocks - i;
+
+	if (ad->ra_cnt > ad->ra_max) {
+		ad->ra_cnt = ad->ra_max;
+	}
+
+	ad->ra_state = RA_PENDING;
+
+	dsk_async_signal (ad, EV_WORK);
+}
+
+/*
+ * Wait until the read-ahead buffer holds blocks i to i + n - 1, with
+ * n <= ra_max.
+ */
+static
+int dsk_async_ra_fetch (disk_async_t *ad, uint32_t i, uint32_t n)
+{
+	while (1) {
+		if (dsk_async_ra_has (ad, i, n)) {
+			if (ad->ra_state == RA_READY) {
+				return (0);
+			}
+
+			if (ad->ra_state == RA_ERROR) {
+				ad->ra_state = RA_NONE;
+				return (1);
+			}
+		}
+		else if (ad->ra_state != RA_BUSY) {
+			dsk_async_ra_start (ad, i);
+		}
+
+		dsk_async_wait (ad, EV_DONE);
+	}
+}
+
+/*
+ * Copy written blocks into the read-ahead buffer
+ */
+static
+void dsk_async_ra_update (disk_async_t *ad, const unsigned char *buf, uint32_t i, uint32_t n)
+{
+	uint32_t i1, i2;
+
+	if ((ad->ra_state == RA_NONE) || (ad->ra_state == RA_PENDING)) {
+		return;
+	}
+
+	i1 = (i > ad->ra_lba) ? i : ad->ra_lba;
+	i2 = ((i + n) < (ad->ra_lba + ad->ra_cnt)) ? (i + n) : (ad->ra_lba + ad->ra_cnt);
+
+	if (i1 >= i2) {
+		return;
+	}
+
+	if (ad->ra_state == RA_BUSY) {
+		ad->ra_stale = 1;
+	}
+	else if (ad->ra_state == RA_READY) {
+		memcpy (ad->ra_buf + 512 * (i1 - ad->ra_lba), buf + 512 * (i1 - i), 512 * (i2 - i1));
+	}
+	else {
+		ad->ra_state = RA_NONE;
+	}
+}
+
+/*
+ * Wait until the worker does not access the underlying disk
+ */
+static
+void dsk_async_idle (disk_async_t *ad)
+{
+	while ((ad->wq_cnt > 0) || (ad->ra_state == RA_BUSY) || (ad->ra_state == RA_PENDING) || (ad->flush == 2)) {
+		dsk_async_wait (ad, EV_DONE);
+	}
+}
+
+static
+int dsk_async_read (disk_t *dsk, void *buf, uint32_t i, uint32_t n)
+{
+	uint32_t      j, cnt;
+	unsigned char *dst;
+	disk_async_t  *ad;
+
+	ad = dsk->ext;
+
+	if ((i > dsk->blocks) || (n > (dsk->blocks - i))) {
+		return (1);
+	}
+
+	dst = buf;
+
+	dsk_async_lock (ad);
+
+	j = i;
+
+	while (j < (i + n)) {
+		cnt = i + n - j;
+
+		if (cnt > ad->ra_max) {
+			cnt = ad->ra_max;
+		}
+
+		if (dsk_async_ra_fetch (ad, j, cnt)) {
+			dsk_async_unlock (ad);
+			return (1);
+		}
+
+		memcpy (dst, ad->ra_buf + 512 * (j - ad->ra_lba), 512 * cnt);
+
+		dst += 512 * cnt;
+		j += cnt;
+	}
+
+	/* prefetch the next blocks if the reads are sequential */
+	if ((i == ad->next_lba) && (j < dsk->blocks) && (ad->ra_state != RA_BUSY)) {
+		cnt = dsk->blocks - j;
+
+		if (cnt > n) {
+			cnt = n;
+		}
+
+		if (cnt > ad->ra_max) {
+			cnt = ad->ra_max;
+		}
+
+		if (dsk_async_ra_has (ad, j, cnt) == 0) {
+			dsk_async_ra_start (ad, j);
+		}
+	}
+
+	ad->next_lba = j;
+
+	dsk_async_unlock (ad);
+
+	return (0);
+}
+
+static
+int dsk_async_write (disk_t *dsk, const void *buf, uint32_t i, uint32_t n)
+{
+	uint32_t            cnt;
+	const unsigned char *src;
+	disk_async_t        *ad;
+	dsk_async_req_t     *req;
+
+	if (dsk->readonly) {
+		return (1);
+	}
+
+	ad = dsk->ext;
+
+	if ((i > dsk->blocks) || (n > (dsk->blocks - i))) {
+		return (1);
+	}
+
+	src = buf;
+
+	dsk_async_lock (ad);
+
+	if (ad->error) {
+		ad->error = 0;
+		dsk_async_unlock (ad);
+		return (1);
+	}
+
+	while (n > 0) {
+		cnt = (n < ad->wq_blk) ? n : ad->wq_blk;
+
+		while (ad->wq_cnt >= ad->wq_max) {
+			dsk_async_wait (ad, EV_DONE);
+		}
+
+		req = &ad->wq[(ad->wq_head + ad->wq_cnt) % ad->wq_max];
+
+		req->lba = i;
+		req->cnt = cnt;
+		memcpy (req->data, src, 512 * cnt);
+
+		ad->wq_cnt += 1;
+
+		dsk_async_signal (ad, EV_WORK);
+
+		dsk_async_ra_update (ad, src, i, cnt);
+
+		src += 512 * cnt;
+		i += cnt;
+		n -= cnt;
+	}
+
+	dsk_async_unlock (ad);
+
+	return (0);
+}
+
+static
+int dsk_async_ready (disk_t *dsk, uint32_t i, uint32_t n)
+{
+	int          r;
+	disk_async_t *ad;
+
+	ad = dsk->ext;
+
+	/* such a read is done in parts and waits, or fails */
+	if ((n > ad->ra_max) || (i > dsk->blocks) || (n > (dsk->blocks - i))) {
+		return (1);
+	}
+
+	dsk_async_lock (ad);
+
+	if (dsk_async_ra_has (ad, i, n)) {
+		r = (ad->ra_state == RA_READY) || (ad->ra_state == RA_ERROR);
+	}
+	else {
+		if (ad->ra_state != RA_BUSY) {
+			dsk_async_ra_start (ad, i);
+		}
+
+		r = 0;
+	}
+
+	dsk_async_unlock (ad);
+
+	return (r);
+}
+
+static
+int dsk_async_get_msg (disk_t *dsk, const char *msg, char *val, unsigned max)
+{
+	int          r;
+	disk_async_t *ad;
+
+	ad = dsk->ext;
+
+	dsk_async_lock (ad);
+	dsk_async_idle (ad);
+
+	/* the worker can't start anything while the lock is held */
+	r = dsk_get_msg (ad->sub, msg, val, max);
+
+	dsk_async_unlock (ad);
+
+	return (r);
+}
+
+static
+int dsk_async_set_msg (disk_t *dsk, const char *msg, const char *val)
+{
+	int          r;
+	disk_async_t *ad;
+
+	ad = dsk->ext;
+
+	dsk_async_lock (ad);
+
+	if (strcmp (msg, "flush") == 0) {
+		if (ad->flush == 0) {
+			ad->flush = 1;
+			dsk_async_signal (ad, EV_WORK);
+		}
+
+		dsk_async_unlock (ad);
+		return (0);
+	}
+
+	dsk_async_idle (ad);
+
+	r = dsk_set_msg (ad->sub, msg, val);
+
+	if (ad->error) {
+		ad->error = 0;
+		r = 1;
+	}
+
+	dsk_async_unlock (ad);
+
+	return (r);
+}
+
+static
+void dsk_async_free (disk_async_t *ad)
+{
+	unsigned i;
+
+	if (ad->wq != NULL) {
+		for (i = 0; i < ad->wq_max; i++) {
+			free (ad->wq[i].data);
+		}
+	}
+
+	free (ad->wq);
+	free (ad->ra_buf);
+	free (ad);
+}
+
+static
+void dsk_async_del (disk_t *dsk)
+{
+	disk_async_t *ad;
+
+	ad = dsk->ext;
+
+	dsk_async_lock (ad);
+
+	ad->quit = 1;
+
+	dsk_async_signal (ad, EV_WORK);
+
+	while (ad->quit != 2) {
+		dsk_async_wait (ad, EV_DONE);
+	}
+
+	dsk_async_unlock (ad);
+
+	dsk_async_sys_join (ad);
+	dsk_async_sys_del (ad);
+
+	dsk_del (ad->sub);
+
+	dsk_async_free (ad);
+}
+
+disk_t *dsk_async_new (disk_t *dsk, uint32_t ra_max, unsigned wq_max, unsigned wq_blk)
+{
+	unsigned     i;
+	disk_async_t *ad;
+
+	if ((ra_max == 0) || (wq_max == 0) || (wq_blk == 0)) {
+		return (NULL);
+	}
+
+	ad = malloc (sizeof (disk_async_t));
+
+	if (ad == NULL) {
+		return (NULL);
+	}
+
+	dsk_init (&ad->dsk, ad, dsk->blocks, dsk->c, dsk->h, dsk->s);
+
+	dsk_set_type (&ad->dsk, PCE_DISK_ASYNC);
+	dsk_set_visible_chs (&ad->dsk, dsk->visible_c, dsk->visible_h, dsk->visible_s);
+	dsk_set_readonly (&ad->dsk, dsk_get_readonly (dsk));
+	dsk_set_fname (&ad->dsk, dsk_get_fname (dsk));
+	dsk_set_drive (&ad->dsk, dsk_get_drive (dsk));
+
+	ad->dsk.del = dsk_async_del;
+	ad->dsk.read = dsk_async_read;
+	ad->dsk.write = dsk_async_write;
+	ad->dsk.ready = dsk_async_ready;
+	ad->dsk.get_msg = dsk_async_get_msg;
+	ad->dsk.set_msg = dsk_async_set_msg;
+
+	ad->sub = dsk;
+	ad->sys = NULL;
+
+	ad->wq_max = wq_max;
+	ad->wq_blk = wq_blk;
+	ad->wq_head = 0;
+	ad->wq_cnt = 0;
+
+	ad->ra_state = RA_NONE;
+	ad->ra_stale = 0;
+	ad->ra_lba = 0;
+	ad->ra_cnt = 0;
+	ad->ra_max = ra_max;
+
+	ad->next_lba = 0;
+	ad->flush = 0;
+	ad->error = 0;
+	ad->quit = 0;
+
+	ad->ra_buf = malloc (512 * ra_max);
+	ad->wq = malloc (wq_max * sizeof (dsk_async_req_t));
+
+	if ((ad->ra_buf == NULL) || (ad->wq == NULL)) {
+		free (ad->wq);
+		ad->wq = NULL;
+		dsk_async_free (ad);
+		return (NULL);
+	}
+
+	for (i = 0; i < wq_max; i++) {
+		ad->wq[i].data = malloc (512 * wq_blk);
+	}
+
+	for (i = 0; i < wq_max; i++) {
+		if (ad->wq[i].data == NULL) {
+			dsk_async_free (ad);
+			return (NULL);
+		}
+	}
+
+	if (dsk_async_sys_new (ad)) {
+		dsk_async_free (ad);
+		return (NULL);
+	}
+
+	return (&ad->dsk);
+}
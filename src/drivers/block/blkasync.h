@@ -0,0 +1,117 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/block/blkasync.h                                 *
+ * Created:     2026-10-17                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#ifndef PCE_DEVICES_BLOCK_BLKASYNC_H
+#define PCE_DEVICES_BLOCK_BLKASYNC_H 1
+
+
+#include <config.h>
+
+#include <drivers/block/block.h>
+
+#include <stdint.h>
+
+
+/*!***************************************************************************
+ * @short A queued write
+ *****************************************************************************/
+typedef struct {
+	uint32_t      lba;
+	uint32_t      cnt;
+	unsigned char *data;
+} dsk_async_req_t;
+
+
+/*!***************************************************************************
+ * @short The asynchronous disk structure
+ *
+ * All accesses to the underlying disk are made by a worker thread.
+ *
+ * Writes are copied into a bounded queue and the write returns at once,
+ * unless the queue is full. Reads are served from a read-ahead buffer
+ * that the worker fills. A read that is not in the buffer loads it,
+ * starting at the first requested block. When reads are sequential, the
+ * blocks following the last read are loaded in advance.
+ *
+ * Queued writes are written before the read-ahead buffer is loaded, and
+ * writes that overlap a loaded buffer are copied into it.
+ *
+ * The worker fields (ra_buf while loading, the head entry of the write
+ * queue) are only accessed by the worker. Everything else is protected
+ * by the lock.
+ *****************************************************************************/
+typedef struct {
+	disk_t                 dsk;
+
+	disk_t                 *sub;
+
+	struct dsk_async_sys_s *sys;
+
+	/* the write-behind queue */
+	unsigned               wq_max;
+	unsigned               wq_blk;
+	unsigned               wq_head;
+	unsigned               wq_cnt;
+	dsk_async_req_t        *wq;
+
+	/* the read-ahead buffer */
+	unsigned               ra_state;
+	char                   ra_stale;
+	uint32_t               ra_lba;
+	uint32_t               ra_cnt;
+	uint32_t               ra_max;
+	unsigned char          *ra_buf;
+
+	/* the block after the last read, to detect sequential reads */
+	uint32_t               next_lba;
+
+	/* 1 if a "flush" message is waiting for the worker, 2 while the
+	   worker sends it */
+	char                   flush;
+
+	/* a queued write failed */
+	char                   error;
+
+	/* 1 if the worker should exit, 2 if it has exited */
+	unsigned               quit;
+} disk_async_t;
+
+
+/*!***************************************************************************
+ * @short  Create an asynchronous disk on top of another disk
+ * @param  dsk    The underlying disk. It is deleted with the new disk.
+ * @param  ra_max The size of the read-ahead buffer in blocks
+ * @param  wq_max The number of writes that can be queued
+ * @param  wq_blk The number of blocks per queued write. Larger writes
+ *                use more than one queue entry.
+ * @return The new disk or NULL on error
+ *
+ * The new disk must only be used from one thread. dsk_get_ready() can be
+ * used to start a read without waiting for it.
+ *
+ * A failed queued write is reported by the next write or "commit". The
+ * "commit" message waits until all queued writes have been written, the
+ * "flush" message is handled by the worker when it is idle.
+ *****************************************************************************/
+disk_t *dsk_async_new (disk_t *dsk, uint32_t ra_max, unsigned wq_max, unsigned wq_blk);
+
+
+#endif
@@ -475,6 +475,7 @@ disk_t *dsk_cow_new (disk_t *dsk, const char *fname)
 	cow->dsk.del = dsk_cow_del;
 	cow->dsk.read = dsk_cow_read;
 	cow->dsk.write = dsk_cow_write;
+	cow->dsk.ready = NULL;
 	cow->dsk.get_msg = dsk_cow_get_msg;
 	cow->dsk.set_msg = dsk_cow_set_msg;
 	cow->dsk.fname = NULL;
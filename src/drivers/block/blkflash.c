@@ -0,0 +1,333 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/block/blkflash.c                                 *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#include "blkflash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define FLASH_BLK_NONE 0xffffffff
+
+
+static
+int dsk_flash_flush_line (disk_flash_t *fd, dsk_flash_line_t *line)
+{
+	uint32_t ofs;
+
+	if ((line->blk == FLASH_BLK_NONE) || (line->dirty == 0)) {
+		return (0);
+	}
+
+	ofs = line->blk * fd->fl->erase_size;
+
+	if (flash_erase (fd->fl, ofs, fd->fl->erase_size)) {
+		return (1);
+	}
+
+	if (flash_write (fd->fl, line->data, ofs, fd->fl->erase_size)) {
+		return (1);
+	}
+
+	line->dirty = 0;
+	line->idle = 0;
+
+	return (0);
+}
+
+static
+int dsk_flash_flush (disk_flash_t *fd, unsigned idle)
+{
+	unsigned         i;
+	int              r;
+	dsk_flash_line_t *line;
+
+	r = 0;
+
+	for (i = 0; i < fd->cnt; i++) {
+		line = &fd->line[i];
+
+		if (line->dirty == 0) {
+			continue;
+		}
+
+		if (line->idle < idle) {
+			line->idle += 1;
+			continue;
+		}
+
+		if (dsk_flash_flush_line (fd, line)) {
+			r = 1;
+		}
+	}
+
+	return (r);
+}
+
+static
+dsk_flash_line_t *dsk_flash_find (disk_flash_t *fd, uint32_t blk)
+{
+	unsigned i;
+
+	for (i = 0; i < fd->cnt; i++) {
+		if (fd->line[i].blk == blk) {
+			fd->line[i].used = fd->clk++;
+			return (&fd->line[i]);
+		}
+	}
+
+	return (NULL);
+}
+
+/*
+ * Get a cache line for an erase block, evicting the least recently used
+ * line if necessary. If fill is true, the line is loaded from the flash.
+ */
+static
+dsk_flash_line_t *dsk_flash_get (disk_flash_t *fd, uint32_t blk, int fill)
+{
+	unsigned         i;
+	dsk_flash_line_t *line;
+
+	if ((line = dsk_flash_find (fd, blk)) != NULL) {
+		return (line);
+	}
+
+	line = &fd->line[0];
+
+	for (i = 1; i < fd->cnt; i++) {
+		if (fd->line[i].blk == FLASH_BLK_NONE) {
+			line = &fd->line[i];
+			break;
+		}
+
+		if (fd->line[i].used < line->used) {
+			line = &fd->line[i];
+		}
+	}
+
+	if (dsk_flash_flush_line (fd, line)) {
+		return (NULL);
+	}
+
+	line->blk = FLASH_BLK_NONE;
+
+	if (fill) {
+		if (flash_read (fd->fl, line->data, blk * fd->fl->erase_size, fd->fl->erase_size)) {
+			return (NULL);
+		}
+	}
+
+	line->blk = blk;
+	line->dirty = 0;
+	line->idle = 0;
+	line->used = fd->clk++;
+
+	return (line);
+}
+
+static
+int dsk_flash_read (disk_t *dsk, void *buf, uint32_t i, uint32_t n)
+{
+	uint32_t         blk, ofs, cnt;
+	unsigned char    *dst;
+	disk_flash_t     *fd;
+	dsk_flash_line_t *line;
+
+	fd = dsk->ext;
+
+	if ((i + n) > dsk->blocks) {
+		return (1);
+	}
+
+	dst = buf;
+
+	while (n > 0) {
+		blk = i / fd->spb;
+		ofs = i % fd->spb;
+		cnt = fd->spb - ofs;
+
+		if (cnt > n) {
+			cnt = n;
+		}
+
+		if ((line = dsk_flash_find (fd, blk)) != NULL) {
+			memcpy (dst, line->data + 512 * ofs, 512 * cnt);
+		}
+		else {
+			/* reads don't allocate, the flash is fast to read */
+			if (flash_read (fd->fl, dst, 512 * i, 512 * cnt)) {
+				return (1);
+			}
+		}
+
+		dst += 512 * cnt;
+		i += cnt;
+		n -= cnt;
+	}
+
+	return (0);
+}
+
+static
+int dsk_flash_write (disk_t *dsk, const void *buf, uint32_t i, uint32_t n)
+{
+	uint32_t            blk, ofs, cnt;
+	const unsigned char *src;
+	disk_flash_t        *fd;
+	dsk_flash_line_t    *line;
+
+	if (dsk->readonly) {
+		return (1);
+	}
+
+	fd = dsk->ext;
+
+	if ((i + n) > dsk->blocks) {
+		return (1);
+	}
+
+	src = buf;
+
+	while (n > 0) {
+		blk = i / fd->spb;
+		ofs = i % fd->spb;
+		cnt = fd->spb - ofs;
+
+		if (cnt > n) {
+			cnt = n;
+		}
+
+		/* a completely overwritten block does not need to be read */
+		line = dsk_flash_get (fd, blk, cnt < fd->spb);
+
+		if (line == NULL) {
+			return (1);
+		}
+
+		memcpy (line->data + 512 * ofs, src, 512 * cnt);
+
+		line->dirty = 1;
+		line->idle = 0;
+
+		src += 512 * cnt;
+		i += cnt;
+		n -= cnt;
+	}
+
+	return (0);
+}
+
+static
+int dsk_flash_set_msg (disk_t *dsk, const char *msg, const char *val)
+{
+	disk_flash_t *fd;
+
+	fd = dsk->ext;
+
+	if (strcmp (msg, "commit") == 0) {
+		return (dsk_flash_flush (fd, 0));
+	}
+	else if (strcmp (msg, "flush") == 0) {
+		return (dsk_flash_flush (fd, 1));
+	}
+
+	return (1);
+}
+
+static
+void dsk_flash_del (disk_t *dsk)
+{
+	unsigned     i;
+	disk_flash_t *fd;
+
+	fd = dsk->ext;
+
+	dsk_flash_flush (fd, 0);
+
+	for (i = 0; i < fd->cnt; i++) {
+		free (fd->line[i].data);
+	}
+
+	free (fd->line);
+
+	flash_del (fd->fl);
+
+	free (fd);
+}
+
+disk_t *dsk_flash_new (flash_t *fl, unsigned cnt)
+{
+	unsigned     i;
+	disk_flash_t *fd;
+
+	if ((fl->erase_size < 512) || (fl->erase_size % 512) || (cnt == 0)) {
+		return (NULL);
+	}
+
+	fd = malloc (sizeof (disk_flash_t));
+
+	if (fd == NULL) {
+		return (NULL);
+	}
+
+	dsk_init (&fd->dsk, fd, fl->size / 512, 0, 0, 0);
+
+	dsk_set_type (&fd->dsk, PCE_DISK_RAW);
+
+	fd->dsk.del = dsk_flash_del;
+	fd->dsk.read = dsk_flash_read;
+	fd->dsk.write = dsk_flash_write;
+	fd->dsk.set_msg = dsk_flash_set_msg;
+
+	fd->fl = fl;
+	fd->spb = fl->erase_size / 512;
+	fd->cnt = cnt;
+	fd->clk = 0;
+
+	fd->line = malloc (cnt * sizeof (dsk_flash_line_t));
+
+	if (fd->line == NULL) {
+		free (fd);
+		return (NULL);
+	}
+
+	for (i = 0; i < cnt; i++) {
+		fd->line[i].blk = FLASH_BLK_NONE;
+		fd->line[i].dirty = 0;
+		fd->line[i].idle = 0;
+		fd->line[i].used = 0;
+		fd->line[i].data = malloc (fl->erase_size);
+
+		if (fd->line[i].data == NULL) {
+			while (i > 0) {
+				free (fd->line[--i].data);
+			}
+
+			free (fd->line);
+			free (fd);
+
+			return (NULL);
+		}
+	}
+
+	return (&fd->dsk);
+}
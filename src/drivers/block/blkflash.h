@@ -0,0 +1,90 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/block/blkflash.h                                 *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#ifndef PCE_DEVICES_BLOCK_BLKFLASH_H
+#define PCE_DEVICES_BLOCK_BLKFLASH_H 1
+
+
+#include <config.h>
+
+#include <drivers/block/block.h>
+#include <drivers/block/flash.h>
+
+#include <stdint.h>
+
+
+/*!***************************************************************************
+ * @short A cached flash erase block
+ *****************************************************************************/
+typedef struct {
+	/* the erase block number or FLASH_BLK_NONE */
+	uint32_t      blk;
+
+	char          dirty;
+
+	/* the number of idle flushes since the last write */
+	unsigned      idle;
+
+	/* the last access, for LRU replacement */
+	unsigned long used;
+
+	unsigned char *data;
+} dsk_flash_line_t;
+
+
+/*!***************************************************************************
+ * @short The flash disk structure
+ *
+ * Sector writes are collected in a write-back cache of whole erase
+ * blocks. A block is erased and written once when it is evicted or
+ * flushed, no matter how many of its sectors were written in between.
+ *****************************************************************************/
+typedef struct {
+	disk_t           dsk;
+
+	flash_t          *fl;
+
+	/* sectors per erase block */
+	unsigned         spb;
+
+	unsigned         cnt;
+	dsk_flash_line_t *line;
+
+	unsigned long    clk;
+} disk_flash_t;
+
+
+/*!***************************************************************************
+ * @short  Create a disk on top of a flash area
+ * @param  fl  The flash area. It is deleted with the disk.
+ * @param  cnt The number of erase blocks in the write-back cache
+ * @return The new disk or NULL on error
+ *
+ * The disk understands two messages:
+ *   "commit" writes all dirty blocks to the flash.
+ *   "flush"  writes the dirty blocks that have not been written to since
+ *            the last "flush". Sending it periodically writes back blocks
+ *            once they become idle.
+ *****************************************************************************/
+disk_t *dsk_flash_new (flash_t *fl, unsigned cnt);
+
+
+#endif
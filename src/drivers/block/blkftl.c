@@ -0,0 +1,747 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/block/blkftl.c                                   *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#include "blkftl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ * Segment summary (big endian):
+ *
+ *   0    4       magic
+ *   4    4       sequence number
+ *   8    4       erase count
+ *  12    4       reserved
+ *  16    4 * 63  slot tags
+ *
+ * A slot tag is the logical block number in the upper 24 bits and a
+ * check byte in the lower 8 bits. Unused tags are 0xffffffff.
+ */
+
+#define FTL_MAGIC     0x5046544c
+#define FTL_TAG_OFS   16
+#define FTL_TAG_NONE  0xffffffff
+
+#define FTL_NONE      0xffff
+
+#define FTL_SEG_FREE  0
+#define FTL_SEG_OPEN  1
+#define FTL_SEG_USED  2
+
+/*
+ * Writes collect until this many segments are free before they open one,
+ * so that the last free segment is always left for the collection.
+ */
+#define FTL_GC_MIN    2
+
+/* move the oldest segment every FTL_GC_WEAR collections */
+#define FTL_GC_WEAR   16
+
+
+static int ftl_gc (disk_ftl_t *ftl);
+
+
+static
+uint32_t ftl_tag (uint32_t lba)
+{
+	unsigned chk;
+
+	chk = (lba ^ (lba >> 8) ^ (lba >> 16) ^ 0xa5) & 0xff;
+
+	return ((lba << 8) | chk);
+}
+
+/*
+ * Get the logical block number from a tag
+ * Returns non-zero if the tag is unused or damaged.
+ */
+static
+int ftl_get_tag (uint32_t tag, uint32_t *lba)
+{
+	if (tag == FTL_TAG_NONE) {
+		return (1);
+	}
+
+	*lba = tag >> 8;
+
+	if (ftl_tag (*lba) != tag) {
+		return (1);
+	}
+
+	return (0);
+}
+
+static
+uint32_t ftl_seg_ofs (disk_ftl_t *ftl, unsigned seg, unsigned slot)
+{
+	return (512 * (FTL_SEG_SIZE * seg + slot));
+}
+
+/*
+ * Pick a free segment, the one that was erased least often
+ */
+static
+int ftl_seg_alloc (disk_ftl_t *ftl, unsigned *seg)
+{
+	unsigned i, j;
+
+	j = ftl->seg_cnt;
+
+	for (i = 0; i < ftl->seg_cnt; i++) {
+		if (ftl->state[i] != FTL_SEG_FREE) {
+			continue;
+		}
+
+		if ((j >= ftl->seg_cnt) || (ftl->erase_cnt[i] < ftl->erase_cnt[j])) {
+			j = i;
+		}
+	}
+
+	if (j >= ftl->seg_cnt) {
+		return (1);
+	}
+
+	*seg = j;
+
+	return (0);
+}
+
+static
+int ftl_seg_erase (disk_ftl_t *ftl, unsigned seg)
+{
+	if (flash_erase (ftl->fl, ftl_seg_ofs (ftl, seg, 0), 512 * FTL_SEG_SIZE)) {
+		return (1);
+	}
+
+	ftl->erase_cnt[seg] += 1;
+
+	return (0);
+}
+
+/*
+ * Check if a new segment must be opened before the next append
+ */
+static
+int ftl_seg_full (const disk_ftl_t *ftl)
+{
+	if (ftl->state[ftl->cur] != FTL_SEG_OPEN) {
+		return (1);
+	}
+
+	return (ftl->cur_slot >= FTL_SEG_SIZE);
+}
+
+/*
+ * Erase a free segment and make it the open segment
+ */
+static
+int ftl_seg_open (disk_ftl_t *ftl)
+{
+	unsigned      seg;
+	unsigned char hdr[16];
+
+	if (ftl->state[ftl->cur] == FTL_SEG_OPEN) {
+		ftl->state[ftl->cur] = FTL_SEG_USED;
+	}
+
+	if (ftl_seg_alloc (ftl, &seg)) {
+		return (1);
+	}
+
+	if (ftl_seg_erase (ftl, seg)) {
+		return (1);
+	}
+
+	dsk_set_uint32_be (hdr, 0, FTL_MAGIC);
+	dsk_set_uint32_be (hdr, 4, ftl->next_seq);
+	dsk_set_uint32_be (hdr, 8, ftl->erase_cnt[seg]);
+	dsk_set_uint32_be (hdr, 12, 0);
+
+	if (flash_write (ftl->fl, hdr, ftl_seg_ofs (ftl, seg, 0), 16)) {
+		return (1);
+	}
+
+	ftl->state[seg] = FTL_SEG_OPEN;
+	ftl->seq[seg] = ftl->next_seq;
+	ftl->live[seg] = 0;
+	ftl->free_cnt -= 1;
+
+	ftl->next_seq += 1;
+
+	ftl->cur = seg;
+	ftl->cur_slot = 1;
+
+	return (0);
+}
+
+/*
+ * Append up to n sectors to the open segment
+ * Returns the number of sectors written or 0 on error.
+ */
+static
+unsigned ftl_append (disk_ftl_t *ftl, const unsigned char *buf, uint32_t lba, unsigned n, int gc)
+{
+	unsigned      i, seg, slot;
+	uint16_t      old;
+	unsigned char tag[4 * FTL_SEG_DATA];
+
+	if ((gc == 0) && (ftl->free_cnt < (ftl_seg_full (ftl) ? FTL_GC_MIN : 1))) {
+		return (0);
+	}
+
+	if (ftl_seg_full (ftl)) {
+		if (ftl_seg_open (ftl)) {
+			return (0);
+		}
+	}
+
+	seg = ftl->cur;
+	slot = ftl->cur_slot;
+
+	if (n > (FTL_SEG_SIZE - slot)) {
+		n = FTL_SEG_SIZE - slot;
+	}
+
+	/* the data first, the tags make the slots valid */
+	if (flash_write (ftl->fl, buf, ftl_seg_ofs (ftl, seg, slot), 512 * n)) {
+		/* don't program the same slots twice */
+		ftl->cur_slot = FTL_SEG_SIZE;
+		return (0);
+	}
+
+	for (i = 0; i < n; i++) {
+		dsk_set_uint32_be (tag, 4 * i, ftl_tag (lba + i));
+	}
+
+	if (flash_write (ftl->fl, tag, ftl_seg_ofs (ftl, seg, 0) + FTL_TAG_OFS + 4 * (slot - 1), 4 * n)) {
+		ftl->cur_slot = FTL_SEG_SIZE;
+		return (0);
+	}
+
+	for (i = 0; i < n; i++) {
+		old = ftl->map[lba + i];
+
+		if (old != FTL_NONE) {
+			ftl->live[old / FTL_SEG_SIZE] -= 1;
+		}
+
+		ftl->map[lba + i] = FTL_SEG_SIZE * seg + slot + i;
+	}
+
+	ftl->live[seg] += n;
+	ftl->cur_slot += n;
+
+	return (n);
+}
+
+static
+int ftl_gc_victim (disk_ftl_t *ftl, unsigned *seg)
+{
+	unsigned i, j;
+	int      wear;
+
+	/* moving a full segment needs a spare free segment */
+	wear = ((ftl->gc_cnt % FTL_GC_WEAR) == (FTL_GC_WEAR - 1));
+	wear = wear && (ftl->free_cnt >= FTL_GC_MIN);
+
+	j = ftl->seg_cnt;
+
+	for (i = 0; i < ftl->seg_cnt; i++) {
+		if (ftl->state[i] != FTL_SEG_USED) {
+			continue;
+		}
+
+		if (j >= ftl->seg_cnt) {
+			j = i;
+		}
+		else if (wear) {
+			if (ftl->seq[i] < ftl->seq[j]) {
+				j = i;
+			}
+		}
+		else if ((ftl->live[i] < ftl->live[j]) || ((ftl->live[i] == ftl->live[j]) && (ftl->seq[i] < ftl->seq[j]))) {
+			j = i;
+		}
+	}
+
+	if (j >= ftl->seg_cnt) {
+		return (1);
+	}
+
+	if ((wear == 0) && (ftl->live[j] >= FTL_SEG_DATA)) {
+		/* nothing to gain */
+		return (1);
+	}
+
+	*seg = j;
+
+	return (0);
+}
+
+/*
+ * Move the live sectors of one segment to the open segment and free it
+ */
+static
+int ftl_gc (disk_ftl_t *ftl)
+{
+	unsigned      i, seg;
+	uint32_t      lba;
+	unsigned char hdr[FTL_TAG_OFS + 4 * FTL_SEG_DATA];
+
+	if (ftl_gc_victim (ftl, &seg)) {
+		return (1);
+	}
+
+	ftl->gc_cnt += 1;
+
+	if (flash_read (ftl->fl, hdr, ftl_seg_ofs (ftl, seg, 0), sizeof (hdr))) {
+		return (1);
+	}
+
+	for (i = 1; i < FTL_SEG_SIZE; i++) {
+		if (ftl->live[seg] == 0) {
+			break;
+		}
+
+		if (ftl_get_tag (dsk_get_uint32_be (hdr, FTL_TAG_OFS + 4 * (i - 1)), &lba)) {
+			continue;
+		}
+
+		if ((lba >= ftl->dsk.blocks) || (ftl->map[lba] != (FTL_SEG_SIZE * seg + i))) {
+			continue;
+		}
+
+		if (flash_read (ftl->fl, ftl->buf, ftl_seg_ofs (ftl, seg, i), 512)) {
+			return (1);
+		}
+
+		if (ftl_append (ftl, ftl->buf, lba, 1, 1) != 1) {
+			return (1);
+		}
+	}
+
+	if (ftl_seg_erase (ftl, seg)) {
+		return (1);
+	}
+
+	ftl->state[seg] = FTL_SEG_FREE;
+	ftl->live[seg] = 0;
+	ftl->free_cnt += 1;
+
+	return (0);
+}
+
+/*
+ * Collect before writing
+ *
+ * A collection that is interrupted can leave the free segments one
+ * short. Writes only fill the open segment while a segment is free and
+ * only open a new one while FTL_GC_MIN segments are free, so that the
+ * next collection can always proceed.
+ */
+static
+void ftl_gc_write (disk_ftl_t *ftl)
+{
+	while (ftl->free_cnt < (ftl_seg_full (ftl) ? FTL_GC_MIN : 1)) {
+		if (ftl_gc (ftl)) {
+			break;
+		}
+	}
+}
+
+static
+int dsk_ftl_read (disk_t *dsk, void *buf, uint32_t i, uint32_t n)
+{
+	uint32_t      j, k;
+	unsigned char *dst;
+	disk_ftl_t    *ftl;
+
+	ftl = dsk->ext;
+
+	if ((i + n) > dsk->blocks) {
+		return (1);
+	}
+
+	dst = buf;
+
+	while (n > 0) {
+		if (ftl->map[i] == FTL_NONE) {
+			memset (dst, 0, 512);
+			k = 1;
+		}
+		else {
+			/* read physically consecutive sectors at once */
+			j = ftl->map[i];
+			k = 1;
+
+			while ((k < n) && (ftl->map[i + k] == (j + k)) && (((j + k) % FTL_SEG_SIZE) != 0)) {
+				k += 1;
+			}
+
+			if (flash_read (ftl->fl, dst, 512 * j, 512 * k)) {
+				return (1);
+			}
+		}
+
+		dst += 512 * k;
+		i += k;
+		n -= k;
+	}
+
+	return (0);
+}
+
+static
+int dsk_ftl_write (disk_t *dsk, const void *buf, uint32_t i, uint32_t n)
+{
+	unsigned            k;
+	const unsigned char *src;
+	disk_ftl_t          *ftl;
+
+	if (dsk->readonly) {
+		return (1);
+	}
+
+	ftl = dsk->ext;
+
+	if ((i + n) > dsk->blocks) {
+		return (1);
+	}
+
+	src = buf;
+
+	while (n > 0) {
+		ftl_gc_write (ftl);
+
+		k = ftl_append (ftl, src, i, n, 0);
+
+		if (k == 0) {
+			return (1);
+		}
+
+		src += 512 * k;
+		i += k;
+		n -= k;
+	}
+
+	return (0);
+}
+
+static
+int dsk_ftl_set_msg (disk_t *dsk, const char *msg, const char *val)
+{
+	disk_ftl_t *ftl;
+
+	ftl = dsk->ext;
+
+	if (strcmp (msg, "commit") == 0) {
+		return (0);
+	}
+	else if (strcmp (msg, "flush") == 0) {
+		/* collect in the background, before the writes have to wait */
+		if (ftl->free_cnt < (FTL_GC_MIN + ftl->reserve / 2)) {
+			ftl_gc (ftl);
+		}
+
+		return (0);
+	}
+
+	return (1);
+}
+
+static
+void dsk_ftl_free (disk_ftl_t *ftl)
+{
+	free (ftl->erase_cnt);
+	free (ftl->seq);
+	free (ftl->state);
+	free (ftl->live);
+	free (ftl->map);
+}
+
+static
+void dsk_ftl_del (disk_t *dsk)
+{
+	disk_ftl_t *ftl;
+
+	ftl = dsk->ext;
+
+	dsk_ftl_free (ftl);
+	flash_del (ftl->fl);
+	free (ftl);
+}
+
+/*
+ * Continue writing the newest segment after its last used slot
+ *
+ * Otherwise every interrupted collection would leave a partially used
+ * segment behind, and enough of them could use up the free segments
+ * that the next collection needs. A slot whose data was written
+ * partially before its tag is skipped.
+ */
+static
+int dsk_ftl_mount_open (disk_ftl_t *ftl, unsigned seg, const unsigned char *hdr)
+{
+	unsigned      i, j;
+	unsigned char buf[512];
+
+	i = FTL_SEG_SIZE;
+
+	while ((i > 1) && (dsk_get_uint32_be (hdr, FTL_TAG_OFS + 4 * (i - 2)) == FTL_TAG_NONE)) {
+		i -= 1;
+	}
+
+	ftl->cur = seg;
+	ftl->cur_slot = i;
+
+	while (i < FTL_SEG_SIZE) {
+		if (flash_read (ftl->fl, buf, ftl_seg_ofs (ftl, seg, i), 512)) {
+			return (1);
+		}
+
+		for (j = 0; j < 512; j++) {
+			if (buf[j] != 0xff) {
+				ftl->cur_slot = i + 1;
+				break;
+			}
+		}
+
+		i += 1;
+	}
+
+	if (ftl->cur_slot < FTL_SEG_SIZE) {
+		ftl->state[seg] = FTL_SEG_OPEN;
+	}
+
+	return (0);
+}
+
+/*
+ * Rebuild the map from the segment summaries
+ */
+static
+int dsk_ftl_mount (disk_ftl_t *ftl)
+{
+	unsigned      i, j, k, seg;
+	uint32_t      lba, erase_max;
+	unsigned      *order;
+	unsigned char *hdr;
+
+	hdr = ftl->buf;
+
+	order = malloc (ftl->seg_cnt * sizeof (unsigned));
+
+	if (order == NULL) {
+		return (1);
+	}
+
+	k = 0;
+	erase_max = 0;
+
+	for (i = 0; i < ftl->seg_cnt; i++) {
+		if (flash_read (ftl->fl, hdr, ftl_seg_ofs (ftl, i, 0), 16)) {
+			free (order);
+			return (1);
+		}
+
+		ftl->live[i] = 0;
+
+		if (dsk_get_uint32_be (hdr, 0) != FTL_MAGIC) {
+			ftl->state[i] = FTL_SEG_FREE;
+			ftl->seq[i] = 0;
+			ftl->erase_cnt[i] = 0;
+			continue;
+		}
+
+		ftl->state[i] = FTL_SEG_USED;
+		ftl->seq[i] = dsk_get_uint32_be (hdr, 4);
+		ftl->erase_cnt[i] = dsk_get_uint32_be (hdr, 8);
+
+		if (ftl->erase_cnt[i] > erase_max) {
+			erase_max = ftl->erase_cnt[i];
+		}
+
+		if (ftl->seq[i] >= ftl->next_seq) {
+			ftl->next_seq = ftl->seq[i] + 1;
+		}
+
+		/* insertion sort by sequence number */
+		j = k;
+		while ((j > 0) && (ftl->seq[order[j - 1]] > ftl->seq[i])) {
+			order[j] = order[j - 1];
+			j -= 1;
+		}
+
+		order[j] = i;
+		k += 1;
+	}
+
+	ftl->blank = (k == 0);
+
+	for (i = 0; i < k; i++) {
+		seg = order[i];
+
+		if (flash_read (ftl->fl, hdr, ftl_seg_ofs (ftl, seg, 0), 512)) {
+			free (order);
+			return (1);
+		}
+
+		for (j = 1; j < FTL_SEG_SIZE; j++) {
+			if (ftl_get_tag (dsk_get_uint32_be (hdr, FTL_TAG_OFS + 4 * (j - 1)), &lba)) {
+				continue;
+			}
+
+			if (lba < ftl->dsk.blocks) {
+				ftl->map[lba] = FTL_SEG_SIZE * seg + j;
+			}
+		}
+	}
+
+	ftl->cur = 0;
+	ftl->cur_slot = FTL_SEG_SIZE;
+
+	if (k > 0) {
+		/* hdr still holds the summary of the newest segment */
+		if (dsk_ftl_mount_open (ftl, order[k - 1], hdr)) {
+			free (order);
+			return (1);
+		}
+	}
+
+	free (order);
+
+	for (i = 0; i < ftl->dsk.blocks; i++) {
+		if (ftl->map[i] != FTL_NONE) {
+			ftl->live[ftl->map[i] / FTL_SEG_SIZE] += 1;
+		}
+	}
+
+	ftl->free_cnt = 0;
+
+	for (i = 0; i < ftl->seg_cnt; i++) {
+		if (ftl->state[i] == FTL_SEG_FREE) {
+			/* the erase count was lost, assume a worn segment */
+			ftl->erase_cnt[i] = erase_max;
+			ftl->free_cnt += 1;
+		}
+	}
+
+	return (0);
+}
+
+static
+int dsk_ftl_init (disk_ftl_t *ftl, flash_t *fl)
+{
+	uint32_t i, blocks;
+
+	ftl->fl = fl;
+
+	ftl->seg_cnt = fl->size / (512 * FTL_SEG_SIZE);
+	ftl->reserve = ftl->seg_cnt / 16 + FTL_GC_MIN + 1;
+
+	if ((ftl->seg_cnt <= ftl->reserve) || ((FTL_SEG_SIZE * ftl->seg_cnt) > FTL_MAX_SECTS)) {
+		return (1);
+	}
+
+	if ((512 * FTL_SEG_SIZE) % fl->erase_size) {
+		return (1);
+	}
+
+	blocks = FTL_SEG_DATA * (ftl->seg_cnt - ftl->reserve);
+
+	dsk_init (&ftl->dsk, ftl, blocks, 0, 0, 0);
+
+	dsk_set_type (&ftl->dsk, PCE_DISK_RAW);
+
+	ftl->dsk.del = dsk_ftl_del;
+	ftl->dsk.read = dsk_ftl_read;
+	ftl->dsk.write = dsk_ftl_write;
+	ftl->dsk.set_msg = dsk_ftl_set_msg;
+
+	ftl->map = malloc (blocks * sizeof (uint16_t));
+	ftl->live = malloc (ftl->seg_cnt);
+	ftl->state = malloc (ftl->seg_cnt);
+	ftl->seq = malloc (ftl->seg_cnt * sizeof (uint32_t));
+	ftl->erase_cnt = malloc (ftl->seg_cnt * sizeof (uint32_t));
+
+	if ((ftl->map == NULL) || (ftl->live == NULL) || (ftl->state == NULL)) {
+		return (1);
+	}
+
+	if ((ftl->seq == NULL) || (ftl->erase_cnt == NULL)) {
+		return (1);
+	}
+
+	for (i = 0; i < blocks; i++) {
+		ftl->map[i] = FTL_NONE;
+	}
+
+	ftl->free_cnt = 0;
+	ftl->cur = 0;
+	ftl->cur_slot = FTL_SEG_SIZE;
+	ftl->next_seq = 1;
+	ftl->gc_cnt = 0;
+	ftl->blank = 0;
+
+	return (0);
+}
+
+disk_t *dsk_ftl_new (flash_t *fl, int format)
+{
+	disk_ftl_t *ftl;
+
+	ftl = malloc (sizeof (disk_ftl_t));
+
+	if (ftl == NULL) {
+		return (NULL);
+	}
+
+	ftl->map = NULL;
+	ftl->live = NULL;
+	ftl->state = NULL;
+	ftl->seq = NULL;
+	ftl->erase_cnt = NULL;
+
+	if (dsk_ftl_init (ftl, fl) || dsk_ftl_mount (ftl)) {
+		dsk_ftl_free (ftl);
+		free (ftl);
+		return (NULL);
+	}
+
+	if (ftl->blank && (format == 0)) {
+		dsk_ftl_free (ftl);
+		free (ftl);
+		return (NULL);
+	}
+
+	return (&ftl->dsk);
+}
+
+int dsk_ftl_get_blank (const disk_t *dsk)
+{
+	const disk_ftl_t *ftl;
+
+	ftl = dsk->ext;
+
+	return (ftl->blank);
+}
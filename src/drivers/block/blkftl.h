@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/block/blkftl.h                                   *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#ifndef PCE_DEVICES_BLOCK_BLKFTL_H
+#define PCE_DEVICES_BLOCK_BLKFTL_H 1
+
+
+#include <config.h>
+
+#include <drivers/block/block.h>
+#include <drivers/block/flash.h>
+
+#include <stdint.h>
+
+
+/* sectors per segment, the first one is the segment summary */
+#define FTL_SEG_SIZE  64
+#define FTL_SEG_DATA  (FTL_SEG_SIZE - 1)
+
+/* the largest supported flash, in sectors */
+#define FTL_MAX_SECTS 0xffff
+
+
+/*!***************************************************************************
+ * @short The log-structured flash disk structure
+ *
+ * The flash is split into segments of FTL_SEG_SIZE sectors. Sectors are
+ * always written to the next free slot of the open segment, and the
+ * first sector of every segment holds the logical block number of each
+ * slot. The tag is programmed after the data, so a slot only becomes
+ * valid once it has been written completely.
+ *
+ * The logical to physical map is kept in RAM. It is rebuilt when the
+ * disk is opened from the segment summaries, the newest copy of every
+ * logical block wins. Writing continues in the newest segment.
+ *
+ * Segments are reclaimed by copying their live sectors to the open
+ * segment, preferably the segment with the fewest live sectors. Every
+ * few collections the oldest segment is moved instead, so that blocks
+ * holding static data are erased as well.
+ *****************************************************************************/
+typedef struct {
+	disk_t        dsk;
+
+	flash_t       *fl;
+
+	unsigned      seg_cnt;
+
+	/* segments that are kept free for garbage collection */
+	unsigned      reserve;
+
+	/* logical block -> segment * FTL_SEG_SIZE + slot */
+	uint16_t      *map;
+
+	/* per segment */
+	unsigned char *live;
+	unsigned char *state;
+	uint32_t      *seq;
+	uint32_t      *erase_cnt;
+
+	unsigned      free_cnt;
+
+	unsigned      cur;
+	unsigned      cur_slot;
+
+	uint32_t      next_seq;
+
+	unsigned long gc_cnt;
+
+	/* non-zero if the flash did not contain any segments */
+	char          blank;
+
+	unsigned char buf[512];
+} disk_ftl_t;
+
+
+/*!***************************************************************************
+ * @short  Open a log-structured disk on top of a flash area
+ * @param  fl     The flash area. It is deleted with the disk.
+ * @param  format If false, fail if the flash does not contain any segments
+ * @return The new disk or NULL on error
+ *
+ * The disk handles the "flush" message by collecting one segment if free
+ * segments are getting low, so that collection mostly happens while the
+ * disk is idle.
+ *****************************************************************************/
+disk_t *dsk_ftl_new (flash_t *fl, int format);
+
+/*!***************************************************************************
+ * @short Check if the flash was blank when the disk was opened
+ *****************************************************************************/
+int dsk_ftl_get_blank (const disk_t *dsk);
+
+
+#endif
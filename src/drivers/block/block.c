@@ -351,6 +351,7 @@ void dsk_init (disk_t *dsk, void *ext, uint32_t n, uint32_t c, uint32_t h, uint3
 	dsk->del = NULL;
 	dsk->read = NULL;
 	dsk->write = NULL;
+	dsk->ready = NULL;
 	dsk->get_msg = NULL;
 	dsk->set_msg = NULL;
 
@@ -846,6 +847,15 @@ int dsk_read_chs (disk_t *dsk, void *buf,
 	return (dsk_read_lba (dsk, buf, i, n));
 }
 
+int dsk_get_ready (disk_t *dsk, uint32_t i, uint32_t n)
+{
+	if (dsk->ready != NULL) {
+		return (dsk->ready (dsk, i, n));
+	}
+
+	return (1);
+}
+
 int dsk_write_lba (disk_t *dsk, const void *buf, uint32_t i, uint32_t n)
 {
 	if (dsk->write != NULL) {
@@ -1034,6 +1044,17 @@ int dsks_commit (disks_t *dsks)
 	return (r);
 }
 
+void dsks_flush (disks_t *dsks)
+{
+	unsigned i;
+
+	for (i = 0; i < dsks->cnt; i++) {
+		if (dsks->dsk[i]->set_msg != NULL) {
+			dsk_set_msg (dsks->dsk[i], "flush", NULL);
+		}
+	}
+}
+
 int dsks_get_msg (disks_t *dsks, unsigned drv, const char *msg, char *val, unsigned max)
 {
 	disk_t *dsk;
@@ -45,7 +45,8 @@ enum {
 	PCE_DISK_QED,
 	PCE_DISK_PBI,
 	PCE_DISK_CHD,
-	PCE_DISK_PRI
+	PCE_DISK_PRI,
+	PCE_DISK_ASYNC
 };
 
 
@@ -56,6 +57,8 @@ typedef int (*dsk_read_f) (struct disk_s *dsk, void *buf, uint32_t i, uint32_t n
 
 typedef int (*dsk_write_f) (struct disk_s *dsk, const void *buf, uint32_t i, uint32_t n);
 
+typedef int (*dsk_ready_f) (struct disk_s *dsk, uint32_t i, uint32_t n);
+
 typedef int (*dsk_get_msg_f) (struct disk_s *dsk, const char *msg, char *val, unsigned max);
 typedef int (*dsk_set_msg_f) (struct disk_s *dsk, const char *msg, const char *val);
 
@@ -69,6 +72,7 @@ typedef struct disk_s {
 	void          (*del) (struct disk_s *dsk);
 	dsk_read_f    read;
 	dsk_write_f   write;
+	dsk_ready_f   ready;
 	dsk_get_msg_f get_msg;
 	dsk_set_msg_f set_msg;
 
@@ -238,6 +242,15 @@ int dsk_read_chs (disk_t *dsk, void *buf,
 	uint32_t c, uint32_t h, uint32_t s, uint32_t blk_n
 );
 
+/*!***************************************************************************
+ * @short  Check if blocks can be read without waiting
+ * @return Non-zero if reading the blocks would not block
+ *
+ * Disks that read in the background start fetching the blocks if they
+ * are not available yet. All other disks are always ready.
+ *****************************************************************************/
+int dsk_get_ready (disk_t *dsk, uint32_t i, uint32_t n);
+
 /*!***************************************************************************
  * @short  Write blocks using LBA addressing
  * @return Zero if successful
@@ -306,6 +319,14 @@ disk_t *dsks_get_disk (disks_t *dsks, unsigned drive);
  *****************************************************************************/
 int dsks_commit (disks_t *dsks);
 
+/*!***************************************************************************
+ * @short  Write back idle cached data of all disks in a disk set
+ *
+ * This is meant to be called periodically. Disks without a write cache
+ * ignore it.
+ *****************************************************************************/
+void dsks_flush (disks_t *dsks);
+
 /*!***************************************************************************
  * @short  Get a message from a disk
  * @param  drv The drive number
@@ -0,0 +1,217 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/block/flash.c                                    *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#include "flash.h"
+#include "block.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef struct {
+	flash_t fl;
+
+	FILE    *fp;
+} flash_file_t;
+
+
+void flash_init (flash_t *fl, void *ext, uint32_t size, uint32_t erase_size)
+{
+	fl->del = NULL;
+	fl->read = NULL;
+	fl->write = NULL;
+	fl->erase = NULL;
+
+	fl->size = size;
+	fl->erase_size = erase_size;
+
+	fl->cnt_read = 0;
+	fl->cnt_write = 0;
+	fl->cnt_erase = 0;
+
+	fl->ext = ext;
+}
+
+void flash_del (flash_t *fl)
+{
+	if ((fl != NULL) && (fl->del != NULL)) {
+		fl->del (fl);
+	}
+}
+
+int flash_read (flash_t *fl, void *buf, uint32_t ofs, uint32_t cnt)
+{
+	if ((ofs > fl->size) || (cnt > (fl->size - ofs))) {
+		return (1);
+	}
+
+	fl->cnt_read += 1;
+
+	return (fl->read (fl, buf, ofs, cnt));
+}
+
+int flash_write (flash_t *fl, const void *buf, uint32_t ofs, uint32_t cnt)
+{
+	if ((ofs > fl->size) || (cnt > (fl->size - ofs))) {
+		return (1);
+	}
+
+	fl->cnt_write += 1;
+
+	return (fl->write (fl, buf, ofs, cnt));
+}
+
+int flash_erase (flash_t *fl, uint32_t ofs, uint32_t cnt)
+{
+	if ((ofs > fl->size) || (cnt > (fl->size - ofs))) {
+		return (1);
+	}
+
+	if ((ofs % fl->erase_size) || (cnt % fl->erase_size)) {
+		return (1);
+	}
+
+	fl->cnt_erase += cnt / fl->erase_size;
+
+	return (fl->erase (fl, ofs, cnt));
+}
+
+
+static
+int flash_file_read (flash_t *fl, void *buf, uint32_t ofs, uint32_t cnt)
+{
+	flash_file_t *ff;
+
+	ff = fl->ext;
+
+	return (dsk_read (ff->fp, buf, ofs, cnt));
+}
+
+/*
+ * Like NOR flash, writing can only clear bits
+ */
+static
+int flash_file_write (flash_t *fl, const void *buf, uint32_t ofs, uint32_t cnt)
+{
+	uint32_t            i, n;
+	unsigned char       tmp[512];
+	const unsigned char *src;
+	flash_file_t        *ff;
+
+	ff = fl->ext;
+	src = buf;
+
+	while (cnt > 0) {
+		n = (cnt < 512) ? cnt : 512;
+
+		if (dsk_read (ff->fp, tmp, ofs, n)) {
+			return (1);
+		}
+
+		for (i = 0; i < n; i++) {
+			tmp[i] &= src[i];
+		}
+
+		if (dsk_write (ff->fp, tmp, ofs, n)) {
+			return (1);
+		}
+
+		src += n;
+		ofs += n;
+		cnt -= n;
+	}
+
+	return (0);
+}
+
+static
+int flash_file_erase (flash_t *fl, uint32_t ofs, uint32_t cnt)
+{
+	uint32_t      n;
+	unsigned char tmp[512];
+	flash_file_t  *ff;
+
+	ff = fl->ext;
+
+	memset (tmp, 0xff, sizeof (tmp));
+
+	while (cnt > 0) {
+		n = (cnt < 512) ? cnt : 512;
+
+		if (dsk_write (ff->fp, tmp, ofs, n)) {
+			return (1);
+		}
+
+		ofs += n;
+		cnt -= n;
+	}
+
+	return (0);
+}
+
+static
+void flash_file_del (flash_t *fl)
+{
+	flash_file_t *ff;
+
+	ff = fl->ext;
+
+	fclose (ff->fp);
+	free (ff);
+}
+
+flash_t *flash_file_open (const char *fname, uint32_t erase_size)
+{
+	uint64_t     size;
+	flash_file_t *ff;
+
+	if (erase_size == 0) {
+		return (NULL);
+	}
+
+	ff = malloc (sizeof (flash_file_t));
+
+	if (ff == NULL) {
+		return (NULL);
+	}
+
+	ff->fp = fopen (fname, "r+b");
+
+	if (ff->fp == NULL) {
+		free (ff);
+		return (NULL);
+	}
+
+	if (dsk_get_filesize (ff->fp, &size) || (size > 0xffffffff)) {
+		fclose (ff->fp);
+		free (ff);
+		return (NULL);
+	}
+
+	flash_init (&ff->fl, ff, size - (size % erase_size), erase_size);
+
+	ff->fl.del = flash_file_del;
+	ff->fl.read = flash_file_read;
+	ff->fl.write = flash_file_write;
+	ff->fl.erase = flash_file_erase;
+
+	return (&ff->fl);
+}
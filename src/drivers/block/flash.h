@@ -0,0 +1,103 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/block/flash.h                                    *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#ifndef PCE_DEVICES_BLOCK_FLASH_H
+#define PCE_DEVICES_BLOCK_FLASH_H 1
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+struct flash_s;
+
+
+typedef int (*flash_read_f) (struct flash_s *fl, void *buf, uint32_t ofs, uint32_t cnt);
+typedef int (*flash_write_f) (struct flash_s *fl, const void *buf, uint32_t ofs, uint32_t cnt);
+typedef int (*flash_erase_f) (struct flash_s *fl, uint32_t ofs, uint32_t cnt);
+
+
+/*!***************************************************************************
+ * @short A NOR flash area
+ *
+ * Erasing sets all bytes of an erase block to 0xff, writing can only
+ * clear bits.
+ *****************************************************************************/
+typedef struct flash_s {
+	void          (*del) (struct flash_s *fl);
+	flash_read_f  read;
+	flash_write_f write;
+	flash_erase_f erase;
+
+	uint32_t      size;
+	uint32_t      erase_size;
+
+	/* statistics */
+	unsigned long cnt_read;
+	unsigned long cnt_write;
+	unsigned long cnt_erase;
+
+	void          *ext;
+} flash_t;
+
+
+/*!***************************************************************************
+ * @short Initialize a flash structure
+ *****************************************************************************/
+void flash_init (flash_t *fl, void *ext, uint32_t size, uint32_t erase_size);
+
+/*!***************************************************************************
+ * @short Delete a flash area
+ *****************************************************************************/
+void flash_del (flash_t *fl);
+
+/*!***************************************************************************
+ * @short  Read from a flash area
+ * @return Zero if successful
+ *****************************************************************************/
+int flash_read (flash_t *fl, void *buf, uint32_t ofs, uint32_t cnt);
+
+/*!***************************************************************************
+ * @short  Write to an erased flash area
+ * @return Zero if successful
+ *****************************************************************************/
+int flash_write (flash_t *fl, const void *buf, uint32_t ofs, uint32_t cnt);
+
+/*!***************************************************************************
+ * @short  Erase whole erase blocks
+ * @return Zero if successful
+ *
+ * Both ofs and cnt must be multiples of the erase block size.
+ *****************************************************************************/
+int flash_erase (flash_t *fl, uint32_t ofs, uint32_t cnt);
+
+/*!***************************************************************************
+ * @short  Open a file that simulates a flash area
+ * @param  fname      The file name. The file size is the flash size.
+ * @param  erase_size The erase block size
+ * @return The new flash area or NULL on error
+ *****************************************************************************/
+flash_t *flash_file_open (const char *fname, uint32_t erase_size);
+
+
+#endif
@@ -0,0 +1,223 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/video/downscale.c                                *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <drivers/video/terminal.h>
+#include <drivers/video/downscale.h>
+
+
+static
+void dsc_init_tables (downscale_t *ds)
+{
+	unsigned i, j, v, a, b;
+
+	/*
+	 * Destination pixel j covers [8j, 8j + 8) and source pixel i
+	 * covers [qi, qi + q), both in units of 1/q source pixels.
+	 * The weights of a destination pixel add up to 8, so a fully
+	 * set 8x8 area adds up to 64.
+	 */
+	for (j = 0; j < 8; j++) {
+		ds->lo[j] = 8;
+		ds->hi[j] = 0;
+
+		for (i = 0; i < 8; i++) {
+			a = (8 * j > ds->q * i) ? (8 * j) : (ds->q * i);
+			b = ((8 * j + 8) < (ds->q * i + ds->q)) ? (8 * j + 8) : (ds->q * i + ds->q);
+
+			ds->wt[j][i] = (b > a) ? (b - a) : 0;
+
+			if (ds->wt[j][i] > 0) {
+				if (i < ds->lo[j]) {
+					ds->lo[j] = i;
+				}
+
+				ds->hi[j] = i;
+			}
+		}
+	}
+
+	for (j = 0; j < 8; j++) {
+		for (v = 0; v < 256; v++) {
+			ds->sum[j][v] = 0;
+
+			for (i = 0; i < 8; i++) {
+				if (v & (0x80 >> i)) {
+					ds->sum[j][v] += ds->wt[j][i];
+				}
+			}
+		}
+	}
+}
+
+static
+void dsc_init_pal (downscale_t *ds)
+{
+	unsigned i, k;
+	int      c[3];
+
+	for (i = 0; i <= 64; i++) {
+		for (k = 0; k < 3; k++) {
+			c[k] = ds->col[0][k];
+			c[k] += ((ds->col[1][k] - c[k]) * (int) i + 32) / 64;
+		}
+
+		ds->pal[i] = ((c[0] & 0xf8) << 8) | ((c[1] & 0xfc) << 3) | (c[2] >> 3);
+	}
+}
+
+int dsc_init (downscale_t *ds, unsigned w, unsigned h, unsigned q)
+{
+	if ((q < 1) || (q > 8)) {
+		return (1);
+	}
+
+	ds->q = q;
+
+	ds->src_w = w;
+	ds->src_h = h;
+	ds->src_bpl = (w + 7) / 8;
+
+	/* round up to a multiple of 8 lines, the padding stays 0 */
+	ds->src = calloc ((h + 7) & ~7U, ds->src_bpl);
+
+	if (ds->src == NULL) {
+		return (1);
+	}
+
+	ds->dst_w = (w * q + 7) / 8;
+	ds->dst_h = (h * q + 7) / 8;
+
+	memset (ds->col[0], 0x00, 3);
+	memset (ds->col[1], 0xff, 3);
+
+	dsc_init_tables (ds);
+	dsc_init_pal (ds);
+
+	return (0);
+}
+
+void dsc_free (downscale_t *ds)
+{
+	free (ds->src);
+
+	ds->src = NULL;
+}
+
+int dsc_set_colors (downscale_t *ds, const unsigned char *bg, const unsigned char *fg)
+{
+	if ((memcmp (ds->col[0], bg, 3) == 0) && (memcmp (ds->col[1], fg, 3) == 0)) {
+		return (0);
+	}
+
+	memcpy (ds->col[0], bg, 3);
+	memcpy (ds->col[1], fg, 3);
+
+	dsc_init_pal (ds);
+
+	return (1);
+}
+
+void dsc_set_lines (downscale_t *ds, const unsigned char *buf, unsigned long bpl, unsigned y, unsigned cnt)
+{
+	unsigned long n;
+
+	if (y >= ds->src_h) {
+		return;
+	}
+
+	if ((y + cnt) > ds->src_h) {
+		cnt = ds->src_h - y;
+	}
+
+	n = (bpl < ds->src_bpl) ? bpl : ds->src_bpl;
+
+	while (cnt > 0) {
+		memcpy (ds->src + ds->src_bpl * y, buf, n);
+
+		buf += bpl;
+		y += 1;
+		cnt -= 1;
+	}
+}
+
+void dsc_get_rect (const downscale_t *ds, trm_rect_t *dst, const trm_rect_t *src)
+{
+	unsigned x1, y1;
+
+	dst->x = (src->x * ds->q) / 8;
+	dst->y = (src->y * ds->q) / 8;
+
+	x1 = ((src->x + src->w) * ds->q + 7) / 8;
+	y1 = ((src->y + src->h) * ds->q + 7) / 8;
+
+	if (x1 > ds->dst_w) {
+		x1 = ds->dst_w;
+	}
+
+	if (y1 > ds->dst_h) {
+		y1 = ds->dst_h;
+	}
+
+	dst->w = (x1 > dst->x) ? (x1 - dst->x) : 0;
+	dst->h = (y1 > dst->y) ? (y1 - dst->y) : 0;
+}
+
+void dsc_convert (const downscale_t *ds, unsigned char *buf, const trm_rect_t *dst)
+{
+	unsigned            x, y, i, j, k, r, v;
+	unsigned            lo, hi;
+	const unsigned char *src, *p;
+
+	for (y = 0; y < dst->h; y++) {
+		k = (dst->y + y) % ds->q;
+		src = ds->src + ds->src_bpl * (8 * ((dst->y + y) / ds->q));
+
+		lo = ds->lo[k];
+		hi = ds->hi[k];
+
+		i = dst->x / ds->q;
+		j = dst->x % ds->q;
+
+		for (x = 0; x < dst->w; x++) {
+			p = src + ds->src_bpl * lo + i;
+
+			v = 0;
+
+			for (r = lo; r <= hi; r++) {
+				v += ds->wt[k][r] * ds->sum[j][*p];
+				p += ds->src_bpl;
+			}
+
+			*(buf++) = ds->pal[v] >> 8;
+			*(buf++) = ds->pal[v] & 0xff;
+
+			j += 1;
+
+			if (j >= ds->q) {
+				i += 1;
+				j = 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,111 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/video/downscale.h                                *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#ifndef PCE_VIDEO_DOWNSCALE_H
+#define PCE_VIDEO_DOWNSCALE_H 1
+
+
+#include <stdint.h>
+
+#include <drivers/video/terminal.h>
+
+
+/*!***************************************************************************
+ * @short A 1bpp to RGB565 area averaging downscaler
+ *
+ * Every 8 source pixels are scaled to q destination pixels, in both
+ * directions. A destination pixel is the average of the source area it
+ * covers, blended between the background and the foreground color.
+ *
+ * The scaler keeps its own copy of the source frame, so that only the
+ * destination area that is affected by changed source lines has to be
+ * converted.
+ *****************************************************************************/
+typedef struct {
+	/* destination pixels per 8 source pixels */
+	unsigned      q;
+
+	unsigned      src_w;
+	unsigned      src_h;
+	unsigned long src_bpl;
+	unsigned char *src;
+
+	unsigned      dst_w;
+	unsigned      dst_h;
+
+	/* area of source pixel i in destination pixel j, in 1/q pixels */
+	unsigned char wt[8][8];
+
+	/* the source pixels with a non-zero weight in destination pixel j */
+	unsigned char lo[8];
+	unsigned char hi[8];
+
+	/* weighted bit count of a source byte in destination pixel j */
+	unsigned char sum[8][256];
+
+	/* RGB565 color for a coverage of 0 to 64 */
+	uint16_t      pal[65];
+
+	unsigned char col[2][3];
+} downscale_t;
+
+
+/*!***************************************************************************
+ * @short Initialize a downscaler
+ * @param w The source width
+ * @param h The source height
+ * @param q The number of destination pixels per 8 source pixels (1 - 8)
+ *****************************************************************************/
+int dsc_init (downscale_t *ds, unsigned w, unsigned h, unsigned q);
+
+/*!***************************************************************************
+ * @short Free the resources used by a downscaler
+ *****************************************************************************/
+void dsc_free (downscale_t *ds);
+
+/*!***************************************************************************
+ * @short Set the background and the foreground color
+ * @return Non-zero if the colors have changed
+ *
+ * If the colors change, the whole destination has to be converted again.
+ *****************************************************************************/
+int dsc_set_colors (downscale_t *ds, const unsigned char *bg, const unsigned char *fg);
+
+/*!***************************************************************************
+ * @short Copy source lines in TRM_FMT_MONO format
+ *****************************************************************************/
+void dsc_set_lines (downscale_t *ds, const unsigned char *buf, unsigned long bpl, unsigned y, unsigned cnt);
+
+/*!***************************************************************************
+ * @short Get the destination rectangle that a source rectangle affects
+ *****************************************************************************/
+void dsc_get_rect (const downscale_t *ds, trm_rect_t *dst, const trm_rect_t *src);
+
+/*!***************************************************************************
+ * @short Convert a destination rectangle
+ *
+ * The result is stored in buf as dst->w * dst->h RGB565 pixels, high byte
+ * first.
+ *****************************************************************************/
+void dsc_convert (const downscale_t *ds, unsigned char *buf, const trm_rect_t *dst);
+
+
+#endif
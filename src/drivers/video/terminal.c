@@ -62,6 +62,12 @@ void trm_init (terminal_t *trm, void *ext)
 	trm->w = 0;
 	trm->h = 0;
 
+	trm->fmt = TRM_FMT_RGB888;
+	trm->bpl = 0;
+
+	memset (trm->mono[0], 0x00, 3);
+	memset (trm->mono[1], 0xff, 3);
+
 	trm->buf_cnt = 0;
 	trm->buf = NULL;
 
@@ -88,6 +94,8 @@ void trm_init (terminal_t *trm, void *ext)
 	trm->update_w = 0;
 	trm->update_h = 0;
 
+	trm->rect_cnt = 0;
+
 	trm->pict_index = 0;
 }
 
@@ -170,7 +178,9 @@ int trm_screenshot (terminal_t *trm, const char *fname)
 {
 	FILE          *fp;
 	char          str[256];
+	unsigned      y;
 	unsigned long cnt;
+	unsigned char *rgb;
 
 	if ((fname == NULL) || (fname[0] == 0)) {
 		sprintf (str, "pce%04u.ppm", trm->pict_index);
@@ -184,15 +194,28 @@ int trm_screenshot (terminal_t *trm, const char *fname)
 		return (1);
 	}
 
-	cnt = 3 * (unsigned long) trm->w * (unsigned long) trm->h;
+	cnt = 3 * (unsigned long) trm->w;
 
-	fprintf (fp, "P6\n%u %u\n%u\x0a", trm->w, trm->h, 255);
+	rgb = malloc (cnt);
 
-	if (fwrite (trm->buf, 1, cnt, fp) != cnt) {
+	if (rgb == NULL) {
 		fclose (fp);
 		return (1);
 	}
 
+	fprintf (fp, "P6\n%u %u\n%u\x0a", trm->w, trm->h, 255);
+
+	for (y = 0; y < trm->h; y++) {
+		trm_get_rgb (trm, rgb, 0, y, trm->w);
+
+		if (fwrite (rgb, 1, cnt, fp) != cnt) {
+			free (rgb);
+			fclose (fp);
+			return (1);
+		}
+	}
+
+	free (rgb);
 	fclose (fp);
 
 	return (0);
@@ -228,6 +251,166 @@ void trm_set_mouse_scale (terminal_t *trm, int mul_x, int div_x, int mul_y, int
 	trm->mouse_scale_y[2] = 0;
 }
 
+/* check if two rectangles overlap or touch */
+static
+int trm_rect_touch (const trm_rect_t *a, const trm_rect_t *b)
+{
+	if ((a->x > (b->x + b->w)) || (b->x > (a->x + a->w))) {
+		return (0);
+	}
+
+	if ((a->y > (b->y + b->h)) || (b->y > (a->y + a->h))) {
+		return (0);
+	}
+
+	return (1);
+}
+
+void trm_rect_union (trm_rect_t *dst, const trm_rect_t *src)
+{
+	unsigned x2, y2;
+
+	x2 = dst->x + dst->w;
+	y2 = dst->y + dst->h;
+
+	if ((src->x + src->w) > x2) {
+		x2 = src->x + src->w;
+	}
+
+	if ((src->y + src->h) > y2) {
+		y2 = src->y + src->h;
+	}
+
+	if (src->x < dst->x) {
+		dst->x = src->x;
+	}
+
+	if (src->y < dst->y) {
+		dst->y = src->y;
+	}
+
+	dst->w = x2 - dst->x;
+	dst->h = y2 - dst->y;
+}
+
+static
+unsigned long trm_rect_area (const trm_rect_t *r)
+{
+	return ((unsigned long) r->w * r->h);
+}
+
+/* mark the whole terminal buffer for the next update */
+static
+void trm_update_all (terminal_t *trm)
+{
+	trm->update_x = 0;
+	trm->update_y = 0;
+	trm->update_w = trm->w;
+	trm->update_h = trm->h;
+
+	trm->rect[0].x = 0;
+	trm->rect[0].y = 0;
+	trm->rect[0].w = trm->w;
+	trm->rect[0].h = trm->h;
+
+	trm->rect_cnt = 1;
+}
+
+/*
+ * Add a changed area to the update rectangle and to the list of disjoint
+ * rectangles. Rectangles that touch are merged. If the list is full, the
+ * rectangle is merged with the one that grows the least.
+ */
+static
+void trm_add_update (terminal_t *trm, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+	unsigned      i, best;
+	unsigned long cost, best_cost;
+	trm_rect_t    r, t;
+
+	r.x = x;
+	r.y = y;
+	r.w = w;
+	r.h = h;
+
+	if ((trm->update_w == 0) || (trm->update_h == 0)) {
+		trm->update_x = x;
+		trm->update_y = y;
+		trm->update_w = w;
+		trm->update_h = h;
+	}
+	else {
+		t.x = trm->update_x;
+		t.y = trm->update_y;
+		t.w = trm->update_w;
+		t.h = trm->update_h;
+
+		trm_rect_union (&t, &r);
+
+		trm->update_x = t.x;
+		trm->update_y = t.y;
+		trm->update_w = t.w;
+		trm->update_h = t.h;
+	}
+
+	i = 0;
+	while (i < trm->rect_cnt) {
+		if (trm_rect_touch (&trm->rect[i], &r)) {
+			trm_rect_union (&r, &trm->rect[i]);
+
+			trm->rect_cnt -= 1;
+			trm->rect[i] = trm->rect[trm->rect_cnt];
+
+			/* r has grown, check all rectangles again */
+			i = 0;
+		}
+		else {
+			i += 1;
+		}
+
+		if ((i >= trm->rect_cnt) && (trm->rect_cnt >= TRM_RECT_MAX)) {
+			best = 0;
+			best_cost = 0;
+
+			for (i = 0; i < trm->rect_cnt; i++) {
+				t = trm->rect[i];
+				trm_rect_union (&t, &r);
+
+				cost = trm_rect_area (&t) - trm_rect_area (&trm->rect[i]);
+
+				if ((i == 0) || (cost < best_cost)) {
+					best = i;
+					best_cost = cost;
+				}
+			}
+
+			trm_rect_union (&r, &trm->rect[best]);
+
+			trm->rect_cnt -= 1;
+			trm->rect[best] = trm->rect[trm->rect_cnt];
+
+			i = 0;
+		}
+	}
+
+	trm->rect[trm->rect_cnt] = r;
+	trm->rect_cnt += 1;
+}
+
+static
+unsigned long trm_get_bpl (unsigned fmt, unsigned w)
+{
+	switch (fmt) {
+	case TRM_FMT_RGB565:
+		return (2UL * w);
+
+	case TRM_FMT_MONO:
+		return ((w + 7UL) / 8);
+	}
+
+	return (3UL * w);
+}
+
 void trm_set_size (terminal_t *trm, unsigned w, unsigned h)
 {
 	unsigned long cnt;
@@ -240,15 +423,16 @@ void trm_set_size (terminal_t *trm, unsigned w, unsigned h)
 
 		trm->w = 0;
 		trm->h = 0;
+		trm->bpl = 0;
 
 		return;
 	}
 
-	if ((trm->w == w) && (trm->h == h)) {
+	if ((trm->w == w) && (trm->h == h) && (trm->buf != NULL)) {
 		return;
 	}
 
-	cnt = 3 * (unsigned long) w * (unsigned long) h;
+	cnt = trm_get_bpl (trm->fmt, w) * h;
 
 	if (trm->buf_cnt != cnt) {
 		unsigned char *tmp;
@@ -264,11 +448,45 @@ void trm_set_size (terminal_t *trm, unsigned w, unsigned h)
 
 	trm->w = w;
 	trm->h = h;
+	trm->bpl = trm_get_bpl (trm->fmt, w);
 
-	trm->update_x = 0;
-	trm->update_y = 0;
-	trm->update_w = w;
-	trm->update_h = h;
+	trm_update_all (trm);
+}
+
+void trm_set_format (terminal_t *trm, unsigned fmt)
+{
+	if (trm->fmt == fmt) {
+		return;
+	}
+
+	trm->fmt = fmt;
+
+	/* reallocate the buffer in the new format */
+	free (trm->buf);
+
+	trm->buf_cnt = 0;
+	trm->buf = NULL;
+
+	if ((trm->w > 0) && (trm->h > 0)) {
+		trm_set_size (trm, trm->w, trm->h);
+	}
+}
+
+unsigned trm_get_format (const terminal_t *trm)
+{
+	return (trm->fmt);
+}
+
+void trm_set_mono (terminal_t *trm, const unsigned char *bg, const unsigned char *fg)
+{
+	if ((memcmp (trm->mono[0], bg, 3) == 0) && (memcmp (trm->mono[1], fg, 3) == 0)) {
+		return;
+	}
+
+	memcpy (trm->mono[0], bg, 3);
+	memcpy (trm->mono[1], fg, 3);
+
+	trm_update_all (trm);
 }
 
 void trm_set_min_size (terminal_t *trm, unsigned w, unsigned h)
@@ -281,10 +499,7 @@ void trm_set_scale (terminal_t *trm, unsigned v)
 {
 	trm->scale = (v < 1) ? 1 : v;
 
-	trm->update_x = 0;
-	trm->update_y = 0;
-	trm->update_w = trm->w;
-	trm->update_h = trm->h;
+	trm_update_all (trm);
 }
 
 void trm_set_aspect_ratio (terminal_t *trm, unsigned x, unsigned y)
@@ -295,73 +510,66 @@ void trm_set_aspect_ratio (terminal_t *trm, unsigned x, unsigned y)
 
 void trm_set_pixel (terminal_t *trm, unsigned x, unsigned y, const unsigned char *col)
 {
+	unsigned      v;
 	unsigned char *buf;
 
-	buf = trm->buf + 3 * (trm->w * y + x);
+	buf = trm->buf + trm->bpl * y;
 
-	buf[0] = col[0];
-	buf[1] = col[1];
-	buf[2] = col[2];
+	switch (trm->fmt) {
+	case TRM_FMT_RGB565:
+		v = ((col[0] & 0xf8) << 8) | ((col[1] & 0xfc) << 3) | (col[2] >> 3);
+		buf[2 * x + 0] = (v >> 8) & 0xff;
+		buf[2 * x + 1] = v & 0xff;
+		break;
 
-	if (trm->update_w == 0) {
-		trm->update_x = x;
-		trm->update_w = 1;
-	}
-	else {
-		if (x < trm->update_x) {
-			trm->update_w += trm->update_x - x;
-			trm->update_x = x;
+	case TRM_FMT_MONO:
+		if (memcmp (col, trm->mono[1], 3) == 0) {
+			buf[x >> 3] |= 0x80 >> (x & 7);
 		}
-
-		if (x >= (trm->update_x + trm->update_w)) {
-			trm->update_w = x - trm->update_x + 1;
+		else {
+			buf[x >> 3] &= ~(0x80 >> (x & 7));
 		}
-	}
+		break;
 
-	if (trm->update_h == 0) {
-		trm->update_y = y;
-		trm->update_h = 1;
+	default:
+		buf[3 * x + 0] = col[0];
+		buf[3 * x + 1] = col[1];
+		buf[3 * x + 2] = col[2];
+		break;
 	}
-	else {
-		if (y < trm->update_y) {
-			trm->update_h += trm->update_y - y;
-			trm->update_y = y;
-		}
 
-		if (y >= (trm->update_y + trm->update_h)) {
-			trm->update_h = y - trm->update_y + 1;
-		}
-	}
+	trm_add_update (trm, x, y, 1, 1);
 }
 
 void trm_set_lines (terminal_t *trm, const void *buf, unsigned y, unsigned cnt)
 {
-	unsigned long       w3, tmp;
-	const unsigned char *src;
-	unsigned char       *dst;
+	unsigned            i, x0, x1;
+	unsigned long       bpl, tmp, j, b0, b1;
+	const unsigned char *src, *s1;
+	unsigned char       *dst, *d1;
 
-	w3 = 3UL * trm->w;
+	bpl = trm->bpl;
 
 	src = buf;
-	dst = trm->buf + w3 * y;
+	dst = trm->buf + bpl * y;
 
 	while (cnt > 0) {
-		if (memcmp (dst, src, w3) != 0) {
+		if (memcmp (dst, src, bpl) != 0) {
 			break;
 		}
 
-		src += w3;
-		dst += w3;
+		src += bpl;
+		dst += bpl;
 		y += 1;
 		cnt -= 1;
 	}
 
-	tmp = cnt * w3;
+	tmp = cnt * bpl;
 
 	while (cnt > 0) {
-		tmp -= w3;
+		tmp -= bpl;
 
-		if (memcmp (dst + tmp, src + tmp, w3) != 0) {
+		if (memcmp (dst + tmp, src + tmp, bpl) != 0) {
 			break;
 		}
 
@@ -372,24 +580,100 @@ void trm_set_lines (terminal_t *trm, const void *buf, unsigned y, unsigned cnt)
 		return;
 	}
 
-	memcpy (dst, src, w3 * cnt);
+	/* find the first and last changed byte over all lines */
+	b0 = bpl;
+	b1 = 0;
 
-	trm->update_x = 0;
-	trm->update_w = trm->w;
+	for (i = 0; i < cnt; i++) {
+		s1 = src + bpl * i;
+		d1 = dst + bpl * i;
 
-	if (trm->update_h == 0) {
-		trm->update_y = y;
-		trm->update_h = cnt;
+		j = 0;
+		while ((j < b0) && (s1[j] == d1[j])) {
+			j += 1;
+		}
+
+		b0 = j;
+
+		j = bpl;
+		while ((j > (b1 + 1)) && (s1[j - 1] == d1[j - 1])) {
+			j -= 1;
+		}
+
+		if (j > (b1 + 1)) {
+			b1 = j - 1;
+		}
 	}
-	else {
-		if (y < trm->update_y) {
-			trm->update_h += trm->update_y - y;
-			trm->update_y = y;
+
+	if (b1 < b0) {
+		b1 = b0;
+	}
+
+	memcpy (dst, src, bpl * cnt);
+
+	switch (trm->fmt) {
+	case TRM_FMT_RGB565:
+		x0 = b0 / 2;
+		x1 = b1 / 2;
+		break;
+
+	case TRM_FMT_MONO:
+		x0 = 8 * b0;
+		x1 = 8 * b1 + 7;
+		break;
+
+	default:
+		x0 = b0 / 3;
+		x1 = b1 / 3;
+		break;
+	}
+
+	if (x1 >= trm->w) {
+		x1 = trm->w - 1;
+	}
+
+	trm_add_update (trm, x0, y, x1 - x0 + 1, cnt);
+}
+
+void trm_get_rgb (const terminal_t *trm, unsigned char *rgb, unsigned x, unsigned y, unsigned cnt)
+{
+	unsigned            i, v;
+	const unsigned char *src, *col;
+
+	src = trm->buf + trm->bpl * y;
+
+	switch (trm->fmt) {
+	case TRM_FMT_RGB565:
+		src += 2 * x;
+
+		for (i = 0; i < cnt; i++) {
+			v = (src[0] << 8) | src[1];
+
+			rgb[0] = ((v >> 8) & 0xf8) | ((v >> 13) & 0x07);
+			rgb[1] = ((v >> 3) & 0xfc) | ((v >> 9) & 0x03);
+			rgb[2] = ((v << 3) & 0xf8) | ((v >> 2) & 0x07);
+
+			src += 2;
+			rgb += 3;
 		}
+		break;
 
-		if ((y + cnt) > (trm->update_y + trm->update_h)) {
-			trm->update_h = (y + cnt) - trm->update_y;
+	case TRM_FMT_MONO:
+		for (i = 0; i < cnt; i++) {
+			v = x + i;
+			col = trm->mono[(src[v >> 3] >> (~v & 7)) & 1];
+
+			rgb[0] = col[0];
+			rgb[1] = col[1];
+			rgb[2] = col[2];
+
+			rgb += 3;
 		}
+		break;
+
+	default:
+		memcpy (rgb, src + 3 * x, 3UL * cnt);
+		break;
 	}
 }
 
@@ -407,6 +691,8 @@ void trm_update (terminal_t *trm)
 	trm->update_y = 0;
 	trm->update_w = 0;
 	trm->update_h = 0;
+
+	trm->rect_cnt = 0;
 }
 
 void trm_check (terminal_t *trm)
@@ -28,6 +28,31 @@
 
 #include <drivers/video/keys.h>
 
+
+/* 3 bytes per pixel, R G B */
+#define TRM_FMT_RGB888 0
+
+/* 2 bytes per pixel, RRRRRGGG GGGBBBBB, high byte first */
+#define TRM_FMT_RGB565 1
+
+/* 1 bit per pixel, most significant bit first, set bits are foreground */
+#define TRM_FMT_MONO   2
+
+
+#define TRM_RECT_MAX 8
+
+
+/*!***************************************************************************
+ * @short A rectangle in the terminal buffer
+ *****************************************************************************/
+typedef struct {
+	unsigned x;
+	unsigned y;
+	unsigned w;
+	unsigned h;
+} trm_rect_t;
+
+
 /*!***************************************************************************
  * @short The terminal structure
  *****************************************************************************/
@@ -64,6 +89,13 @@ typedef struct {
 	unsigned      w;
 	unsigned      h;
 
+	/* terminal buffer pixel format and bytes per line */
+	unsigned      fmt;
+	unsigned long bpl;
+
+	/* background and foreground color for TRM_FMT_MONO */
+	unsigned char mono[2][3];
+
 	unsigned long buf_cnt;
 	unsigned char *buf;
 
@@ -88,6 +120,10 @@ typedef struct {
 	unsigned      update_w;
 	unsigned      update_h;
 
+	/* disjoint rectangles inside of the update rectangle */
+	unsigned      rect_cnt;
+	trm_rect_t    rect[TRM_RECT_MAX];
+
 	/* picture index for screenshots */
 	unsigned      pict_index;
 } terminal_t;
@@ -99,6 +135,11 @@ typedef struct {
 // terminal_t *sdl2_new (ini_sct_t *ini);
 
 
+/*!***************************************************************************
+ * @short Extend a rectangle to include another rectangle
+ *****************************************************************************/
+void trm_rect_union (trm_rect_t *dst, const trm_rect_t *src);
+
 /*!***************************************************************************
  * @short Initialize a terminal structure
  *****************************************************************************/
@@ -177,6 +218,29 @@ void trm_set_mouse_scale (terminal_t *trm, int mul_x, int div_x, int mul_y, int
  *****************************************************************************/
 void trm_set_size (terminal_t *trm, unsigned w, unsigned h);
 
+/*!***************************************************************************
+ * @short Set the terminal buffer pixel format
+ * @param fmt One of TRM_FMT_RGB888, TRM_FMT_RGB565 or TRM_FMT_MONO
+ *
+ * This is called by the terminal driver to select the format it can use
+ * most efficiently. The buffer contents are lost.
+ *****************************************************************************/
+void trm_set_format (terminal_t *trm, unsigned fmt);
+
+/*!***************************************************************************
+ * @short Get the terminal buffer pixel format
+ *
+ * Callers of trm_set_lines() must provide the lines in this format.
+ *****************************************************************************/
+unsigned trm_get_format (const terminal_t *trm);
+
+/*!***************************************************************************
+ * @short Set the colors used for TRM_FMT_MONO
+ * @param bg The background color for clear bits, three RGB values
+ * @param fg The foreground color for set bits, three RGB values
+ *****************************************************************************/
+void trm_set_mono (terminal_t *trm, const unsigned char *bg, const unsigned char *fg);
+
 /*!***************************************************************************
  * @short Set the minimum terminal window size
  *****************************************************************************/
@@ -200,7 +264,7 @@ void trm_set_pixel (terminal_t *trm, unsigned x, unsigned y, const unsigned char
 
 /*!***************************************************************************
  * @short Set lines in the terminal buffer
- * @param buf The RGB source buffer, 3 bytes per pixel
+ * @param buf The source buffer in the format returned by trm_get_format()
  * @param y   The first line in the terminal buffer
  * @param cnt The number of lines
  *
@@ -208,8 +272,22 @@ void trm_set_pixel (terminal_t *trm, unsigned x, unsigned y, const unsigned char
  *****************************************************************************/
 void trm_set_lines (terminal_t *trm, const void *buf, unsigned y, unsigned cnt);
 
+/*!***************************************************************************
+ * @short Convert pixels in the terminal buffer to RGB
+ * @param rgb The destination buffer, 3 bytes per pixel
+ * @param x   The first pixel
+ * @param y   The line
+ * @param cnt The number of pixels
+ *****************************************************************************/
+void trm_get_rgb (const terminal_t *trm, unsigned char *rgb, unsigned x, unsigned y, unsigned cnt);
+
 /*!***************************************************************************
  * @short Update the screen from the terminal buffer
+ *
+ * The driver's update function finds the changed area in update_x,
+ * update_y, update_w and update_h. Drivers that can do partial updates
+ * can instead use the rect_cnt disjoint rectangles in rect[], which
+ * cover all changed pixels.
  *****************************************************************************/
 void trm_update (terminal_t *trm);
 
@@ -252,8 +330,8 @@ void trm_set_mouse (terminal_t *trm, int dx, int dy, unsigned but);
 void trm_get_scale (terminal_t *trm, unsigned w, unsigned h, unsigned *fx, unsigned *fy);
 
 /*!***************************************************************************
- * @short Scale the terminal buffer
- * @param src The source buffer
+ * @short Scale an RGB buffer
+ * @param src The source buffer, 3 bytes per pixel
  * @param w   The source buffer width
  * @param h   The source buffer height
  * @param fx  The scale factor in x direction
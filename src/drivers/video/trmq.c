@@ -0,0 +1,270 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/video/trmq.c                                     *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <drivers/video/terminal.h>
+#include <drivers/video/trmq.h>
+
+
+/*
+ * The indices are only ever written by one side. The release store
+ * publishes everything written before it, the acquire load on the other
+ * side makes it visible.
+ */
+#define trmq_load(p) __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define trmq_store(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+
+
+void trmq_init (trmq_t *q)
+{
+	q->head = 0;
+	q->tail = 0;
+
+	q->w = 0;
+	q->h = 0;
+	q->fmt = 0;
+	q->bpl = 0;
+
+	q->lines[0] = NULL;
+	q->lines[1] = NULL;
+
+	q->put[0] = 0;
+	q->put[1] = 0;
+	q->done[0] = 0;
+	q->done[1] = 0;
+
+	q->cur = 0;
+
+	q->pend.x = 0;
+	q->pend.y = 0;
+	q->pend.w = 0;
+	q->pend.h = 0;
+
+	q->deferred = 0;
+}
+
+void trmq_free (trmq_t *q)
+{
+	free (q->lines[0]);
+
+	q->lines[0] = NULL;
+	q->lines[1] = NULL;
+}
+
+static
+int trmq_busy (trmq_t *q, unsigned buf)
+{
+	return (q->put[buf] != trmq_load (&q->done[buf]));
+}
+
+int trmq_idle (trmq_t *q)
+{
+	if (trmq_busy (q, 0) || trmq_busy (q, 1)) {
+		return (0);
+	}
+
+	return (q->head == trmq_load (&q->tail));
+}
+
+static
+int trmq_resize (trmq_t *q, const terminal_t *trm)
+{
+	unsigned char *tmp;
+
+	tmp = realloc (q->lines[0], 2 * trm->bpl * trm->h);
+
+	if (tmp == NULL) {
+		return (1);
+	}
+
+	q->lines[0] = tmp;
+	q->lines[1] = tmp + trm->bpl * trm->h;
+
+	q->w = trm->w;
+	q->h = trm->h;
+	q->fmt = trm->fmt;
+	q->bpl = trm->bpl;
+
+	return (0);
+}
+
+static
+void trmq_defer (trmq_t *q, const trm_rect_t *rect, unsigned cnt)
+{
+	unsigned i;
+
+	for (i = 0; i < cnt; i++) {
+		if ((q->pend.w == 0) || (q->pend.h == 0)) {
+			q->pend = rect[i];
+		}
+		else {
+			trm_rect_union (&q->pend, &rect[i]);
+		}
+	}
+
+	q->deferred += 1;
+}
+
+static
+unsigned trmq_put_rect (trmq_t *q, const terminal_t *trm, trm_rect_t *rect, unsigned n)
+{
+	unsigned     i, buf, head;
+	unsigned     x2, y2;
+	trm_rect_t   *r;
+	trmq_msg_t   *msg;
+
+	if ((q->pend.w > 0) && (q->pend.h > 0)) {
+		rect[n++] = q->pend;
+	}
+
+	if ((n == 0) || (trm->buf == NULL)) {
+		return (0);
+	}
+
+	if ((q->lines[0] == NULL) || (q->w != trm->w) || (q->h != trm->h) || (q->fmt != trm->fmt) || (q->bpl != trm->bpl)) {
+		if ((trmq_idle (q) == 0) || trmq_resize (q, trm)) {
+			trmq_defer (q, rect, n);
+			return (0);
+		}
+
+		rect[0].x = 0;
+		rect[0].y = 0;
+		rect[0].w = q->w;
+		rect[0].h = q->h;
+
+		n = 1;
+	}
+
+	buf = q->cur;
+
+	if (trmq_busy (q, buf)) {
+		buf ^= 1;
+
+		if (trmq_busy (q, buf)) {
+			trmq_defer (q, rect, n);
+			return (0);
+		}
+	}
+
+	head = q->head;
+
+	if ((TRMQ_SIZE - (head - trmq_load (&q->tail))) < n) {
+		trmq_defer (q, rect, n);
+		return (0);
+	}
+
+	for (i = 0; i < n; i++) {
+		r = &rect[i];
+
+		x2 = r->x + r->w;
+		y2 = r->y + r->h;
+
+		if (x2 > q->w) {
+			x2 = q->w;
+		}
+
+		if (y2 > q->h) {
+			y2 = q->h;
+		}
+
+		if ((r->x >= x2) || (r->y >= y2)) {
+			continue;
+		}
+
+		memcpy (q->lines[buf] + q->bpl * r->y, trm->buf + q->bpl * r->y, q->bpl * (y2 - r->y));
+
+		msg = &q->msg[head & (TRMQ_SIZE - 1)];
+
+		msg->x = r->x;
+		msg->y = r->y;
+		msg->w = x2 - r->x;
+		msg->h = y2 - r->y;
+		msg->frame_w = q->w;
+		msg->frame_h = q->h;
+		msg->fmt = q->fmt;
+		msg->bpl = q->bpl;
+		msg->data = q->lines[buf] + q->bpl * r->y;
+		memcpy (msg->mono, trm->mono, sizeof (msg->mono));
+		msg->buf = buf;
+
+		q->put[buf] += 1;
+
+		head += 1;
+	}
+
+	n = head - q->head;
+
+	trmq_store (&q->head, head);
+
+	q->cur = buf ^ 1;
+
+	q->pend.w = 0;
+	q->pend.h = 0;
+
+	return (n);
+}
+
+unsigned trmq_put (trmq_t *q, const terminal_t *trm)
+{
+	unsigned   i, n;
+	trm_rect_t rect[TRM_RECT_MAX + 1];
+
+	n = 0;
+
+	for (i = 0; i < trm->rect_cnt; i++) {
+		if ((trm->rect[i].w > 0) && (trm->rect[i].h > 0)) {
+			rect[n++] = trm->rect[i];
+		}
+	}
+
+	return (trmq_put_rect (q, trm, rect, n));
+}
+
+unsigned trmq_put_pend (trmq_t *q, const terminal_t *trm)
+{
+	trm_rect_t rect[1];
+
+	return (trmq_put_rect (q, trm, rect, 0));
+}
+
+int trmq_get (trmq_t *q, trmq_msg_t *msg)
+{
+	unsigned tail;
+
+	tail = q->tail;
+
+	if (tail == trmq_load (&q->head)) {
+		return (1);
+	}
+
+	*msg = q->msg[tail & (TRMQ_SIZE - 1)];
+
+	trmq_store (&q->tail, tail + 1);
+
+	return (0);
+}
+
+void trmq_done (trmq_t *q, const trmq_msg_t *msg)
+{
+	trmq_store (&q->done[msg->buf], q->done[msg->buf] + 1);
+}
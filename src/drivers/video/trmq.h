@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * pce                                                                       *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * File name:   src/drivers/video/trmq.h                                     *
+ * Created:     2026-10-16                                                   *
+ *****************************************************************************/
+
+/*****************************************************************************
+ * This program is free software. You can redistribute it and / or modify it *
+ * under the terms of the GNU General Public License version 2 as  published *
+ * by the Free Software Foundation.                                          *
+ *                                                                           *
+ * This program is distributed in the hope  that  it  will  be  useful,  but *
+ * WITHOUT  ANY   WARRANTY,   without   even   the   implied   warranty   of *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  General *
+ * Public License for more details.                                          *
+ *****************************************************************************/
+
+
+#ifndef PCE_VIDEO_TRMQ_H
+#define PCE_VIDEO_TRMQ_H 1
+
+
+#include <drivers/video/terminal.h>
+
+
+/* number of queue entries, must be a power of 2 */
+#define TRMQ_SIZE 32
+
+
+/*!***************************************************************************
+ * @short A changed terminal area, handed from the emulator to the display
+ *****************************************************************************/
+typedef struct {
+	/* the changed area */
+	unsigned            x;
+	unsigned            y;
+	unsigned            w;
+	unsigned            h;
+
+	/* the terminal buffer size */
+	unsigned            frame_w;
+	unsigned            frame_h;
+
+	/* pixel format and bytes per line of the line data */
+	unsigned            fmt;
+	unsigned long       bpl;
+
+	/* the first line of the area, at column 0 */
+	const unsigned char *data;
+
+	/* background and foreground color for TRM_FMT_MONO */
+	unsigned char       mono[2][3];
+
+	/* the line buffer that holds the data */
+	unsigned            buf;
+} trmq_msg_t;
+
+
+/*!***************************************************************************
+ * @short A single producer / single consumer terminal update queue
+ *
+ * The producer copies the changed lines of a terminal into one of two
+ * line buffers and queues the changed rectangles. The consumer draws them
+ * and releases them with trmq_done(). A line buffer is reused only after
+ * all rectangles that refer to it have been released, so the producer
+ * never waits for the consumer. If both line buffers are in use, the
+ * changed area is remembered and sent with the next update.
+ *
+ * Only the producer writes head, cur, pend and put[], only the consumer
+ * writes tail and done[].
+ *****************************************************************************/
+typedef struct {
+	unsigned            head;
+	unsigned            tail;
+
+	trmq_msg_t          msg[TRMQ_SIZE];
+
+	unsigned            w;
+	unsigned            h;
+	unsigned            fmt;
+	unsigned long       bpl;
+
+	unsigned char       *lines[2];
+
+	/* number of messages queued and released, per line buffer */
+	unsigned            put[2];
+	unsigned            done[2];
+
+	/* the line buffer used for the next update */
+	unsigned            cur;
+
+	/* changed area that could not be queued yet */
+	trm_rect_t          pend;
+
+	/* number of updates that had to be deferred */
+	unsigned long       deferred;
+} trmq_t;
+
+
+/*!***************************************************************************
+ * @short Initialize a terminal update queue
+ *****************************************************************************/
+void trmq_init (trmq_t *q);
+
+/*!***************************************************************************
+ * @short Free the resources used by a terminal update queue
+ *
+ * The consumer must not be running anymore.
+ *****************************************************************************/
+void trmq_free (trmq_t *q);
+
+/*!***************************************************************************
+ * @short Queue the changed rectangles of a terminal (producer)
+ * @return The number of queued rectangles
+ *
+ * This function is meant to be called from the terminal update function,
+ * before the terminal rectangle list is reset.
+ *****************************************************************************/
+unsigned trmq_put (trmq_t *q, const terminal_t *trm);
+
+/*!***************************************************************************
+ * @short Queue the changed area that was deferred earlier (producer)
+ * @return The number of queued rectangles
+ *
+ * This should be called periodically, otherwise a deferred area is only
+ * sent with the next terminal update.
+ *****************************************************************************/
+unsigned trmq_put_pend (trmq_t *q, const terminal_t *trm);
+
+/*!***************************************************************************
+ * @short Get the next changed rectangle (consumer)
+ * @return Zero if a rectangle was available, non-zero if the queue is empty
+ *
+ * The line data stays valid until the rectangle is released with
+ * trmq_done().
+ *****************************************************************************/
+int trmq_get (trmq_t *q, trmq_msg_t *msg);
+
+/*!***************************************************************************
+ * @short Release a rectangle returned by trmq_get() (consumer)
+ *****************************************************************************/
+void trmq_done (trmq_t *q, const trmq_msg_t *msg);
+
+/*!***************************************************************************
+ * @short Check if all queued rectangles have been released
+ *****************************************************************************/
+int trmq_idle (trmq_t *q);
+
+
+#endif
@@ -1,6 +1,11 @@
 #include <drivers/video/terminal.h>
 #include <drivers/video/null.h>
+#include <drivers/video/trmq.h>
+#include <drivers/video/downscale.h>
 #include <drivers/block/block.h>
+#include <drivers/block/blkflash.h>
+#include <drivers/block/blkftl.h>
+#include <drivers/block/flash.h>
 
 #include <devices/memory.h>
 
@@ -57,102 +62,210 @@ int map_partition (mem_blk_t *blk, unsigned long size, const char* part_name)
 }
 
 
-static void dsk_part_del (disk_t *dsk)
+// SPI flash erase block size
+#define ESP_FLASH_ERASE_SIZE 4096
+
+static int flash_part_read (flash_t *fl, void *buf, uint32_t ofs, uint32_t cnt)
 {
+	return (esp_partition_read (fl->ext, ofs, buf, cnt) != ESP_OK);
 }
 
-static int dsk_part_read (disk_t *dsk, void *buf, uint32_t i, uint32_t n)
+static int flash_part_write (flash_t *fl, const void *buf, uint32_t ofs, uint32_t cnt)
 {
-	esp_partition_t *part = (esp_partition_t *)dsk->ext;
-
-	if ((i + n) > dsk->blocks)
-		return 1;
-
-	if (esp_partition_read(part, 512 * i, buf, 512 * n) != ESP_OK)
-		return 1;
+	return (esp_partition_write (fl->ext, ofs, buf, cnt) != ESP_OK);
+}
 
-	return 0;
+static int flash_part_erase (flash_t *fl, uint32_t ofs, uint32_t cnt)
+{
+	return (esp_partition_erase_range (fl->ext, ofs, cnt) != ESP_OK);
 }
 
-static int dsk_part_write (disk_t *dsk, const void *buf, uint32_t i, uint32_t n)
+static void flash_part_del (flash_t *fl)
 {
-	esp_partition_t *part = (esp_partition_t *)dsk->ext;
-	const uint8_t *data = buf;
-	// unsigned erase_size = part->erase_size;
-	const unsigned erase_size = 4096;
+	free (fl);
+}
 
-	if (dsk->readonly) {
-		return (1);
+static flash_t *flash_part_open (const char *part_name)
+{
+	const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, part_name);
+	if (part == 0) {
+		pce_log (MSG_ERR, "*** couldn't find partition %s\n", part_name);
+		return NULL;
 	}
 
-	if ((i + n) > dsk->blocks) {
-		return (1);
+	flash_t *fl = malloc(sizeof(flash_t));
+	if (fl == NULL) {
+		return (NULL);
 	}
 
-	// uint8_t *secdat = malloc(erase_size);
-	uint8_t secdat[erase_size];
-	// if (secdat == NULL)
-	// 	return 1;
-
-	unsigned int lbaStart = i & (~7);
-	unsigned int lbaOff = i & 7;
-
-	if (esp_partition_read(part, lbaStart * 512, secdat, erase_size) != ESP_OK)
-		return 1;
+	flash_init (fl, (void *)part, part->size, ESP_FLASH_ERASE_SIZE);
+	fl->del = flash_part_del;
+	fl->read = flash_part_read;
+	fl->write = flash_part_write;
+	fl->erase = flash_part_erase;
 
-	if (esp_partition_erase_range(part, lbaStart * 512, erase_size) != ESP_OK)
-		return 1;
+	return fl;
+}
 
-	for (int i = 0; i < 512; i++)
-		secdat[lbaOff * 512 + i] = data[i];
+// Writes go through a write-back cache of whole erase blocks, so that
+// all sectors written to the same block cost one erase and one write.
+disk_t *flash_disk_init(const char *part_name, unsigned drive_id, unsigned cache_cnt)
+{
+	flash_t *fl = flash_part_open(part_name);
+	if (fl == NULL) {
+		return (NULL);
+	}
 
-	if (esp_partition_write(part, lbaStart * 512, secdat, erase_size) != ESP_OK)
-		return 1;
+	disk_t *dsk = dsk_flash_new (fl, cache_cnt);
+	if (dsk == NULL) {
+		flash_del (fl);
+		return (NULL);
+	}
 
-	// free(secdat);
+	dsk_set_readonly (dsk, 0);
+	dsk_set_fname (dsk, part_name);
 
-	return (0);
+	dsk_set_drive (dsk, drive_id);
+	return dsk;
 }
 
-disk_t *flash_disk_init(const char *part_name, unsigned drive_id)
+// Sectors are appended to a log instead of being written in place, see
+// blkftl.h. The partition must already hold such a disk.
+disk_t *ftl_disk_init(const char *part_name, unsigned drive_id)
 {
-	const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, part_name);
-	if (part == 0) {
-		pce_log (MSG_ERR, "*** couldn't find partition %s\n", part_name);
-		return NULL;
+	flash_t *fl = flash_part_open(part_name);
+	if (fl == NULL) {
+		return (NULL);
 	}
 
-	disk_t *dsk = malloc(sizeof(disk_t));
+	disk_t *dsk = dsk_ftl_new (fl, 0);
 	if (dsk == NULL) {
+		pce_log (MSG_ERR, "*** partition %s is not a log-structured disk\n", part_name);
+		flash_del (fl);
 		return (NULL);
 	}
 
-	dsk_init (dsk, (void *)part, part->size / 512, 0, 0, 0);
-	dsk_set_type (dsk, PCE_DISK_RAW);
-	dsk_set_readonly (dsk, 0);
-	dsk_set_fname (dsk, part->label);
-	dsk->del = dsk_part_del;
-	dsk->read = dsk_part_read;
-	dsk->write = dsk_part_write;
+	dsk_set_fname (dsk, part_name);
 
 	dsk_set_drive (dsk, drive_id);
 	return dsk;
 }
 
 
+// number of lines converted to RGB565 and sent at once
+#define ESP_TRM_LINES 8
+#define ESP_TRM_MAX_W 512
+
+// panel pixels per 8 Mac pixels, 512x342 becomes 320x214
+#define ESP_TRM_SCALE 5
+
+// The emulator only queues the changed rectangles, the display task on
+// the second core converts and sends them.
+static trmq_t esp_trm_queue;
+static TaskHandle_t esp_disp_task = NULL;
+
+// The terminal buffer is kept as packed 1bpp (TRM_FMT_MONO), which is
+// 1/24 of the RGB888 size. The display task keeps its own copy and
+// area-averages it down to the panel size, in the panel's native RGB565.
+static downscale_t esp_trm_dsc;
+
+static void esp_trm_send_rect (const trm_rect_t *d)
+{
+	static uint8_t lines[2 * ESP_TRM_MAX_W * ESP_TRM_LINES];
+	trm_rect_t r;
+	uint8_t cmd;
+
+	if ((d->w == 0) || (d->h == 0) || (d->w > ESP_TRM_MAX_W)) {
+		return;
+	}
+
+	setColRange(d->x, d->x + d->w - 1);
+	setRowRange(d->y, d->y + d->h - 1);
+
+	cmd = 0x2c;  // CMD: write from start
+
+	r = *d;
+
+	while (r.y < (d->y + d->h)) {
+		r.h = d->y + d->h - r.y;
+
+		if (r.h > ESP_TRM_LINES) {
+			r.h = ESP_TRM_LINES;
+		}
+
+		dsc_convert (&esp_trm_dsc, lines, &r);
+
+		mipiDsiSendLong(0x39, cmd, lines, 2 * r.w * r.h);
+
+		cmd = 0x3c;  // CMD: continue write
+
+		r.y += r.h;
+	}
+}
+
+static void esp_trm_draw (const trmq_msg_t *msg)
+{
+	trm_rect_t src, dst;
+	int        all;
+
+	if (msg->fmt != TRM_FMT_MONO) {
+		return;
+	}
+
+	all = 0;
+
+	if ((esp_trm_dsc.src == NULL) || (esp_trm_dsc.src_w != msg->frame_w) || (esp_trm_dsc.src_h != msg->frame_h)) {
+		dsc_free (&esp_trm_dsc);
+
+		if (dsc_init (&esp_trm_dsc, msg->frame_w, msg->frame_h, ESP_TRM_SCALE)) {
+			return;
+		}
+
+		all = 1;
+	}
+
+	dsc_set_lines (&esp_trm_dsc, msg->data, msg->bpl, msg->y, msg->h);
+
+	if (dsc_set_colors (&esp_trm_dsc, msg->mono[0], msg->mono[1])) {
+		all = 1;
+	}
+
+	if (all) {
+		src.x = 0;
+		src.y = 0;
+		src.w = msg->frame_w;
+		src.h = msg->frame_h;
+	}
+	else {
+		src.x = msg->x;
+		src.y = msg->y;
+		src.w = msg->w;
+		src.h = msg->h;
+	}
+
+	dsc_get_rect (&esp_trm_dsc, &dst, &src);
+
+	esp_trm_send_rect (&dst);
+}
+
 static void esp_trm_update (terminal_t *trm)
 {
-	printf(
-		"esp_trm_update(x %d, y %d, w %d, h %d)\n",
-		trm->update_x,
-		trm->update_y,
-		trm->update_w,
-		trm->update_h
-	);
-
-    setColRange(trm->update_x, trm->update_x + trm->update_w - 1);
-    setRowRange(trm->update_y, trm->update_y + trm->update_h - 1);
-    mipiDsiSendLong(0x39, 0x2c, trm->buf, trm->buf_cnt);
+	if (trmq_put (&esp_trm_queue, trm) > 0) {
+		xTaskNotifyGive (esp_disp_task);
+	}
+}
+
+// Send the area that was deferred while the display task was busy, even
+// if the screen does not change anymore.
+static void esp_trm_check (terminal_t *trm)
+{
+	if (esp_trm_queue.pend.w == 0) {
+		return;
+	}
+
+	if (trmq_put_pend (&esp_trm_queue, trm) > 0) {
+		xTaskNotifyGive (esp_disp_task);
+	}
 }
 
 
@@ -166,6 +279,8 @@ terminal_t *ini_get_terminal (const char *def)
 
 	trm = null_new(NULL);
 
+	trm_set_format (trm, TRM_FMT_MONO);
+
 	// trm_init (trm, trm);
 
 	// trm->del = (void *) trm_del;
@@ -173,18 +288,33 @@ terminal_t *ini_get_terminal (const char *def)
 	// trm->close = (void *) trm_close;
 	// trm->set_msg_trm = (void *) trm_set_msg_trm;
 	trm->update = (void *) esp_trm_update;
-	// sdl->trm.check = (void *) trm_check;
+	trm->check = (void *) esp_trm_check;
 
 	return trm;
 }
 
 
-void emu_task(void *pvParameters)
+void disp_task(void *pvParameters)
 {
-    // Initialize the DSI interface
-    mipiInit();
-    initOled();
+	trmq_msg_t msg;
+
+	// Initialize the DSI interface
+	mipiInit();
+	initOled();
+
+	while (1) {
+		while (trmq_get (&esp_trm_queue, &msg) == 0) {
+			esp_trm_draw (&msg);
+			trmq_done (&esp_trm_queue, &msg);
+		}
+
+		ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+	}
+}
 
+
+void emu_task(void *pvParameters)
+{
 	pce_log_init();
 	pce_log_add_fp (stderr, 0, MSG_DEB);
 	mac_log_banner();
@@ -277,6 +407,13 @@ void app_main(void)
 	// printf("Starting oled_task...\n");
 	// xTaskCreatePinnedToCore(&oled_task, "oled", 12 * 1024, NULL, 5, NULL, 1);
 
+	trmq_init (&esp_trm_queue);
+
+	// The display task must exist before the emulator sends the first
+	// update.
+	printf("Starting disp_task...\n");
+	xTaskCreatePinnedToCore(&disp_task, "disp", 8 * 1024, NULL, 5, &esp_disp_task, 1);
+
 	printf("Starting emu_task...\n");
 	xTaskCreatePinnedToCore(&emu_task, "emu", 20 * 1024, NULL, 5, NULL, 0);
 }
@@ -48,7 +48,7 @@ mon_cmd_t par_cmd[] = {
 	{ "reset", "", "reset" },
 	{ "rte", "", "execute to next rte" },
 	{ "r", "reg [val]", "get or set a register" },
-	{ "s", "[what]", "print status (cpu|disks|iwm|mem|scc|via)" },
+	{ "s", "[what]", "print status (cpu|disks|iwm|mem|scc|via|video)" },
 	{ "t", "[cnt]", "execute cnt instructions [1]" },
 	{ "u", "[gas] [[-]addr [cnt]]", "disassemble" }
 };
@@ -319,6 +319,32 @@ void mac_prt_state_mem (macplus_t *sim)
 	mem_prt_state (sim->mem, stdout);
 }
 
+static
+void mac_prt_state_video (macplus_t *sim)
+{
+	mac_video_t *mv;
+
+	mv = sim->video;
+
+	pce_prt_sep ("VIDEO");
+
+	if (mv == NULL) {
+		return;
+	}
+
+	pce_printf ("LAG=%luus  SKIP=%u/%u  FPS=%u.%02u\n",
+		mv->lag, mv->skip_cnt, mv->skip_max, mv->fps / 100, mv->fps % 100
+	);
+
+	pce_printf ("DRAWN=%lu  SKIPPED=%lu\n",
+		mv->frames_drawn, mv->frames_skipped
+	);
+
+	if (mv->hash_on) {
+		pce_printf ("HASH=%016llx\n", mv->hash);
+	}
+}
+
 void mac_prt_state (macplus_t *sim, const char *str)
 {
 	cmd_t cmd;
@@ -348,6 +374,9 @@ void mac_prt_state (macplus_t *sim, const char *str)
 		else if (cmd_match (&cmd, "via")) {
 			mac_prt_state_via (sim);
 		}
+		else if (cmd_match (&cmd, "video")) {
+			mac_prt_state_video (sim);
+		}
 		else {
 			pce_printf ("unknown component (%s)\n", cmd_get_str (&cmd));
 			return;
@@ -423,9 +452,11 @@ void mac_run (macplus_t *sim)
 	pce_start (&sim->brk);
 	mac_clock_discontinuity (sim);
 
+	/* memory may have been changed from the monitor */
+	e68_icache_flush (sim->cpu);
+
 	while (1) {
-		mac_clock (par_sim, 0);
-		mac_clock (par_sim, 0);
+		mac_clock_run (sim);
 
 		if (sim->brk) {
 			break;
@@ -485,6 +516,7 @@ void mac_log_exception (void *ext, unsigned tn)
 
 	case 0x0a:
 		mac_sony_patch (&sim->sony);
+		e68_icache_flush (sim->cpu);
 		return;
 
 	case 0x19:
@@ -706,6 +738,9 @@ void mac_cmd_hm (cmd_t *cmd)
 		"emu.term.title       <title>\n"
 		"\n"
 		"emu.video.brightness <val>\n"
+		"emu.video.hash       [\"0\" | \"1\"]\n"
+		"emu.video.hash.log   [<filename>]\n"
+		"emu.video.skip       <max>\n"
 		"\n"
 	);
 
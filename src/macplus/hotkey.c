@@ -51,6 +51,7 @@ int pcex_interrupt (macplus_t *sim, unsigned long val)
 	mem_set_uint32_be (sim->mem, sp - 4, e68_get_pc (sim->cpu));
 	mem_set_uint16_be (sim->mem, sp - 6, e68_get_sr (sim->cpu));
 	mem_set_uint32_be (sim->mem, sp - 10, e68_get_dreg32 (sim->cpu, 0));
+	e68_icache_write (sim->cpu, sp - 10, 10);
 	e68_set_dreg32 (sim->cpu, 0, val);
 	e68_set_areg32 (sim->cpu, 7, sp - 10);
 	e68_set_pc_prefetch (sim->cpu, addr);
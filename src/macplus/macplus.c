@@ -46,7 +46,11 @@
 #include <devices/nvram.h>
 
 #include <drivers/block/block.h>
+#include <drivers/block/blkasync.h>
+#include <drivers/block/blkflash.h>
+#include <drivers/block/blkftl.h>
 #include <drivers/block/blkraw.h>
+#include <drivers/block/flash.h>
 #include <drivers/video/terminal.h>
 
 #include <lib/brkpt.h>
@@ -69,6 +73,21 @@
 #define MAC_CPU_SLEEP 10000
 #endif
 
+/* Idle disk write caches are written back MAC_DISK_FLUSH times per second */
+#define MAC_DISK_FLUSH 2
+
+/* In adaptive speed mode, speed_clock_extra is in units of 1/MAC_SPEED_FRAC */
+#define MAC_SPEED_FRAC 16
+
+enum {
+	MAC_EVT_VIA,
+	MAC_EVT_SCC,
+	MAC_EVT_VIDEO,
+	MAC_EVT_KBD,
+	MAC_EVT_SLOW,
+	MAC_EVT_CNT
+};
+
 
 static
 unsigned char par_classic_pwm[64] = {
@@ -198,6 +217,12 @@ void mac_interrupt_vbi (void *ext, unsigned char val)
 
 		mac_sound_vbl (&sim->sound);
 
+		if (sim->video_hash_fp != NULL) {
+			fprintf (sim->video_hash_fp, "%llu %016llx\n",
+				sim->clk_cnt, mac_video_get_hash (sim->video)
+			);
+		}
+
 		for (i = 0; i < 370; i++) {
 			pbuf[i] = mem_get_uint8 (sim->mem, sim->sbuf1 + i + 1);
 		}
@@ -260,11 +285,29 @@ void mac_set_reset (void *ext, unsigned char val)
 static
 void mac_set_vbuf (macplus_t *sim, unsigned long addr)
 {
+	unsigned      shift;
 	unsigned char *vbuf;
 	mem_blk_t     *blk;
 
+	e68_set_watch (sim->cpu, 0, 0, 0, NULL);
+	mac_video_set_track (sim->video, 0);
+
 	if (addr < mem_blk_get_size (sim->ram)) {
 		vbuf = mem_blk_get_data (sim->ram) + addr;
+
+		shift = 0;
+		while ((1UL << shift) < (VIDEO_W / 8)) {
+			shift += 1;
+		}
+
+		/* let the CPU mark written lines in the dirty map */
+		if ((1UL << shift) == (VIDEO_W / 8)) {
+			e68_set_watch (sim->cpu, addr, (VIDEO_W / 8) * VIDEO_H, shift,
+				mac_video_get_dirty (sim->video)
+			);
+
+			mac_video_set_track (sim->video, 1);
+		}
 	}
 	else {
 		blk = mem_get_blk (sim->mem, addr);
@@ -535,6 +578,8 @@ unsigned char mac_scc_get_uint8 (void *ext, unsigned long addr)
 	unsigned char val;
 	macplus_t     *sim = ext;
 
+	mac_clock_sync (sim);
+
 	val = 0xff;
 
 	switch (addr) {
@@ -567,6 +612,8 @@ void mac_scc_set_uint8 (void *ext, unsigned long addr, unsigned char val)
 {
 	macplus_t *sim = ext;
 
+	mac_clock_sync (sim);
+
 #ifdef DEBUG_SCC
 	mac_log_deb ("scc: set  8: %06lX <- %02X\n", addr, val);
 #endif
@@ -591,6 +638,77 @@ void mac_scc_set_uint8 (void *ext, unsigned long addr, unsigned char val)
 }
 
 
+static
+unsigned char mac_via_get_uint8 (void *ext, unsigned long addr)
+{
+	macplus_t *sim = ext;
+
+	mac_clock_sync (sim);
+
+	return (e6522_get_uint8 (&sim->via, addr));
+}
+
+static
+unsigned short mac_via_get_uint16 (void *ext, unsigned long addr)
+{
+	macplus_t *sim = ext;
+
+	mac_clock_sync (sim);
+
+	return (e6522_get_uint16 (&sim->via, addr));
+}
+
+static
+unsigned long mac_via_get_uint32 (void *ext, unsigned long addr)
+{
+	macplus_t *sim = ext;
+
+	mac_clock_sync (sim);
+
+	return (e6522_get_uint32 (&sim->via, addr));
+}
+
+/*
+ * A VIA write can start a timer or change the video and sound buffers,
+ * so the current CPU batch must end early.
+ */
+static
+void mac_via_set_uint8 (void *ext, unsigned long addr, unsigned char val)
+{
+	macplus_t *sim = ext;
+
+	mac_clock_sync (sim);
+
+	e6522_set_uint8 (&sim->via, addr, val);
+
+	e68_clock_stop (sim->cpu);
+}
+
+static
+void mac_via_set_uint16 (void *ext, unsigned long addr, unsigned short val)
+{
+	macplus_t *sim = ext;
+
+	mac_clock_sync (sim);
+
+	e6522_set_uint16 (&sim->via, addr, val);
+
+	e68_clock_stop (sim->cpu);
+}
+
+static
+void mac_via_set_uint32 (void *ext, unsigned long addr, unsigned long val)
+{
+	macplus_t *sim = ext;
+
+	mac_clock_sync (sim);
+
+	e6522_set_uint32 (&sim->via, addr, val);
+
+	e68_clock_stop (sim->cpu);
+}
+
+
 static
 void mac_setup_system (macplus_t *sim)
 {
@@ -684,6 +802,21 @@ void mac_setup_cpu (macplus_t *sim)
 
 	e68_set_address_check (sim->cpu, 0);
 
+	if (sim->rom != NULL) {
+		e68_icache_set_rom (sim->cpu,
+			mem_blk_get_addr (sim->rom), mem_blk_get_size (sim->rom)
+		);
+	}
+
+	if (CPU_JIT) {
+		if (e68_set_jit (sim->cpu, 1)) {
+			pce_log_tag (MSG_INF, "CPU:", "recompiler not available\n");
+		}
+		else {
+			pce_log_tag (MSG_INF, "CPU:", "recompiler enabled\n");
+		}
+	}
+
 	sim->speed_factor = CPU_SPEED;
 	sim->speed_limit[PCE_MAC_SPEED_USER] = CPU_SPEED;
 }
@@ -712,9 +845,9 @@ void mac_setup_via (macplus_t *sim)
 		return;
 	}
 
-	mem_blk_set_fct (blk, &sim->via,
-		e6522_get_uint8, e6522_get_uint16, e6522_get_uint32,
-		e6522_set_uint8, e6522_set_uint16, e6522_set_uint32
+	mem_blk_set_fct (blk, sim,
+		mac_via_get_uint8, mac_via_get_uint16, mac_via_get_uint32,
+		mac_via_set_uint8, mac_via_set_uint16, mac_via_set_uint32
 	);
 
 	mem_add_blk (sim->mem, blk, 1);
@@ -886,6 +1019,94 @@ void mac_setup_adb (macplus_t *sim)
 	}
 }
 
+#if defined(SDL_SIM) && defined(DISK_FTL)
+/*
+ * Open the simulated flash partition of a log-structured disk. A new
+ * flash file is filled from the disk image img, if the image fits.
+ */
+static
+disk_t *mac_open_ftl_file (const char *fname, const char *img)
+{
+	uint32_t      i, j, n;
+	FILE          *fp;
+	flash_t       *fl;
+	disk_t        *dsk, *src;
+	unsigned char buf[64 * 512];
+
+	if ((fp = fopen (fname, "rb")) == NULL) {
+		if ((fp = fopen (fname, "wb")) == NULL) {
+			return (NULL);
+		}
+
+		dsk_set_filesize (fp, DISK_FTL_FLASH_SIZE);
+	}
+
+	fclose (fp);
+
+	if ((fl = flash_file_open (fname, DISK_FLASH_ERASE_SIZE)) == NULL) {
+		return (NULL);
+	}
+
+	if ((dsk = dsk_ftl_new (fl, 1)) == NULL) {
+		flash_del (fl);
+		return (NULL);
+	}
+
+	dsk_set_fname (dsk, fname);
+
+	if (dsk_ftl_get_blank (dsk) == 0) {
+		return (dsk);
+	}
+
+	if ((src = dsk_img_open (img, 0, 1)) == NULL) {
+		return (dsk);
+	}
+
+	if (src->blocks > dsk->blocks) {
+		pce_log_tag (MSG_ERR, "DISK:", "image too big for %s (%lu > %lu blocks)\n",
+			fname, (unsigned long) src->blocks, (unsigned long) dsk->blocks
+		);
+		dsk_del (src);
+		return (dsk);
+	}
+
+	pce_log_tag (MSG_INF, "DISK:", "copying %s to %s\n", img, fname);
+
+	for (i = 0; i < src->blocks; i += n) {
+		n = src->blocks - i;
+
+		if (n > 64) {
+			n = 64;
+		}
+
+		if (dsk_read_lba (src, buf, i, n)) {
+			break;
+		}
+
+		/* unwritten blocks read as zero */
+		for (j = 0; j < (512 * n); j++) {
+			if (buf[j] != 0) {
+				break;
+			}
+		}
+
+		if (j < (512 * n)) {
+			if (dsk_write_lba (dsk, buf, i, n)) {
+				break;
+			}
+		}
+	}
+
+	if (i < src->blocks) {
+		pce_log_tag (MSG_ERR, "DISK:", "copying %s failed\n", img);
+	}
+
+	dsk_del (src);
+
+	return (dsk);
+}
+#endif
+
 static
 void mac_setup_disks (macplus_t *sim)
 {
@@ -894,10 +1115,27 @@ void mac_setup_disks (macplus_t *sim)
 
 	dsks = dsks_new();
 
-	#ifdef SDL_SIM
+	sim->dsks = dsks;
+
+	#if defined(SDL_SIM) && defined(DISK_FTL)
+		dsk = mac_open_ftl_file(DISK_FTL_FILE_NAME, DISK_FILE_NAME);
+	#elif defined(SDL_SIM) && defined(DISK_FLASH_SIM)
+		flash_t *fl = flash_file_open(DISK_FILE_NAME, DISK_FLASH_ERASE_SIZE);
+
+		if (fl != NULL) {
+			if ((dsk = dsk_flash_new(fl, DISK_CACHE_BLOCKS)) == NULL) {
+				flash_del (fl);
+			}
+			else {
+				dsk_set_fname (dsk, DISK_FILE_NAME);
+			}
+		}
+	#elif defined(SDL_SIM)
 		dsk = dsk_img_open(DISK_FILE_NAME, 0, 0);
+	#elif defined(DISK_FTL)
+		dsk = ftl_disk_init(DISK_PARTITION_NAME, 0);
 	#else
-		dsk = flash_disk_init(DISK_PARTITION_NAME, 0);
+		dsk = flash_disk_init(DISK_PARTITION_NAME, 0, DISK_CACHE_BLOCKS);
 	#endif
 
 	if (dsk == NULL) {
@@ -905,6 +1143,21 @@ void mac_setup_disks (macplus_t *sim)
 		return;
 	}
 
+	if (DISK_ASYNC) {
+		disk_t *adsk;
+
+		adsk = dsk_async_new (dsk,
+			DISK_ASYNC_READ_BLOCKS, DISK_ASYNC_WRITE_CNT, DISK_ASYNC_WRITE_BLOCKS
+		);
+
+		if (adsk == NULL) {
+			pce_log_tag (MSG_ERR, "DISK:", "couldn't start the disk thread\n");
+		}
+		else {
+			dsk = adsk;
+		}
+	}
+
 	dsk_set_drive (dsk, DISK_DRIVE);
 
 	pce_log_tag (MSG_INF,
@@ -919,7 +1172,6 @@ void mac_setup_disks (macplus_t *sim)
 	);
 
 	dsks_add_disk (dsks, dsk);
-	sim->dsks = dsks;
 }
 
 static
@@ -948,6 +1200,151 @@ void mac_setup_iwm (macplus_t *sim)
 	}
 }
 
+/*
+ * Get the number of iterations that follow the current one, if the
+ * instruction at pc is the byte move of a SCSI transfer loop:
+ *
+ *       move.b  ..., ...
+ *       dbra    dn, loop
+ *
+ *       [btst   dk, d16(ab)]
+ *       [beq.s  *-2]
+ *       move.b  ..., ...
+ *       subq.l  #1, dn
+ *       bne.s   loop
+ *
+ * The second form is used by the ROM, the data register is polled
+ * for DRQ before each byte. Returns -1 if the loop is not recognized.
+ */
+static
+long mac_scsi_dma_loop (macplus_t *sim, unsigned long pc, unsigned *dn, int *dbra)
+{
+	unsigned      op1, op2;
+	unsigned long tgt, val;
+
+	op1 = mem_get_uint16_be (sim->mem, pc + 2);
+	op2 = mem_get_uint16_be (sim->mem, pc + 4);
+
+	*dn = op1 & 7;
+
+	if (((op1 & 0xfff8) == 0x51c8) && (op2 == 0xfffc)) {
+		*dbra = 1;
+
+		return (e68_get_dreg16 (sim->cpu, *dn));
+	}
+
+	if (((op1 & 0xfff8) != 0x5380) || ((op2 & 0xff00) != 0x6600)) {
+		return (-1);
+	}
+
+	tgt = (pc + 6 + (op2 & 0xff) - ((op2 & 0x80) ? 0x100 : 0)) & 0xffffffff;
+
+	if (tgt != pc) {
+		if (tgt != (pc - 6)) {
+			return (-1);
+		}
+
+		if ((mem_get_uint16_be (sim->mem, pc - 6) & 0xf1f8) != 0x0128) {
+			return (-1);
+		}
+
+		if (mem_get_uint16_be (sim->mem, pc - 2) != 0x67fa) {
+			return (-1);
+		}
+	}
+
+	*dbra = 0;
+
+	val = e68_get_dreg32 (sim->cpu, *dn);
+
+	if ((val == 0) || (val > 0x7fffffff)) {
+		return (-1);
+	}
+
+	return (val - 1);
+}
+
+/*
+ * Pseudo DMA acceleration
+ *
+ * If the CPU transfers the data of a SCSI command one byte per loop
+ * iteration, all iterations but the current one are done at once and
+ * the loop registers are updated as if the loop had run. This relies
+ * on move.b reading its source before it writes its destination.
+ */
+static
+void mac_scsi_dma (void *ext, int wr)
+{
+	macplus_t     *sim = ext;
+	unsigned      op, ay, dn;
+	int           dbra;
+	long          cnt;
+	unsigned long pc, addr, val, n, avail;
+	unsigned char *ptr;
+
+	pc = e68_get_pc (sim->cpu);
+	op = mem_get_uint16_be (sim->mem, pc);
+
+	if (wr) {
+		/* move.b (ay)+, (ax) */
+		if ((op & 0xf1f8) != 0x1098) {
+			return;
+		}
+
+		ay = op & 7;
+	}
+	else {
+		/* move.b (ax), (ay)+ */
+		if ((op & 0xf1f8) != 0x10d0) {
+			return;
+		}
+
+		ay = (op >> 9) & 7;
+	}
+
+	if ((cnt = mac_scsi_dma_loop (sim, pc, &dn, &dbra)) <= 0) {
+		return;
+	}
+
+	/* only map the bytes that the SCSI transfer has left */
+	avail = mac_scsi_dma_avail (&sim->scsi, wr);
+
+	if (avail == 0) {
+		return;
+	}
+
+	if ((unsigned long) cnt > avail) {
+		cnt = avail;
+	}
+
+	addr = e68_get_areg32 (sim->cpu, ay) & 0x00ffffff;
+
+	if ((ptr = mem_get_ptr_direct (sim->mem, addr, cnt, !wr)) == NULL) {
+		return;
+	}
+
+	if (wr) {
+		n = mac_scsi_dma_set (&sim->scsi, ptr, cnt);
+	}
+	else {
+		n = mac_scsi_dma_get (&sim->scsi, ptr, cnt);
+		e68_icache_write (sim->cpu, addr, n);
+	}
+
+	e68_set_areg32 (sim->cpu, ay, e68_get_areg32 (sim->cpu, ay) + n);
+
+	val = e68_get_dreg32 (sim->cpu, dn);
+
+	if (dbra) {
+		val = (val & 0xffff0000) | ((val - n) & 0xffff);
+	}
+	else {
+		val -= n;
+	}
+
+	e68_set_dreg32 (sim->cpu, dn, val);
+}
+
 static
 void mac_setup_scsi (macplus_t *sim)
 {
@@ -964,6 +1361,10 @@ void mac_setup_scsi (macplus_t *sim)
 
 	mac_scsi_set_disks (&sim->scsi, sim->dsks);
 
+	if (SCSI_DMA_ACCEL) {
+		mac_scsi_set_dma_fct (&sim->scsi, sim, mac_scsi_dma);
+	}
+
 	blk = mem_blk_new (addr, size, 0);
 	if (blk == NULL) {
 		return;
@@ -985,12 +1386,21 @@ void mac_setup_scsi (macplus_t *sim)
 	);
 }
 
+static
+void mac_sony_ram_write (void *ext, unsigned long addr, unsigned long size)
+{
+	macplus_t *sim = ext;
+
+	e68_icache_write (sim->cpu, addr, size);
+}
+
 static
 void mac_setup_sony (macplus_t *sim)
 {
 	mac_sony_init (&sim->sony, 0);
 	mac_sony_set_mem (&sim->sony, sim->mem);
 	mac_sony_set_disks (&sim->sony, sim->dsks);
+	mac_sony_set_ram_fct (&sim->sony, sim, mac_sony_ram_write);
 }
 
 static
@@ -1094,6 +1504,7 @@ void mac_setup_video (macplus_t *sim)
 
 	mac_video_set_color (sim->video, VIDEO_COLOR0, VIDEO_COLOR1);
 	mac_video_set_brightness (sim->video, (255UL * VIDEO_BRIGHTNESS + 500) / 1000);
+	mac_video_set_skip (sim->video, VIDEO_SKIP_MAX);
 
 	for (i = 0; i < (VIDEO_W / 8) * VIDEO_H; i++) {
 		mem_set_uint8 (sim->mem, sim->vbuf1 + i, 0xff);
@@ -1133,6 +1544,9 @@ void mac_init (macplus_t *sim)
 	}
 
 	sim->ser_clk = 0;
+	sim->video_hash_fp = NULL;
+	sim->dsk_flush_clk = 0;
+	sim->cpu_clk = 0;
 	sim->clk_cnt = 0;
 
 	for (i = 0; i < 4; i++) {
@@ -1189,6 +1603,11 @@ void mac_free (macplus_t *sim)
 		);
 	}
 
+	if (sim->video_hash_fp != NULL) {
+		fclose (sim->video_hash_fp);
+	}
+
+	e68_set_watch (sim->cpu, 0, 0, 0, NULL);
 	mac_video_del (sim->video);
 	trm_del (sim->trm);
 	mac_sound_free (&sim->sound);
@@ -1233,6 +1652,10 @@ void mac_clock_discontinuity (macplus_t *sim)
 	pce_get_interval_us (&sim->sync_us);
 
 	sim->speed_clock_extra = 0;
+
+	if (sim->video != NULL) {
+		mac_video_set_lag (sim->video, 0);
+	}
 }
 
 void mac_set_pause (macplus_t *sim, int pause)
@@ -1403,6 +1826,10 @@ void mac_realtime_sync (macplus_t *sim, unsigned long n)
 			mac_log_deb ("system too slow, skipping 1 second\n");
 			sim->sync_sleep += 1000000;
 		}
+
+		if (sim->video != NULL) {
+			mac_video_set_lag (sim->video, (sim->sync_sleep < 0) ? -sim->sync_sleep : 0);
+		}
 	}
 }
 
@@ -1417,78 +1844,76 @@ void mac_clock_scc (macplus_t *sim, unsigned n)
 	}
 }
 
-void mac_clock (macplus_t *sim, unsigned n)
+/*
+ * Get the divider from CPU clock cycles (scaled by MAC_SPEED_FRAC) to
+ * device clock cycles.
+ */
+static
+unsigned long mac_clock_get_div (const macplus_t *sim)
 {
-	unsigned long viaclk, clkdiv, cpuclk;
-
-	if (n == 0) {
-		n = sim->cpu->delay;
-		if (n == 0) {
-			n = 1;
-		}
-	}
-
 	if (sim->speed_factor == 0) {
-		cpuclk = n + sim->speed_clock_extra;
-		clkdiv = 1;
-	}
-	else {
-		cpuclk = n;
-		clkdiv = sim->speed_factor;
+		return (MAC_SPEED_FRAC + sim->speed_clock_extra);
 	}
 
-	e68_clock (sim->cpu, cpuclk);
+	return (MAC_SPEED_FRAC * sim->speed_factor);
+}
 
-	mac_sound_clock (&sim->sound, cpuclk);
+/*
+ * Clock the devices by n CPU clock cycles.
+ */
+static
+void mac_clock_devices (macplus_t *sim, unsigned long n)
+{
+	unsigned long div, viaclk, clk;
+
+	mac_sound_clock (&sim->sound, n);
 
 	sim->clk_cnt += n;
 
-	sim->clk_div[0] += n;
+	div = mac_clock_get_div (sim);
 
-	while (sim->clk_div[0] >= clkdiv) {
-		sim->clk_div[1] += 1;
-		sim->clk_div[0] -= clkdiv;
-	}
+	sim->clk_div[0] += MAC_SPEED_FRAC * n;
+	sim->clk_div[1] += sim->clk_div[0] / div;
+	sim->clk_div[0] %= div;
 
 	if (sim->clk_div[1] < 10) {
 		return;
 	}
 
 	viaclk = sim->clk_div[1] / 10;
+	clk = 10 * viaclk;
 
 	e6522_clock (&sim->via, viaclk);
 
 	if (sim->adb != NULL) {
-		mac_adb_clock (sim->adb, 10 * viaclk);
+		mac_adb_clock (sim->adb, clk);
 	}
 
 	mac_iwm_clock (&sim->iwm, viaclk);
 
-	mac_clock_scc (sim, 10 * viaclk);
+	mac_clock_scc (sim, clk);
 
-	sim->clk_div[1] -= 10 * viaclk;
-	sim->clk_div[2] += 10 * viaclk;
+	mac_video_clock (sim->video, clk);
 
-	if (sim->clk_div[2] < 256) {
-		return;
-	}
+	sim->clk_div[1] -= clk;
+	sim->clk_div[2] += clk;
+	sim->clk_div[3] += clk;
 
-	mac_video_clock (sim->video, sim->clk_div[2]);
-
-	mac_ser_process (&sim->ser[0]);
-	mac_ser_process (&sim->ser[1]);
+	if (sim->clk_div[2] >= 256) {
+		if (sim->kbd != NULL) {
+			mac_kbd_clock (sim->kbd, sim->clk_div[2]);
+		}
 
-	if (sim->kbd != NULL) {
-		mac_kbd_clock (sim->kbd, sim->clk_div[2]);
+		sim->clk_div[2] = 0;
 	}
 
-	sim->clk_div[3] += sim->clk_div[2];
-	sim->clk_div[2] = 0;
-
 	if (sim->clk_div[3] < 8192) {
 		return;
 	}
 
+	mac_ser_process (&sim->ser[0]);
+	mac_ser_process (&sim->ser[1]);
+
 	if (sim->trm != NULL) {
 		trm_check (sim->trm);
 	}
@@ -1497,11 +1922,113 @@ void mac_clock (macplus_t *sim, unsigned n)
 
 	mac_rtc_clock (&sim->rtc, sim->clk_div[3]);
 
+	sim->dsk_flush_clk += sim->clk_div[3];
+
+	if (sim->dsk_flush_clk >= (MAC_CPU_CLOCK / MAC_DISK_FLUSH)) {
+		sim->dsk_flush_clk -= MAC_CPU_CLOCK / MAC_DISK_FLUSH;
+
+		if (sim->dsks != NULL) {
+			dsks_flush (sim->dsks);
+		}
+	}
+
 	mac_realtime_sync (sim, sim->clk_div[3]);
 
 	sim->clk_div[3] = 0;
 }
 
+/*
+ * Get the number of device clock cycles until the next event that
+ * can not be handled lazily.
+ */
+static
+unsigned long mac_clock_get_next (macplus_t *sim)
+{
+	unsigned      i;
+	unsigned long evt[MAC_EVT_CNT];
+	unsigned long scc, next;
+
+	evt[MAC_EVT_VIA] = 10 * e6522_get_clock_next (&sim->via);
+
+	scc = sim->scc.chn[0].char_clk_cnt;
+
+	if (sim->scc.chn[1].char_clk_cnt < scc) {
+		scc = sim->scc.chn[1].char_clk_cnt;
+	}
+
+	if ((32 * scc) > sim->ser_clk) {
+		evt[MAC_EVT_SCC] = (32 * scc - sim->ser_clk + 14) / 15;
+	}
+	else {
+		evt[MAC_EVT_SCC] = 1;
+	}
+
+	evt[MAC_EVT_VIDEO] = mac_video_get_clock_next (sim->video);
+
+	if ((sim->adb != NULL) || ((sim->kbd != NULL) && sim->kbd->data && sim->kbd->send_byte)) {
+		evt[MAC_EVT_KBD] = 256 - sim->clk_div[2];
+	}
+	else {
+		evt[MAC_EVT_KBD] = -1;
+	}
+
+	evt[MAC_EVT_SLOW] = 8192 - sim->clk_div[3];
+
+	next = evt[0];
+
+	for (i = 1; i < MAC_EVT_CNT; i++) {
+		if (evt[i] < next) {
+			next = evt[i];
+		}
+	}
+
+	/* the devices are clocked in units of 10 cycles */
+	next = 10 * ((next + 9) / 10);
+
+	return (next - sim->clk_div[1]);
+}
+
+void mac_clock_sync (macplus_t *sim)
+{
+	unsigned long n;
+
+	n = e68_get_clkcnt (sim->cpu) - sim->cpu_clk;
+
+	if (n > 0) {
+		sim->cpu_clk += n;
+		mac_clock_devices (sim, n);
+	}
+}
+
+void mac_clock (macplus_t *sim, unsigned n)
+{
+	if (n == 0) {
+		n = sim->cpu->delay;
+		if (n == 0) {
+			n = 1;
+		}
+	}
+
+	e68_clock (sim->cpu, n);
+
+	mac_clock_sync (sim);
+}
+
+void mac_clock_run (macplus_t *sim)
+{
+	unsigned long next, div, n;
+
+	next = mac_clock_get_next (sim);
+	div = mac_clock_get_div (sim);
+
+	n = next * div - sim->clk_div[0];
+	n = (n + MAC_SPEED_FRAC - 1) / MAC_SPEED_FRAC;
+
+	e68_run_cycles (sim->cpu, n);
+
+	mac_clock_sync (sim);
+}
+
 void print_version (void)
 {
 	fputs (
@@ -36,6 +36,8 @@
 #include "sound.h"
 #include "video.h"
 
+#include <stdio.h>
+
 #include <chipset/e6522.h>
 #include <chipset/e8530.h>
 
@@ -137,6 +139,15 @@ struct macplus_s {
 
 	unsigned           ser_clk;
 
+	/* clocks since the disk write caches were last flushed */
+	unsigned long      dsk_flush_clk;
+
+	/* the (clock, frame hash) log, written at every vertical blank */
+	FILE               *video_hash_fp;
+
+	/* the CPU clock count up to which the devices have been clocked */
+	unsigned long      cpu_clk;
+
 	unsigned long long clk_cnt;
 	unsigned long      clk_div[4];
 };
@@ -181,12 +192,22 @@ int mac_set_cpu_model (macplus_t *sim, const char *model);
  *****************************************************************************/
 void mac_reset (macplus_t *sim);
 
+/*****************************************************************************
+ * @short Clock the devices up to the current CPU clock
+ *****************************************************************************/
+void mac_clock_sync (macplus_t *sim);
+
 /*****************************************************************************
  * @short Clock the simulator
- * @param n The number of clock cycles.
+ * @param n The number of clock cycles. If n is 0, one instruction is executed.
  *****************************************************************************/
 void mac_clock (macplus_t *sim, unsigned n);
 
+/*****************************************************************************
+ * @short Run the CPU up to the next device event, then clock the devices
+ *****************************************************************************/
+void mac_clock_run (macplus_t *sim);
+
 
 
 terminal_t *ini_get_terminal (const char *def);
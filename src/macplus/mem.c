@@ -56,6 +56,15 @@ void mac_set_overlay (macplus_t *sim, int overlay)
 
 		sim->overlay = 0;
 	}
+
+	/* the ROM stays at 400000 in both cases */
+	if (sim->rom != NULL) {
+		e68_set_rom (sim->cpu,
+			mem_blk_get_data (sim->rom),
+			mem_blk_get_addr (sim->rom),
+			mem_blk_get_size (sim->rom)
+		);
+	}
 }
 
 
@@ -126,6 +135,7 @@ unsigned char mac_mem_get_uint8 (void *ext, unsigned long addr)
 	}
 
 	if ((addr >= 0xc00000) && (addr < 0xe00000)) {
+		mac_clock_sync (sim);
 		return (mac_iwm_get_uint8 (&sim->iwm, addr - 0xc00000));
 	}
 
@@ -176,6 +186,7 @@ void mac_mem_set_uint8 (void *ext, unsigned long addr, unsigned char val)
 
 	if (mac_addr_map (sim, &addr)) {
 		mem_set_uint8 (sim->mem, addr, val);
+		e68_icache_write (sim->cpu, addr, 1);
 	}
 
 	if ((addr >= 0x580000) && (addr < 0x600000)) {
@@ -183,6 +194,7 @@ void mac_mem_set_uint8 (void *ext, unsigned long addr, unsigned char val)
 	}
 
 	if ((addr >= 0xc00000) && (addr < 0xe00000)) {
+		mac_clock_sync (sim);
 		mac_iwm_set_uint8 (&sim->iwm, addr - 0xc00000, val);
 		return;
 	}
@@ -198,6 +210,7 @@ void mac_mem_set_uint16 (void *ext, unsigned long addr, unsigned short val)
 
 	if (mac_addr_map (sim, &addr)) {
 		mem_set_uint16_be (sim->mem, addr, val);
+		e68_icache_write (sim->cpu, addr, 2);
 	}
 
 #ifdef DEBUG_MEM
@@ -211,6 +224,7 @@ void mac_mem_set_uint32 (void *ext, unsigned long addr, unsigned long val)
 
 	if (mac_addr_map (sim, &addr)) {
 		mem_set_uint32_be (sim->mem, addr, val);
+		e68_icache_write (sim->cpu, addr, 4);
 	}
 
 #ifdef DEBUG_MEM
@@ -312,6 +312,74 @@ int mac_set_msg_emu_video_brightness (macplus_t *sim, const char *msg, const cha
 	return (0);
 }
 
+static
+int mac_set_msg_emu_video_hash (macplus_t *sim, const char *msg, const char *val)
+{
+	int v;
+
+	if (*val == 0) {
+		if (sim->video->hash_on == 0) {
+			pce_log (MSG_INF, "video hash: off\n");
+			return (0);
+		}
+
+		pce_log (MSG_INF, "video hash: %016llx (clock %llu)\n",
+			mac_video_get_hash (sim->video), sim->clk_cnt
+		);
+
+		return (0);
+	}
+
+	if (msg_get_bool (val, &v)) {
+		return (1);
+	}
+
+	if ((v == 0) && (sim->video_hash_fp != NULL)) {
+		fclose (sim->video_hash_fp);
+		sim->video_hash_fp = NULL;
+	}
+
+	return (mac_video_set_hash (sim->video, v));
+}
+
+static
+int mac_set_msg_emu_video_hash_log (macplus_t *sim, const char *msg, const char *val)
+{
+	if (sim->video_hash_fp != NULL) {
+		fclose (sim->video_hash_fp);
+		sim->video_hash_fp = NULL;
+	}
+
+	if (*val == 0) {
+		return (0);
+	}
+
+	if (mac_video_set_hash (sim->video, 1)) {
+		return (1);
+	}
+
+	if ((sim->video_hash_fp = fopen (val, "w")) == NULL) {
+		pce_log (MSG_ERR, "*** can't open video hash log (%s)\n", val);
+		return (1);
+	}
+
+	return (0);
+}
+
+static
+int mac_set_msg_emu_video_skip (macplus_t *sim, const char *msg, const char *val)
+{
+	unsigned max;
+
+	if (msg_get_uint (val, &max)) {
+		return (1);
+	}
+
+	mac_video_set_skip (sim->video, max);
+
+	return (0);
+}
+
 
 static mac_msg_list_t set_msg_list[] = {
 	{ "disk.eject", mac_set_msg_disk_eject },
@@ -334,6 +402,9 @@ static mac_msg_list_t set_msg_list[] = {
 	{ "emu.ser2.multi", mac_set_msg_emu_ser2_multi },
 	{ "emu.stop", mac_set_msg_emu_stop },
 	{ "emu.video.brightness", mac_set_msg_emu_video_brightness },
+	{ "emu.video.hash", mac_set_msg_emu_video_hash },
+	{ "emu.video.hash.log", mac_set_msg_emu_video_hash_log },
+	{ "emu.video.skip", mac_set_msg_emu_video_skip },
 	{ NULL, NULL }
 };
 
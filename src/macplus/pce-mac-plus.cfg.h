@@ -20,6 +20,10 @@
 // dynamically adjusts the CPU speed.
 #define CPU_SPEED 1
 
+// Translate hot 68000 code to native code. Only used on x86-64 hosts
+// when built with E68_JIT, otherwise the interpreter runs everything.
+#define CPU_JIT 1
+
 
 // Multiple "ram" sections may be present.
 // The base address
@@ -51,6 +55,41 @@
 // ESP only
 #define DISK_PARTITION_NAME "hd"
 
+// SDL only: If defined, DISK_FILE_NAME is used as a simulated flash
+// partition with the same write cache as on the ESP, instead of as a
+// raw disk image.
+// #define DISK_FLASH_SIM 1
+
+// The flash erase block size
+#define DISK_FLASH_ERASE_SIZE 4096
+
+// The number of flash erase blocks in the disk write cache
+#define DISK_CACHE_BLOCKS 16
+
+// If defined, the disk is stored in a log-structured, wear-leveled
+// format instead of being written to the flash in place. The disk is
+// somewhat smaller than the partition. On the ESP the partition must
+// already hold such a disk. In sdl_sim the partition is simulated with
+// DISK_FTL_FILE_NAME, which is filled from DISK_FILE_NAME when it is
+// created, and which can then be written to the partition.
+// #define DISK_FTL 1
+
+// SDL only: The simulated flash partition for DISK_FTL
+#define DISK_FTL_FILE_NAME "hd-ftl.bin"
+#define DISK_FTL_FLASH_SIZE (14 * 1024 * 1024)
+
+// Access the disk from a separate thread. Sequential reads are
+// prefetched and writes are queued, so the emulation does not wait
+// for the host. SCSI reads report busy until the data is available.
+#define DISK_ASYNC 1
+
+// The read-ahead size in blocks
+#define DISK_ASYNC_READ_BLOCKS 64
+
+// The number of queued writes and the blocks per queued write
+#define DISK_ASYNC_WRITE_CNT    16
+#define DISK_ASYNC_WRITE_BLOCKS 8
+
 // Need to match SCSI_DEVICE<N>_DRIVE
 #define DISK_DRIVE 128
 
@@ -154,6 +193,10 @@
 #define IWM_DRIVE1_SINGLE_SIDED 0
 #define IWM_DRIVE1_AUTO_ROTATE  1
 
+// Move the data of a SCSI command at once when the CPU transfers
+// it in a byte copy loop, instead of running the loop for every byte.
+#define SCSI_DMA_ACCEL 1
+
 // The SCSI ID
 #define SCSI_DEVICE0_ID 6
 // The drive number. This number is used to identify
@@ -194,6 +237,11 @@
 // Brightness in the range 0 - 1000.
 #define VIDEO_BRIGHTNESS 1000
 
+// Skip up to this many frames in a row while the emulation lags
+// behind real time. The guest still sees every vertical blanking
+// interrupt. A value of 0 disables frame skipping.
+#define VIDEO_SKIP_MAX 4
+
 #define VIDEO_W 512
 #define VIDEO_H 342
 
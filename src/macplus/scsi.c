@@ -119,11 +119,15 @@ void mac_scsi_init (mac_scsi_t *scsi)
 
 	scsi->cmd_start = NULL;
 	scsi->cmd_finish = NULL;
+	scsi->cmd_busy = 0;
 
 	scsi->set_int_val = 0;
 	scsi->set_int_ext = NULL;
 	scsi->set_int = NULL;
 
+	scsi->dma_ext = NULL;
+	scsi->dma = NULL;
+
 	for (i = 0; i < 8; i++) {
 		scsi->dev[i].valid = 0;
 	}
@@ -142,6 +146,12 @@ void mac_scsi_set_int_fct (mac_scsi_t *scsi, void *ext, void *fct)
 	scsi->set_int = fct;
 }
 
+void mac_scsi_set_dma_fct (mac_scsi_t *scsi, void *ext, void *fct)
+{
+	scsi->dma_ext = ext;
+	scsi->dma = fct;
+}
+
 void mac_scsi_set_disks (mac_scsi_t *scsi, disks_t *dsks)
 {
 	scsi->dsks = dsks;
@@ -264,6 +274,8 @@ void mac_scsi_set_phase_free (mac_scsi_t *scsi)
 
 	scsi->phase = E5380_PHASE_FREE;
 
+	scsi->cmd_busy = 0;
+
 	scsi->csb &= ~E5380_CSB_BSY;
 	scsi->csb &= ~E5380_CSB_CD;
 	scsi->csb &= ~E5380_CSB_MSG;
@@ -486,6 +498,17 @@ void mac_scsi_cmd_read (mac_scsi_t *scsi, unsigned long lba, unsigned long cnt)
 		return;
 	}
 
+	/*
+	 * If the disk is still reading in the background, stay in the
+	 * command phase with REQ negated, like a drive that is seeking.
+	 */
+	if (dsk_get_ready (dsk, lba, cnt) == 0) {
+		scsi->cmd_busy = 1;
+		return;
+	}
+
+	scsi->cmd_busy = 0;
+
 	if (dsk_read_lba (dsk, scsi->buf, lba, cnt)) {
 		mac_log_deb ("scsi: read error at %lu + %lu\n", lba, cnt);
 		mac_scsi_set_phase_status (scsi, 0x02);
@@ -858,6 +881,7 @@ void mac_scsi_cmd_init (mac_scsi_t *scsi, unsigned char cmd)
 {
 	scsi->cmd_start = NULL;
 	scsi->cmd_finish = NULL;
+	scsi->cmd_busy = 0;
 
 	switch (cmd) {
 	case 0x00:
@@ -937,6 +961,10 @@ unsigned char mac_scsi_get_csd_dma (mac_scsi_t *scsi)
 		return (0);
 	}
 
+	if (scsi->dma != NULL) {
+		scsi->dma (scsi->dma_ext, 0);
+	}
+
 	val = scsi->buf[scsi->buf_i];
 	scsi->buf_i += 1;
 
@@ -968,6 +996,10 @@ unsigned char mac_scsi_get_tcr (mac_scsi_t *scsi)
 static
 unsigned char mac_scsi_get_csb (mac_scsi_t *scsi)
 {
+	if (scsi->cmd_busy && (scsi->phase == E5380_PHASE_CMD)) {
+		scsi->cmd_start (scsi);
+	}
+
 	return (scsi->csb);
 }
 
@@ -1067,6 +1099,10 @@ void mac_scsi_set_odr_dma (mac_scsi_t *scsi, unsigned char val)
 	scsi->buf[scsi->buf_i] = val;
 	scsi->buf_i += 1;
 
+	if ((scsi->buf_i < scsi->buf_n) && (scsi->dma != NULL)) {
+		scsi->dma (scsi->dma_ext, 1);
+	}
+
 	if (scsi->buf_i >= scsi->buf_n) {
 		if (scsi->cmd_finish != NULL) {
 			scsi->cmd_finish (scsi);
@@ -1364,6 +1400,61 @@ void mac_scsi_set_uint8 (void *ext, unsigned long addr, unsigned char val)
 	}
 }
 
+unsigned long mac_scsi_dma_avail (const mac_scsi_t *scsi, int wr)
+{
+	if (scsi->buf_i >= scsi->buf_n) {
+		return (0);
+	}
+
+	if (wr) {
+		if (scsi->phase != E5380_PHASE_DATA_OUT) {
+			return (0);
+		}
+
+		return (scsi->buf_n - scsi->buf_i);
+	}
+
+	if (scsi->phase != E5380_PHASE_DATA_IN) {
+		return (0);
+	}
+
+	return (scsi->buf_n - scsi->buf_i - 1);
+}
+
+unsigned long mac_scsi_dma_get (mac_scsi_t *scsi, void *buf, unsigned long cnt)
+{
+	unsigned long n;
+
+	n = mac_scsi_dma_avail (scsi, 0);
+
+	if (n > cnt) {
+		n = cnt;
+	}
+
+	memcpy (buf, scsi->buf + scsi->buf_i, n);
+
+	scsi->buf_i += n;
+
+	return (n);
+}
+
+unsigned long mac_scsi_dma_set (mac_scsi_t *scsi, const void *buf, unsigned long cnt)
+{
+	unsigned long n;
+
+	n = mac_scsi_dma_avail (scsi, 1);
+
+	if (n > cnt) {
+		n = cnt;
+	}
+
+	memcpy (scsi->buf + scsi->buf_i, buf, n);
+
+	scsi->buf_i += n;
+
+	return (n);
+}
+
 void mac_scsi_set_uint16 (void *ext, unsigned long addr, unsigned short val)
 {
 	mac_scsi_t *scsi = ext;
@@ -1401,4 +1492,5 @@ void mac_scsi_reset (mac_scsi_t *scsi)
 
 	scsi->cmd_start = NULL;
 	scsi->cmd_finish = NULL;
+	scsi->cmd_busy = 0;
 }
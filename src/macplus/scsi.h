@@ -70,10 +70,17 @@ typedef struct mac_scsi_s {
 	void          (*cmd_start) (struct mac_scsi_s *scsi);
 	void          (*cmd_finish) (struct mac_scsi_s *scsi);
 
+	/* the disk was not ready, cmd_start is repeated when CSB is read */
+	char          cmd_busy;
+
 	unsigned char  set_int_val;
 	void           *set_int_ext;
 	void           (*set_int) (void *ext, unsigned char val);
 
+	/* called on every pseudo DMA access, see mac_scsi_set_dma_fct() */
+	void           *dma_ext;
+	void           (*dma) (void *ext, int wr);
+
 	mac_scsi_dev_t dev[8];
 
 	disks_t        *dsks;
@@ -85,6 +92,14 @@ void mac_scsi_free (mac_scsi_t *scsi);
 
 void mac_scsi_set_int_fct (mac_scsi_t *scsi, void *ext, void *fct);
 
+/*
+ * Set a function that is called on every byte that is transferred
+ * through the pseudo DMA data registers, before a byte is read (wr = 0)
+ * or after a byte was written (wr = 1). It can move the bytes that
+ * follow at once with mac_scsi_dma_get() and mac_scsi_dma_set().
+ */
+void mac_scsi_set_dma_fct (mac_scsi_t *scsi, void *ext, void *fct);
+
 void mac_scsi_set_disks (mac_scsi_t *scsi, disks_t *dsks);
 void mac_scsi_set_drive (mac_scsi_t *scsi, unsigned id, unsigned drive);
 void mac_scsi_set_drive_vendor (mac_scsi_t *scsi, unsigned id, const char *vendor);
@@ -96,6 +111,25 @@ unsigned short mac_scsi_get_uint16 (void *ext, unsigned long addr);
 void mac_scsi_set_uint8 (void *ext, unsigned long addr, unsigned char val);
 void mac_scsi_set_uint16 (void *ext, unsigned long addr, unsigned short val);
 
+/*
+ * Get the number of bytes that mac_scsi_dma_get() (wr = 0) or
+ * mac_scsi_dma_set() (wr = 1) can transfer.
+ */
+unsigned long mac_scsi_dma_avail (const mac_scsi_t *scsi, int wr);
+
+/*
+ * Get up to cnt bytes of the current data in phase. The last byte is
+ * left for the access that is in progress. Returns the number of bytes.
+ */
+unsigned long mac_scsi_dma_get (mac_scsi_t *scsi, void *buf, unsigned long cnt);
+
+/*
+ * Send up to cnt bytes in the current data out phase. The command is
+ * finished by the access that is in progress. Returns the number of
+ * bytes.
+ */
+unsigned long mac_scsi_dma_set (mac_scsi_t *scsi, const void *buf, unsigned long cnt);
+
 void mac_scsi_reset (mac_scsi_t *scsi);
 
 
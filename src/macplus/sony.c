@@ -122,6 +122,9 @@ void mac_sony_init (mac_sony_t *sony, int enable)
 	sony->mem = NULL;
 	sony->dsks = NULL;
 
+	sony->ram_ext = NULL;
+	sony->ram_write = NULL;
+
 	sony->check_addr = 0;
 	sony->icon_addr[0] = 0;
 	sony->icon_addr[1] = 0;
@@ -146,6 +149,20 @@ void mac_sony_set_mem (mac_sony_t *sony, memory_t *mem)
 	sony->mem = mem;
 }
 
+void mac_sony_set_ram_fct (mac_sony_t *sony, void *ext, void *fct)
+{
+	sony->ram_ext = ext;
+	sony->ram_write = fct;
+}
+
+static
+void mac_sony_ram_write (mac_sony_t *sony, unsigned long addr, unsigned long size)
+{
+	if ((sony->ram_write != NULL) && (size > 0)) {
+		sony->ram_write (sony->ram_ext, addr, size);
+	}
+}
+
 void mac_sony_set_disks (mac_sony_t *sony, disks_t *dsks)
 {
 	sony->dsks = dsks;
@@ -373,6 +390,8 @@ void mac_sony_insert (mac_sony_t *sony, unsigned drive)
 		else {
 			mem_set_uint8 (sony->mem, vars + SONY_WPROT, 0x00);
 		}
+
+		mac_sony_ram_write (sony, vars, SONY_NEWIF + 1);
 	}
 }
 
@@ -685,6 +704,7 @@ void mac_sony_prime_read (mac_sony_t *sony, unsigned drive)
 	unsigned long i, n;
 	unsigned      j;
 	disk_t        *dsk;
+	unsigned char *ptr;
 	unsigned char buf[512];
 	unsigned char tag[12];
 	unsigned      posmode;
@@ -721,28 +741,68 @@ void mac_sony_prime_read (mac_sony_t *sony, unsigned drive)
 
 	n = cnt / 512;
 
-	for (i = 0; i < n; i++) {
-		if (mac_sony_read_block (dsk, buf, tag, (ofs / 512) + i)) {
-			mac_log_deb ("sony: read error at block %lu\n",
-				(ofs / 512) + i
-			);
+	ptr = NULL;
+
+	if ((n > 0) && (dsk_get_type (dsk) != PCE_DISK_PSI)) {
+		ptr = mem_get_ptr_direct (sony->mem, addr, cnt, 1);
+	}
+
+	if (ptr != NULL) {
+		/* without tags, all blocks can be read at once */
+		if (dsk_read_lba (dsk, ptr, ofs / 512, n)) {
+			mac_log_deb ("sony: read error at block %lu\n", ofs / 512);
 			mac_sony_return (sony, 0xffff, 0);
 			return;
 		}
 
-		for (j = 0; j < 512; j++) {
-			mem_set_uint8 (sony->mem, addr + 512 * i + j, buf[j]);
-		}
+		mac_sony_ram_write (sony, addr, cnt);
 
 		for (j = 0; j < 12; j++) {
-			mem_set_uint8 (sony->mem, 0x2fc + j, tag[j]);
+			mem_set_uint8 (sony->mem, 0x2fc + j, 0);
 		}
 
 		if (sony->tag_buf != 0) {
+			for (i = 0; i < (12 * n); i++) {
+				mem_set_uint8 (sony->mem, sony->tag_buf + i, 0);
+			}
+		}
+	}
+	else {
+		for (i = 0; i < n; i++) {
+			if (mac_sony_read_block (dsk, buf, tag, (ofs / 512) + i)) {
+				mac_log_deb ("sony: read error at block %lu\n",
+					(ofs / 512) + i
+				);
+				mac_sony_ram_write (sony, addr, 512 * i);
+
+				if (sony->tag_buf != 0) {
+					mac_sony_ram_write (sony, sony->tag_buf, 12 * i);
+				}
+
+				mac_sony_return (sony, 0xffff, 0);
+				return;
+			}
+
+			for (j = 0; j < 512; j++) {
+				mem_set_uint8 (sony->mem, addr + 512 * i + j, buf[j]);
+			}
+
 			for (j = 0; j < 12; j++) {
-				mem_set_uint8 (sony->mem, sony->tag_buf + 12 * i + j, tag[j]);
+				mem_set_uint8 (sony->mem, 0x2fc + j, tag[j]);
+			}
+
+			if (sony->tag_buf != 0) {
+				for (j = 0; j < 12; j++) {
+					mem_set_uint8 (sony->mem, sony->tag_buf + 12 * i + j, tag[j]);
+				}
 			}
 		}
+
+		mac_sony_ram_write (sony, addr, cnt);
+	}
+
+	if (sony->tag_buf != 0) {
+		mac_sony_ram_write (sony, sony->tag_buf, 12 * n);
 	}
 
 	vars = mac_sony_get_vars (sony, drive);
@@ -765,6 +825,7 @@ void mac_sony_prime_write (mac_sony_t *sony, unsigned drive)
 	unsigned long i, n;
 	unsigned      j;
 	disk_t        *dsk;
+	unsigned char *ptr;
 	unsigned char buf[512];
 	unsigned char tag[12];
 
@@ -802,33 +863,59 @@ void mac_sony_prime_write (mac_sony_t *sony, unsigned drive)
 
 	n = cnt / 512;
 
-	for (i = 0; i < n; i++) {
-		for (j = 0; j < 512; j++) {
-			buf[j] = mem_get_uint8 (sony->mem, addr + 512 * i + j);
-		}
+	ptr = NULL;
 
+	if ((n > 0) && (dsk_get_type (dsk) != PCE_DISK_PSI)) {
+		ptr = mem_get_ptr_direct (sony->mem, addr, cnt, 0);
+	}
+
+	if (ptr != NULL) {
+		/* the tags are not stored, only leave them as they would be */
 		if (sony->tag_buf != 0) {
 			for (j = 0; j < 12; j++) {
-				tag[j] = mem_get_uint8 (sony->mem, sony->tag_buf + 12 * i + j);
+				tag[j] = mem_get_uint8 (sony->mem, sony->tag_buf + 12 * (n - 1) + j);
 				mem_set_uint8 (sony->mem, 0x2fc + j, tag[j]);
 			}
 		}
 		else {
-			mem_set_uint16_be (sony->mem, 0x302, relblk + i);
-
-			for (j = 0; j < 12; j++) {
-				tag[j] = mem_get_uint8 (sony->mem, 0x2fc + j);
-			}
+			mem_set_uint16_be (sony->mem, 0x302, relblk + n - 1);
 		}
 
-		if (mac_sony_write_block (dsk, buf, tag, (ofs / 512) + i)) {
-			mac_log_deb ("sony: write error at block %lu\n",
-				(ofs / 512) + i
-			);
+		if (dsk_write_lba (dsk, ptr, ofs / 512, n)) {
+			mac_log_deb ("sony: write error at block %lu\n", ofs / 512);
 			mac_sony_return (sony, 0xffff, 0);
 			return;
 		}
 	}
+	else {
+		for (i = 0; i < n; i++) {
+			for (j = 0; j < 512; j++) {
+				buf[j] = mem_get_uint8 (sony->mem, addr + 512 * i + j);
+			}
+
+			if (sony->tag_buf != 0) {
+				for (j = 0; j < 12; j++) {
+					tag[j] = mem_get_uint8 (sony->mem, sony->tag_buf + 12 * i + j);
+					mem_set_uint8 (sony->mem, 0x2fc + j, tag[j]);
+				}
+			}
+			else {
+				mem_set_uint16_be (sony->mem, 0x302, relblk + i);
+
+				for (j = 0; j < 12; j++) {
+					tag[j] = mem_get_uint8 (sony->mem, 0x2fc + j);
+				}
+			}
+
+			if (mac_sony_write_block (dsk, buf, tag, (ofs / 512) + i)) {
+				mac_log_deb ("sony: write error at block %lu\n",
+					(ofs / 512) + i
+				);
+				mac_sony_return (sony, 0xffff, 0);
+				return;
+			}
+		}
+	}
 
 	mac_sony_set_pblk (sony, ioActCount, 4, cnt);
 
@@ -39,10 +39,15 @@ typedef struct {
 	memory_t      *mem;
 	disks_t       *dsks;
 
+	/* called after RAM was written directly, see mac_sony_set_ram_fct() */
+	void          *ram_ext;
+	void          (*ram_write) (void *ext, unsigned long addr, unsigned long size);
+
 	unsigned      delay_val[SONY_DRIVES];
 	unsigned      delay_cnt[SONY_DRIVES];
 
 	unsigned long check_addr;
+
 	unsigned long icon_addr[2];
 
 	unsigned long tag_buf;
@@ -70,6 +75,13 @@ void mac_sony_set_mem (mac_sony_t *sony, memory_t *mem);
 
 void mac_sony_set_disks (mac_sony_t *sony, disks_t *dsks);
 
+/*
+ * Set a function that is called with every RAM range that the driver
+ * writes without going through the CPU, so that cached code for it
+ * can be dropped.
+ */
+void mac_sony_set_ram_fct (mac_sony_t *sony, void *ext, void *fct);
+
 void mac_sony_patch (mac_sony_t *sony);
 
 void mac_sony_set_delay (mac_sony_t *sony, unsigned drive, unsigned delay);
@@ -26,6 +26,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(SDL_SIM) && defined(__SSE2__)
+#include <emmintrin.h>
+#define MAC_VIDEO_SSE2 1
+#elif defined(SDL_SIM) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MAC_VIDEO_NEON 1
+#endif
+
 
 #define MAC_VIDEO_PFREQ 15667200
 #define MAC_VIDEO_HFREQ (MAC_VIDEO_PFREQ / (512 + 192))
@@ -37,6 +45,103 @@
 /* #define MAC_VIDEO_VB2 (((342 + 28) * (512 + 192) * 7833600) / MAC_VIDEO_PFREQ) */
 #define MAC_VIDEO_VB2 130240
 
+/* frames are skipped while the emulation is more than one frame behind */
+#define MAC_VIDEO_LAG (1000000UL / 60)
+
+/* the number of frames over which the frame rate is measured */
+#define MAC_VIDEO_WIN 60
+
+
+/*
+ * Build the table that maps a frame buffer byte to 8 pixels in the
+ * terminal's format with the current colors and brightness. For
+ * TRM_FMT_MONO the colors are passed to the terminal instead.
+ */
+static
+void mac_video_set_tab (mac_video_t *mv)
+{
+	unsigned      i, j, k;
+	unsigned      v0, v1;
+	unsigned char col0[3], col1[3];
+	unsigned char *rgb;
+
+	for (i = 0; i < 3; i++) {
+		col0[i] = (mv->brightness * mv->col0[i]) / 255;
+		col1[i] = (mv->brightness * mv->col1[i]) / 255;
+	}
+
+	if (mv->fmt == TRM_FMT_MONO) {
+		/* set bits are col0 */
+		if (mv->trm != NULL) {
+			trm_set_mono (mv->trm, col1, col0);
+		}
+
+		return;
+	}
+
+	if (mv->fmt == TRM_FMT_RGB565) {
+		v0 = ((col0[0] & 0xf8) << 8) | ((col0[1] & 0xfc) << 3) | (col0[2] >> 3);
+		v1 = ((col1[0] & 0xf8) << 8) | ((col1[1] & 0xfc) << 3) | (col1[2] >> 3);
+
+		for (i = 0; i < 256; i++) {
+			rgb = mv->rgb_tab[i];
+
+			for (j = 0; j < 8; j++) {
+				k = (i & (0x80 >> j)) ? v0 : v1;
+
+				rgb[2 * j + 0] = (k >> 8) & 0xff;
+				rgb[2 * j + 1] = k & 0xff;
+			}
+		}
+
+		return;
+	}
+
+	for (i = 0; i < 256; i++) {
+		rgb = mv->rgb_tab[i];
+
+		for (j = 0; j < 8; j++) {
+			for (k = 0; k < 3; k++) {
+				rgb[3 * j + k] = (i & (0x80 >> j)) ? col0[k] : col1[k];
+			}
+		}
+	}
+}
+
+/*
+ * Convert cnt frame buffer bytes from src to RGB888 or RGB565 pixels
+ * in dst
+ */
+static
+void mac_video_expand (mac_video_t *mv, unsigned char *dst, const unsigned char *src, unsigned cnt)
+{
+	unsigned            i, n;
+	const unsigned char *tab;
+
+	n = (mv->fmt == TRM_FMT_RGB565) ? 16 : 24;
+
+	for (i = 0; i < cnt; i++) {
+		tab = mv->rgb_tab[src[i]];
+
+#if defined(MAC_VIDEO_SSE2)
+		_mm_storeu_si128 ((__m128i *) dst, _mm_loadu_si128 ((const __m128i *) tab));
+
+		if (n > 16) {
+			_mm_storel_epi64 ((__m128i *) (dst + 16), _mm_loadl_epi64 ((const __m128i *) (tab + 16)));
+		}
+#elif defined(MAC_VIDEO_NEON)
+		vst1q_u8 (dst, vld1q_u8 (tab));
+
+		if (n > 16) {
+			vst1_u8 (dst + 16, vld1_u8 (tab + 16));
+		}
+#else
+		memcpy (dst, tab, n);
+#endif
+
+		dst += n;
+	}
+}
 
 int mac_video_init (mac_video_t *mv, unsigned w, unsigned h)
 {
@@ -57,12 +162,16 @@ int mac_video_init (mac_video_t *mv, unsigned w, unsigned h)
 	}
 	memset(mv->vcmp, 0, tmp_size);
 
-	tmp_size = 3UL * (unsigned long) w * mv->cmp_cnt;
-	mv->rgb = malloc (tmp_size);
-	if (mv->rgb == NULL) {
+	mv->dirty = malloc (mv->h);
+	if (mv->dirty == NULL) {
 		return (1);
 	}
-	memset(mv->rgb, 0, tmp_size);
+	memset (mv->dirty, 1, mv->h);
+
+	mv->track = 0;
+
+	/* allocated on the first update that needs it */
+	mv->rgb = NULL;
 
 	mv->brightness = 255;
 
@@ -74,8 +183,25 @@ int mac_video_init (mac_video_t *mv, unsigned w, unsigned h)
 	mv->col1[1] = 0xff;
 	mv->col1[2] = 0xff;
 
+	mv->fmt = TRM_FMT_RGB888;
+	mac_video_set_tab (mv);
+
 	mv->clk = 0;
 
+	mv->skip_max = 0;
+	mv->skip_cnt = 0;
+	mv->lag = 0;
+
+	mv->frames_drawn = 0;
+	mv->frames_skipped = 0;
+	mv->win_cnt = 0;
+	mv->win_drawn = 0;
+	mv->fps = 0;
+
+	mv->hash_on = 0;
+	mv->hash = 0;
+	mv->line_hash = NULL;
+
 	mv->vbi_val = 0;
 	mv->vbi_ext = NULL;
 	mv->set_vbi = NULL;
@@ -103,6 +229,10 @@ mac_video_t *mac_video_new (unsigned w, unsigned h)
 
 void mac_video_free (mac_video_t *mv)
 {
+	free (mv->line_hash);
+	free (mv->dirty);
+	free (mv->rgb);
+	free (mv->vcmp);
 }
 
 void mac_video_del (mac_video_t *mv)
@@ -122,11 +252,27 @@ void mac_video_set_vbi_fct (mac_video_t *mv, void *ext, void *fct)
 void mac_video_set_vbuf (mac_video_t *mv, const unsigned char *vbuf)
 {
 	mv->vbuf = vbuf;
+
+	/* compare all lines against the new buffer */
+	memset (mv->dirty, 1, mv->h);
+}
+
+unsigned char *mac_video_get_dirty (mac_video_t *mv)
+{
+	return (mv->dirty);
+}
+
+void mac_video_set_track (mac_video_t *mv, int val)
+{
+	mv->track = (val != 0);
+
+	memset (mv->dirty, 1, mv->h);
 }
 
 void mac_video_set_terminal (mac_video_t *mv, terminal_t *trm)
 {
 	mv->trm = trm;
+	mv->force = 1;
 
 	if (mv->trm != NULL) {
 		trm_open (mv->trm, mv->w, mv->h);
@@ -171,15 +317,56 @@ void mac_video_set_vbi (mac_video_t *mv, unsigned char val)
 	}
 }
 
+/*
+ * FNV-1a over one line, seeded with the line number so that moving a
+ * line changes the frame hash.
+ */
+static
+unsigned long long mac_video_hash_line (const unsigned char *src, unsigned cnt, unsigned y)
+{
+	unsigned long long h;
+
+	h = 0xcbf29ce484222325ULL ^ y;
+
+	while (cnt > 0) {
+		h ^= *(src++);
+		h *= 0x100000001b3ULL;
+		cnt -= 1;
+	}
+
+	return (h);
+}
+
+static
+void mac_video_hash_lines (mac_video_t *mv, unsigned y, unsigned n)
+{
+	unsigned            bpl;
+	unsigned long long  h;
+	const unsigned char *src;
+
+	bpl = (mv->w + 7) / 8;
+	src = mv->vcmp + (unsigned long) bpl * y;
+
+	while (n > 0) {
+		h = mac_video_hash_line (src, bpl, y);
+
+		mv->hash ^= mv->line_hash[y] ^ h;
+		mv->line_hash[y] = h;
+
+		src += bpl;
+		y += 1;
+		n -= 1;
+	}
+}
+
 static
 void mac_video_update (mac_video_t *mv)
 {
 	unsigned            y;
-	unsigned            i, j;
-	unsigned            k, n;
+	unsigned            k, n, bpl;
+	int                 all;
 	const unsigned char *src;
 	unsigned char       *dst, *rgb;
-	unsigned char       col0[3], col1[3];
 
 	if (mv->trm == NULL) {
 		return;
@@ -189,52 +376,71 @@ void mac_video_update (mac_video_t *mv)
 		return;
 	}
 
-	for (i = 0; i < 3; i++) {
-		col0[i] = (mv->brightness * mv->col0[i]) / 255;
-		col1[i] = (mv->brightness * mv->col1[i]) / 255;
+	if (trm_get_format (mv->trm) != mv->fmt) {
+		mv->fmt = trm_get_format (mv->trm);
+		mv->force = 1;
+	}
+
+	if (mv->force) {
+		mac_video_set_tab (mv);
+	}
+
+	if ((mv->rgb == NULL) && (mv->fmt != TRM_FMT_MONO)) {
+		mv->rgb = malloc (3UL * 8 * ((mv->w + 7) / 8) * mv->cmp_cnt);
+
+		if (mv->rgb == NULL) {
+			return;
+		}
 	}
 
 	trm_set_size (mv->trm, mv->w, mv->h);
 
-	src = mv->vbuf;
-	dst = mv->vcmp;
+	/* without write tracking every line must be compared */
+	all = mv->force || (mv->track == 0);
+
+	bpl = (mv->w + 7) / 8;
 	rgb = mv->rgb;
 
 	y = 0;
 	while (y < mv->h) {
-		n = mv->h - y;
+		if ((all == 0) && (mv->dirty[y] == 0)) {
+			y += 1;
+			continue;
+		}
+
+		n = 0;
+		while ((n < mv->cmp_cnt) && ((y + n) < mv->h)) {
+			if ((all == 0) && (mv->dirty[y + n] == 0)) {
+				break;
+			}
+
+			mv->dirty[y + n] = 0;
 
-		if (n > mv->cmp_cnt) {
-			n = mv->cmp_cnt;
+			n += 1;
 		}
 
-		k = n * ((mv->w + 7) / 8);
+		src = mv->vbuf + (unsigned long) bpl * y;
+		dst = mv->vcmp + (unsigned long) bpl * y;
+
+		k = n * bpl;
 
 		if (mv->force || (memcmp (dst, src, k) != 0)) {
 			memcpy (dst, src, k);
 
-			j = 0;
-			for (i = 0; i < (8 * k); i++) {
-				if (dst[i >> 3] & (0x80 >> (i & 7))) {
-					rgb[j + 0] = col0[0];
-					rgb[j + 1] = col0[1];
-					rgb[j + 2] = col0[2];
-				}
-				else {
-					rgb[j + 0] = col1[0];
-					rgb[j + 1] = col1[1];
-					rgb[j + 2] = col1[2];
-				}
-
-				j += 3;
+			if (mv->hash_on) {
+				mac_video_hash_lines (mv, y, n);
 			}
 
-			trm_set_lines (mv->trm, rgb, y, n);
+			if (mv->fmt == TRM_FMT_MONO) {
+				/* the terminal takes the frame buffer as is */
+				trm_set_lines (mv->trm, dst, y, n);
+			}
+			else {
+				mac_video_expand (mv, rgb, dst, k);
+				trm_set_lines (mv->trm, rgb, y, n);
+			}
 		}
 
-		src += k;
-		dst += k;
-
 		y += n;
 	}
 
@@ -248,6 +454,102 @@ void mac_video_redraw (mac_video_t *mv)
 	mac_video_update (mv);
 }
 
+void mac_video_set_skip (mac_video_t *mv, unsigned max)
+{
+	mv->skip_max = max;
+}
+
+void mac_video_set_lag (mac_video_t *mv, unsigned long us)
+{
+	mv->lag = us;
+}
+
+unsigned mac_video_get_fps (const mac_video_t *mv)
+{
+	return (mv->fps);
+}
+
+int mac_video_set_hash (mac_video_t *mv, int val)
+{
+	if (val == 0) {
+		free (mv->line_hash);
+
+		mv->hash_on = 0;
+		mv->hash = 0;
+		mv->line_hash = NULL;
+
+		return (0);
+	}
+
+	if (mv->hash_on) {
+		return (0);
+	}
+
+	mv->line_hash = calloc (mv->h, sizeof (unsigned long long));
+
+	if (mv->line_hash == NULL) {
+		return (1);
+	}
+
+	mv->hash_on = 1;
+	mv->hash = 0;
+
+	mac_video_hash_lines (mv, 0, mv->h);
+
+	return (0);
+}
+
+unsigned long long mac_video_get_hash (const mac_video_t *mv)
+{
+	return (mv->hash);
+}
+
+/*
+ * Decide whether the frame at the start of the current vertical blanking
+ * interval is skipped. The dirty line map keeps collecting changes, so
+ * the next frame that is drawn catches up.
+ */
+static
+int mac_video_skip (mac_video_t *mv)
+{
+	int skip;
+
+	skip = (mv->skip_cnt < mv->skip_max) && (mv->lag > MAC_VIDEO_LAG);
+
+	if (mv->hash_on) {
+		skip = 0;
+	}
+
+	if (skip) {
+		mv->skip_cnt += 1;
+		mv->frames_skipped += 1;
+	}
+	else {
+		mv->skip_cnt = 0;
+		mv->frames_drawn += 1;
+		mv->win_drawn += 1;
+	}
+
+	mv->win_cnt += 1;
+
+	if (mv->win_cnt >= MAC_VIDEO_WIN) {
+		mv->fps = (100ULL * mv->win_drawn * MAC_VIDEO_PFREQ) / ((512 + 192) * (342 + 28) * mv->win_cnt);
+		mv->win_cnt = 0;
+		mv->win_drawn = 0;
+	}
+
+	return (skip);
+}
+
+unsigned long mac_video_get_clock_next (const mac_video_t *mv)
+{
+	if (mv->clk < MAC_VIDEO_VB1) {
+		return (MAC_VIDEO_VB1 - mv->clk);
+	}
+
+	return (MAC_VIDEO_VB2 - mv->clk);
+}
+
 void mac_video_clock (mac_video_t *mv, unsigned long n)
 {
 	unsigned long old;
@@ -262,7 +564,10 @@ void mac_video_clock (mac_video_t *mv, unsigned long n)
 
 	if (old < MAC_VIDEO_VB1) {
 		/* vbl start */
-		mac_video_update (mv);
+		if (mac_video_skip (mv) == 0) {
+			mac_video_update (mv);
+		}
+
 		mac_video_set_vbi (mv, 1);
 	}
 
@@ -39,14 +39,43 @@ typedef struct {
 
 	unsigned char       *vcmp;
 
+	/* one byte per line, non-zero if the line may have changed */
+	unsigned char       *dirty;
+	char                track;
+
 	unsigned char       *rgb;
 
 	unsigned            brightness;
 	unsigned char       col0[3];
 	unsigned char       col1[3];
 
+	/* the terminal pixel format that rgb_tab was built for */
+	unsigned            fmt;
+
+	/* the 8 RGB888 or RGB565 pixels for every frame buffer byte */
+	unsigned char       rgb_tab[256][24];
+
 	unsigned long       clk;
 
+	/* skip at most skip_max frames in a row while lagging behind */
+	unsigned            skip_max;
+	unsigned            skip_cnt;
+
+	/* how far the emulation is behind real time, in microseconds */
+	unsigned long       lag;
+
+	/* statistics */
+	unsigned long       frames_drawn;
+	unsigned long       frames_skipped;
+	unsigned            win_cnt;
+	unsigned            win_drawn;
+	unsigned            fps;
+
+	/* frame hash, the xor of the hashes of all lines in vcmp */
+	char                hash_on;
+	unsigned long long  hash;
+	unsigned long long  *line_hash;
+
 	terminal_t          *trm;
 
 	unsigned char       vbi_val;
@@ -64,6 +93,21 @@ void mac_video_del (mac_video_t *mv);
 void mac_video_set_vbi_fct (mac_video_t *mv, void *ext, void *fct);
 
 void mac_video_set_vbuf (mac_video_t *mv, const unsigned char *vbuf);
+
+/*****************************************************************************
+ * @short Get the dirty line map
+ *
+ * The map has one byte per line. Whoever writes to the video buffer sets
+ * the bytes of the lines it modifies to a non-zero value.
+ *****************************************************************************/
+unsigned char *mac_video_get_dirty (mac_video_t *mv);
+
+/*****************************************************************************
+ * @short Tell the video whether all writes are marked in the dirty map
+ * @param val If true, only lines marked in the dirty map are updated.
+ *            Otherwise all lines are compared to the last frame.
+ *****************************************************************************/
+void mac_video_set_track (mac_video_t *mv, int val);
 void mac_video_set_terminal (mac_video_t *mv, terminal_t *trm);
 
 /*****************************************************************************
@@ -81,6 +125,49 @@ void mac_video_set_brightness (mac_video_t *mv, unsigned val);
 
 void mac_video_redraw (mac_video_t *mv);
 
+/*****************************************************************************
+ * @short Set the maximum number of frames that are skipped in a row
+ *
+ * Frames are only skipped while the emulation lags behind real time. The
+ * vertical blanking interrupt is raised for skipped frames as well. If
+ * max is 0, no frames are skipped.
+ *****************************************************************************/
+void mac_video_set_skip (mac_video_t *mv, unsigned max);
+
+/*****************************************************************************
+ * @short Set how far the emulation is behind real time
+ * @param us The lag in microseconds
+ *****************************************************************************/
+void mac_video_set_lag (mac_video_t *mv, unsigned long us);
+
+/*****************************************************************************
+ * @short Get the number of frames drawn per emulated second, times 100
+ *****************************************************************************/
+unsigned mac_video_get_fps (const mac_video_t *mv);
+
+/*****************************************************************************
+ * @short Enable or disable the frame hash
+ * @return Non-zero on error
+ *
+ * While the hash is enabled, no frames are skipped, so that the hash
+ * always matches the frame that was displayed last.
+ *****************************************************************************/
+int mac_video_set_hash (mac_video_t *mv, int val);
+
+/*****************************************************************************
+ * @short Get the 64 bit hash of the frame that was displayed last
+ *
+ * The hash only depends on the frame buffer contents, not on the
+ * terminal format or the colors. It is 0 if the hash is not enabled.
+ *****************************************************************************/
+unsigned long long mac_video_get_hash (const mac_video_t *mv);
+
+/*****************************************************************************
+ * @short Get the number of clock cycles until the next vertical blanking
+ *        interrupt edge
+ *****************************************************************************/
+unsigned long mac_video_get_clock_next (const mac_video_t *mv);
+
 void mac_video_clock (mac_video_t *mv, unsigned long cnt);
 
 